@@ -0,0 +1,129 @@
+// Cook-Torrance BRDF terms
+
+#define PI 3.1415926535897932384626433832795
+#define PI_2 1.57079632679489661923
+#define PI_4 0.785398163397448309616
+
+// ------------------------------------------------------------------
+
+struct PBRMaterial
+{
+	vec3 color;
+	float metallic;
+	float roughness;
+	float ao;
+};
+
+// ------------------------------------------------------------------
+
+// Normal distribution function - Trwobridge-Reitz GGX
+float ndf_ggxtr(vec3 normal, vec3 halfway, float roughness)
+{
+	float roughness2 = roughness * roughness;
+	float roughness4 = roughness2 * roughness2;
+	float nDoth = max(dot(normal, halfway), 0.0f);
+	float nDoth2 = nDoth * nDoth;
+
+	float nom = roughness4;
+	float denom = nDoth2 * (roughness4 - 1.0f) + 1.0f;
+	denom = PI * denom * denom;
+
+	return nom / denom;
+}
+
+float ndf_ggxtr2(vec3 normal, vec3 halfway, float roughness)
+{
+	float roughness2 = roughness * roughness;
+	float nDoth = max(dot(normal, halfway), 0.0f);
+	float nDoth2 = nDoth * nDoth;
+
+	float nom = roughness2;
+	float denom = nDoth2 * (roughness2 - 1.0f) + 1.0f;
+	denom = PI * denom * denom;
+
+	return nom / denom;
+}
+
+// ------------------------------------------------------------------
+
+// Roughness remap function for dielectrics
+float roughnessRemapDielectrics(float roughness)
+{
+	float r = roughness + 1.0f;
+	return (r * r) / 8.0f;
+}
+
+// ------------------------------------------------------------------
+
+// Roughness remap function for conductors
+float roughnessRemapConductors(float roughness)
+{
+	return (roughness * roughness) / 2.0f;
+}
+
+// ------------------------------------------------------------------
+
+// Geometry function - Smith's method using SchlickGGX
+float gf_schlickggx(float dot, float remapRoughness)
+{
+	float nom = dot;
+	float denom = dot * (1.0f - remapRoughness) + remapRoughness;
+
+	return nom / denom;
+}
+
+// ------------------------------------------------------------------
+
+// Smith's method to take into account both the light direction and the view direction
+float gf_smith(vec3 normal, vec3 view, vec3 light, float remapRoughness)
+{
+	float nDotV = max(dot(normal, view), 0.0f);
+	float nDotL = max(dot(normal, light), 0.0f);
+	float schlickggx_ndotv = gf_schlickggx(nDotV, remapRoughness);
+	float schilckggx_ndotl = gf_schlickggx(nDotL, remapRoughness);
+
+	return schlickggx_ndotv * schilckggx_ndotl;
+}
+
+// ------------------------------------------------------------------
+
+// Fresnel approximation
+vec3 calculateBaseReflectivity(vec3 surfaceColor, float metalic)
+{
+	// Surface reflection at zero incidence
+	vec3 f0 = vec3(0.04f);
+	return mix(surfaceColor, surfaceColor, metalic);
+}
+
+// ------------------------------------------------------------------
+
+// Schilck's approximation
+vec3 fresnel_schilck(float cosTheta, vec3 baseReflectivity)
+{
+	return baseReflectivity + (1.0f - baseReflectivity) * pow(1.0f - cosTheta, 5.0f);
+}
+
+// ------------------------------------------------------------------
+
+// Reflected radiance of one light, Cook-Torrance specular and Lambert diffuse
+vec3 cookTorrance(PBRMaterial material, vec3 n, vec3 v, vec3 l, vec3 lightRadiance)
+{
+	// Calculate f0 - base reflectivity
+	vec3 f0 = calculateBaseReflectivity(material.color, material.metallic);
+	// Cos theta
+	float cosTheta = max(dot(n, l), 0.0f);
+	// Calculate the halfway vector
+	vec3 h = normalize(v + l);
+
+	// Fresnel, geometry and normal distribution terms
+	vec3 F = fresnel_schilck(max(dot(h, v), 0.0f), f0);
+	float GF = gf_smith(n, v, l, roughnessRemapDielectrics(material.roughness));
+	float NDF = ndf_ggxtr(n, h, material.roughness);
+	vec3 brdf = (NDF * GF * F) / (4.0f * max(dot(n, v), 0.0f) * cosTheta + 0.001f);
+
+	// Refracted light, none for metals
+	vec3 kd = (vec3(1.0f) - F) * (1.0f - material.metallic);
+	return (kd * material.color / PI + brdf) * lightRadiance * cosTheta;
+}
+
+// ------------------------------------------------------------------
\ No newline at end of file
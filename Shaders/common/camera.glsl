@@ -0,0 +1,13 @@
+// Camera uniform block, layout matches CameraUniformData
+
+layout(std140) uniform CameraData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	vec3 viewPos;
+	// Clip space to world space
+	mat4 inverseViewProjection;
+};
+
+// ------------------------------------------------------------------
\ No newline at end of file
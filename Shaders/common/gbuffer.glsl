@@ -0,0 +1,43 @@
+// G-buffer inputs of the deferred passes. With COMPACT_GBUFFER the position is rebuilt from
+// the depth buffer and the normal is octahedral encoded in two channels, the albedo and
+// the roughness, metallic and ambient occlusion channels are read the same way.
+
+#include "camera.glsl"
+#include "normalEncoding.glsl"
+
+#ifdef COMPACT_GBUFFER
+uniform sampler2D gDepth;
+#else
+uniform sampler2D gPosition;
+#endif
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedo;
+uniform sampler2D gPBR;
+
+// ------------------------------------------------------------------
+
+// World space position of the pixel
+vec3 gbufferPosition(vec2 uv)
+{
+#ifdef COMPACT_GBUFFER
+	vec4 clipPosition = vec4(vec3(uv, texture(gDepth, uv).r) * 2.0f - 1.0f, 1.0f);
+	vec4 worldPosition = inverseViewProjection * clipPosition;
+	return worldPosition.xyz / worldPosition.w;
+#else
+	return texture(gPosition, uv).rgb;
+#endif
+}
+
+// ------------------------------------------------------------------
+
+// Normal as written by the G-buffer pass
+vec3 gbufferNormal(vec2 uv)
+{
+#ifdef COMPACT_GBUFFER
+	return decodeNormal(texture(gNormal, uv).rg);
+#else
+	return texture(gNormal, uv).rgb;
+#endif
+}
+
+// ------------------------------------------------------------------
\ No newline at end of file
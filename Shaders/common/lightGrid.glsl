@@ -0,0 +1,36 @@
+// Clustered light culling, the lists are built by LightGrid. The point lights affecting a
+// fragment are read from the cluster of its screen tile and view space depth.
+
+#include "camera.glsl"
+
+uniform usamplerBuffer clusterLightGrid;
+uniform usamplerBuffer clusterLightIndices;
+// Clusters along x, y and the depth slices
+uniform ivec3 clusterCount;
+
+// ------------------------------------------------------------------
+
+// Offset and count of the point lights binned to the cluster of the fragment
+uvec2 clusterLightRange(vec2 fragCoord, vec3 worldPosition)
+{
+	// Near and far planes of the perspective projection
+	float nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+	float farPlane = projection[3][2] / (projection[2][2] + 1.0f);
+
+	// Exponential depth slices, matching LightGrid::depthSlice
+	float depth = max(-(view * vec4(worldPosition, 1.0f)).z, nearPlane);
+	int slice = min(int(log(depth / nearPlane) * float(clusterCount.z) / log(farPlane / nearPlane)), clusterCount.z - 1);
+
+	ivec2 tile = min(ivec2(fragCoord) / LIGHT_TILE_SIZE, clusterCount.xy - 1);
+	return texelFetch(clusterLightGrid, (slice * clusterCount.y + tile.y) * clusterCount.x + tile.x).rg;
+}
+
+// ------------------------------------------------------------------
+
+// Point light index of the i-th light of the cluster
+int clusterLightIndex(uvec2 lightRange, uint i)
+{
+	return int(texelFetch(clusterLightIndices, int(lightRange.x + i)).r);
+}
+
+// ------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,94 @@
+// Light types, the light uniform blocks and the point light buffer, layouts match LightData
+
+#define MAX_DIR_LIGHTS 20
+#define MAX_SPOT_LIGHTS 20
+
+// Number of lights looped over, injected by ShaderVariants
+#ifndef NUM_DIR_LIGHTS
+#define NUM_DIR_LIGHTS MAX_DIR_LIGHTS
+#endif
+
+// ------------------------------------------------------------------
+
+struct DirectionalLight
+{
+	vec3 direction;
+	vec3 color;
+	bool enabled;
+};
+
+struct PointLight
+{
+	vec3 position;
+	float range;
+	vec3 attenuation;
+	vec3 color;
+	bool enabled;
+};
+
+struct SpotLight
+{
+	vec3 position;
+	vec3 color;
+	vec3 direction;
+	float exponent;
+	float cutoff;
+	float coscutoff;
+	bool enabled;
+};
+
+// ------------------------------------------------------------------
+
+layout(std140) uniform DirectionalLightData
+{
+	DirectionalLight dirLight[MAX_DIR_LIGHTS];
+};
+
+layout(std140) uniform SpotLightData
+{
+	SpotLight spotLight[MAX_SPOT_LIGHTS];
+};
+
+// Point lights, any number of them. Three consecutive sections of one texel per light:
+// position and range, color and enabled flag, attenuation.
+uniform samplerBuffer pointLightData;
+
+int pointLightCount()
+{
+	return textureSize(pointLightData) / 3;
+}
+
+PointLight fetchPointLight(int index)
+{
+	int count = pointLightCount();
+	vec4 positionRange = texelFetch(pointLightData, index);
+	vec4 colorEnabled = texelFetch(pointLightData, count + index);
+
+	PointLight light;
+	light.position = positionRange.xyz;
+	light.range = positionRange.w;
+	light.color = colorEnabled.rgb;
+	light.enabled = colorEnabled.a != 0.0f;
+	light.attenuation = texelFetch(pointLightData, 2 * count + index).xyz;
+	return light;
+}
+
+// ------------------------------------------------------------------
+
+// Point light attenuation
+float calculateAttenuationDistance(vec3 vertexPosW, vec3 lightPosW)
+{
+	float distance = length(lightPosW - vertexPosW);
+	return 1.0f / (distance * distance);
+}
+
+// ------------------------------------------------------------------
+
+// Point light attenuation
+float calculateAttenuationQuadratic(vec3 vertexPosW, vec3 lightPosW, vec3 attenuation)
+{
+	float distance = length(lightPosW - vertexPosW);
+	return 1.0f / (attenuation.z + attenuation.y * distance + attenuation.x * (distance * distance));
+}
+
+// ------------------------------------------------------------------
\ No newline at end of file
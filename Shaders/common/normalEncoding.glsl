@@ -0,0 +1,33 @@
+// Octahedral normal encoding. The unit sphere is projected on an octahedron which is
+// unfolded into a square, so two channels hold a normal with an even precision.
+
+// ------------------------------------------------------------------
+
+vec2 signNotZero(vec2 v)
+{
+	return vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+// ------------------------------------------------------------------
+
+// Unit vector to [0, 1]^2
+vec2 encodeNormal(vec3 n)
+{
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 encoded = n.z >= 0.0f ? n.xy : (1.0f - abs(n.yx)) * signNotZero(n.xy);
+	return encoded * 0.5f + 0.5f;
+}
+
+// ------------------------------------------------------------------
+
+vec3 decodeNormal(vec2 encoded)
+{
+	encoded = encoded * 2.0f - 1.0f;
+	vec3 n = vec3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+	// Fold the lower hemisphere back
+	float t = max(-n.z, 0.0f);
+	n.xy -= signNotZero(n.xy) * t;
+	return normalize(n);
+}
+
+// ------------------------------------------------------------------
\ No newline at end of file
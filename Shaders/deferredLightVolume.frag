@@ -0,0 +1,79 @@
+#version 330 core
+
+// ------------------------------------------------------------------
+// ------------------------------------------------------------------
+
+// Shading of one point or spot light over the pixels marked by its light volume, the result
+// is added to the light accumulation target of LightVolumes
+
+// Shared light and BRDF code
+#include "common/brdf.glsl"
+#include "common/lights.glsl"
+#include "common/camera.glsl"
+#include "common/gbuffer.glsl"
+
+// ------------------------------------------------------------------
+// ------------------------------------------------------------------
+
+// Uniforms
+
+layout(std140) uniform FrameData
+{
+	vec2 textureOffset;
+	vec2 textureTile;
+	float gamma;
+	float gammaHDR;
+	float exposure;
+	float exposureBias;
+	float dispMapScale;
+	float normalMapScale;
+	int displayMode;
+	int toneMapper;
+};
+
+// Index of the light in the point light buffer or in the spot light block
+uniform int lightIndex;
+
+out vec4 color;
+
+// ------------------------------------------------------------------
+// ------------------------------------------------------------------
+
+void main()
+{
+	vec2 uv = gl_FragCoord.xy / vec2(textureSize(gNormal, 0));
+
+	// Get PBR material, as in the deferred lighting pass
+	PBRMaterial material;
+	vec3 pos = gbufferPosition(uv);
+	vec3 tempNormal = normalize(2.0f * gbufferNormal(uv) - 1.0f);
+	vec3 normal = vec3(tempNormal.x, tempNormal.y, tempNormal.z * normalMapScale);
+	vec4 pbrTemp = texture(gPBR, uv);
+	material.roughness = pbrTemp.r;
+	material.metallic = pbrTemp.g;
+	material.ao = pbrTemp.b;
+	material.color = texture(gAlbedo, uv).rgb;
+
+	vec3 viewDirection = normalize(viewPos - pos);
+
+	// --------------------------------------
+
+#ifdef SPOT_LIGHT
+	SpotLight light = spotLight[lightIndex];
+	vec3 l = normalize(light.position - pos);
+
+	// Cone falloff with inverse square attenuation. No discard outside the cone, the stencil
+	// of every marked pixel has to be reset.
+	float spotCos = dot(-l, normalize(light.direction));
+	float spotFactor = spotCos < light.coscutoff ? 0.0f : pow(max(spotCos, 0.0001f), light.exponent);
+	float attenuation = spotFactor * calculateAttenuationDistance(pos, light.position);
+#else
+	PointLight light = fetchPointLight(lightIndex);
+	vec3 l = normalize(light.position - pos);
+	float attenuation = calculateAttenuationQuadratic(pos, light.position, light.attenuation);
+#endif
+
+	color = vec4(cookTorrance(material, normal, viewDirection, l, light.color * attenuation), 1.0f);
+}
+
+// ------------------------------------------------------------------
\ No newline at end of file
@@ -3,83 +3,53 @@
 // ------------------------------------------------------------------
 // ------------------------------------------------------------------
 
-#define PI 3.1415926535897932384626433832795
-#define PI_2 1.57079632679489661923
-#define PI_4 0.785398163397448309616
-
-#define MAX_POINT_LIGHTS 20
-#define MAX_DIR_LIGHTS 20
-#define MAX_SPOT_LIGHTS 20
-
-// ----------------------------------------------------------------------------
-// ----------------------------------------------------------------------------
-
-// Struct definition
-
-struct DirectionalLight
-{
-	vec3 direction;
-	vec3 color;
-	bool enabled;
-};
-
-struct PointLight
-{
-	vec3 position;
-	vec3 attenuation;
-	vec3 color;
-	bool enabled;
-};
-
-struct SpotLight
-{
-	vec3 position;
-	vec3 color;
-	vec3 direction;
-	float exponent;
-	float cutoff;
-	float coscutoff;
-	bool enabled;
-};
-
-struct PBRMaterial
-{
-	vec3 color;
-	float metallic;
-	float roughness;
-	float ao;
-};
+// Debug display modes
+#define DISPLAY_DIFFUSE 0
+#define DISPLAY_NORMAL 1
+#define DISPLAY_NORMAL_TEX 2
+#define DISPLAY_DIRLIGHT_SHADING 3
+#define DISPLAY_POINTLIGHT_SHADING 4
+#define DISPLAY_FINAL 5
+
+// Variant definitions, injected by ShaderVariants
+#ifndef DISPLAY_MODE
+#define DISPLAY_MODE DISPLAY_FINAL
+#endif
+
+// Shared light and BRDF code
+#include "common/brdf.glsl"
+#include "common/lights.glsl"
+#include "common/camera.glsl"
+#include "common/gbuffer.glsl"
+#ifdef CLUSTERED_LIGHTING
+#include "common/lightGrid.glsl"
+#endif
 
 // ------------------------------------------------------------------
 // ------------------------------------------------------------------
 
 // Uniforms
 
-// Light information
-uniform DirectionalLight dirLight[MAX_DIR_LIGHTS];
-uniform PointLight pointLight[MAX_POINT_LIGHTS];
-uniform SpotLight spotLight[MAX_SPOT_LIGHTS];
-
-// GBuffer
-uniform sampler2D gPosition;
-uniform sampler2D gNormal;
-uniform sampler2D gAlbedo;
-uniform sampler2D gPBR;
-
-uniform float normalMapScale;
-uniform vec3 viewPos;
-uniform float gamma;
+layout(std140) uniform FrameData
+{
+	vec2 textureOffset;
+	vec2 textureTile;
+	float gamma;
+	float gammaHDR;
+	float exposure;
+	float exposureBias;
+	float dispMapScale;
+	float normalMapScale;
+	int displayMode;
+	int toneMapper;
+};
 
 uniform sampler2D shadowMap;
 
-// Debug
-uniform int displayMode;
-const int DIFFUSE = 0x00;
-const int NORMAL = 0x01;
-const int NORMAL_TEX = 0x02;
-const int DIRLIGHT_SHADING = 0x03;
-const int POINTLIGHT_SHADING = 0x04;
-const int FINAL = 0x05;
+#ifdef LIGHT_VOLUMES
+// Point and spot lights accumulated by LightVolumes
+uniform sampler2D lightAccumulation;
+#endif
 
 in vec2 uv;
 
@@ -88,114 +58,6 @@ out vec4 color;
 // ------------------------------------------------------------------
 // ------------------------------------------------------------------
 
-// Normal distribution function - Trwobridge-Reitz GGX
-float ndf_ggxtr(vec3 normal, vec3 halfway, float roughness)
-{
-	float roughness2 = roughness * roughness;
-	float roughness4 = roughness2 * roughness2;
-	float nDoth = max(dot(normal, halfway), 0.0f);
-	float nDoth2 = nDoth * nDoth;
-
-	float nom = roughness4;
-	float denom = nDoth2 * (roughness4 - 1.0f) + 1.0f;
-	denom = PI * denom * denom;
-
-	return nom / denom;
-}
-
-float ndf_ggxtr2(vec3 normal, vec3 halfway, float roughness)
-{
-	float roughness2 = roughness * roughness;
-	float nDoth = max(dot(normal, halfway), 0.0f);
-	float nDoth2 = nDoth * nDoth;
-
-	float nom = roughness2;
-	float denom = nDoth2 * (roughness2 - 1.0f) + 1.0f;
-	denom = PI * denom * denom;
-
-	return nom / denom;
-}
-
-// ------------------------------------------------------------------
-
-// Roughness remap function for dielectrics
-float roughnessRemapDielectrics(float roughness)
-{
-	float r = roughness + 1.0f;
-	return (r * r) / 8.0f;
-}
-
-// ------------------------------------------------------------------
-
-// Roughness remap function for conductors
-float roughnessRemapConductors(float roughness)
-{
-	return (roughness * roughness) / 2.0f;
-}
-
-// ------------------------------------------------------------------
-
-// Geometry function - Smith's method using SchlickGGX
-float gf_schlickggx(float dot, float remapRoughness)
-{
-	float nom = dot;
-	float denom = dot * (1.0f - remapRoughness) + remapRoughness;
-
-	return nom / denom;
-}
-
-// ------------------------------------------------------------------
-
-// Smith's method to take into account both the light direction and the view direction
-float gf_smith(vec3 normal, vec3 view, vec3 light, float remapRoughness)
-{
-	float nDotV = max(dot(normal, view), 0.0f);
-	float nDotL = max(dot(normal, light), 0.0f);
-	float schlickggx_ndotv = gf_schlickggx(nDotV, remapRoughness);
-	float schilckggx_ndotl = gf_schlickggx(nDotL, remapRoughness);
-
-	return schlickggx_ndotv * schilckggx_ndotl;
-}
-
-// ------------------------------------------------------------------
-
-// Fresnel approximation
-vec3 calculateBaseReflectivity(vec3 surfaceColor, float metalic)
-{
-	// Surface reflection at zero incidence
-	vec3 f0 = vec3(0.04f);
-	return mix(surfaceColor, surfaceColor, metalic);
-}
-
-// ------------------------------------------------------------------
-
-// Schilck's approximation
-vec3 fresnel_schilck(float cosTheta, vec3 baseReflectivity)
-{
-	return baseReflectivity + (1.0f - baseReflectivity) * pow(1.0f - cosTheta, 5.0f);
-}
-
-// ------------------------------------------------------------------
-// ------------------------------------------------------------------
-
-// Point light attenuation
-float calculateAttenuationDistance(vec3 vertexPosW, vec3 lightPosW)
-{
-	float distance = length(lightPosW - vertexPosW);
-	return 1.0f / (distance * distance);
-}
-
-// ------------------------------------------------------------------
-
-// Point light attenuation
-float calculateAttenuationQuadratic(vec3 vertexPosW, vec3 lightPosW, vec3 attenuation)
-{
-	float distance = length(lightPosW - vertexPosW);
-	return 1.0f / (attenuation.z + attenuation.y * distance + attenuation.x * (distance * distance));
-}
-
-// ------------------------------------------------------------------
-
 vec4 pbrShadingPoint(PBRMaterial material, vec3 pos, vec3 normal, vec3 viewDirection)
 {
 	vec3 totalAmbient = vec3(0.0f, 0.0f, 0.0f);
@@ -209,21 +71,31 @@ vec4 pbrShadingPoint(PBRMaterial material, vec3 pos, vec3 normal, vec3 viewDirec
 	// Calculate f0 - base reflectivity
 	vec3 f0 = calculateBaseReflectivity(material.color, material.metallic);
 
-	for (int i = 0; i < MAX_POINT_LIGHTS; ++i)
+#ifdef CLUSTERED_LIGHTING
+	// Only the lights touching the cluster
+	uvec2 clusterLights = clusterLightRange(gl_FragCoord.xy, pos);
+	for (uint clusterLight = 0u; clusterLight < clusterLights.y; ++clusterLight)
+	{
+		PointLight light = fetchPointLight(clusterLightIndex(clusterLights, clusterLight));
+#else
+	int lightCount = pointLightCount();
+	for (int i = 0; i < lightCount; ++i)
 	{
-		if (pointLight[i].enabled == false) continue;
+		PointLight light = fetchPointLight(i);
+		if (light.enabled == false) continue;
+#endif
 
 		// Use light position in world space
-		vec3 lightPosWS = pointLight[i].position;
+		vec3 lightPosWS = light.position;
 
 		// Point light direction
 		vec3 l = normalize(lightPosWS - pos);
 		// Calculate attenuation
-		float attenuation = calculateAttenuationQuadratic(pos, lightPosWS, pointLight[i].attenuation);
+		float attenuation = calculateAttenuationQuadratic(pos, lightPosWS, light.attenuation);
 		// Cos theta
 		float cosTheta = max(dot(n, l), 0.0f);
 		// Calculate radiance
-		vec3 radiance = pointLight[i].color * attenuation * cosTheta;
+		vec3 radiance = light.color * attenuation * cosTheta;
 		// Calculate the halfway vector
 		vec3 h = normalize(v + l);
 
@@ -257,6 +129,18 @@ vec4 pbrShadingPoint(PBRMaterial material, vec3 pos, vec3 normal, vec3 viewDirec
 
 // ------------------------------------------------------------------
 
+// Point lights shaded here or the light accumulated by the light volumes
+vec4 pbrShadingLocal(PBRMaterial material, vec3 pos, vec3 normal, vec3 viewDirection)
+{
+#ifdef LIGHT_VOLUMES
+	return vec4(texture(lightAccumulation, uv).rgb, 1.0f);
+#else
+	return pbrShadingPoint(material, pos, normal, viewDirection);
+#endif
+}
+
+// ------------------------------------------------------------------
+
 vec4 pbrShadingDir(PBRMaterial material, vec3 normal, vec3 viewDirection)
 {
 	vec3 totalAmbient = vec3(0.0f, 0.0f, 0.0f);
@@ -274,7 +158,7 @@ vec4 pbrShadingDir(PBRMaterial material, vec3 normal, vec3 viewDirection)
 	vec3 f0 = calculateBaseReflectivity(material.color, material.metallic);
 	//return vec4(f0, 1.0f);
 
-	for (int i = 0; i < MAX_DIR_LIGHTS; ++i)
+	for (int i = 0; i < NUM_DIR_LIGHTS; ++i)
 	{
 		if (dirLight[i].enabled == false) continue;
 
@@ -339,13 +223,13 @@ void main()
 	PBRMaterial material;
 	color = vec4(0.0f, 0.0f, 0.0f, 1.0f);
 
-	vec3 fragPosWS = texture(gPosition, uv).rgb;
+	vec3 fragPosWS = gbufferPosition(uv);
 	vec3 viewDirectionWS = normalize(viewPos - fragPosWS);
 	
 	// --------------------------------------
 
 	// Get PBR material
-	vec3 tempNormal = normalize(2.0f * texture(gNormal, uv).rgb - 1.0f);
+	vec3 tempNormal = normalize(2.0f * gbufferNormal(uv) - 1.0f);
 	vec3 normal = vec3(tempNormal.x, tempNormal.y, tempNormal.z * normalMapScale);
 	vec4 pbrTemp = texture(gPBR, uv);
 	material.roughness = pbrTemp.r;
@@ -361,34 +245,23 @@ void main()
 
 	// --------------------------------------
 
-	// Calculate lighting
-	// Debug
-	switch (displayMode)
-	{
-		case DIFFUSE:
-			color = vec4(material.color, 1.0f);
-			break;
-		case NORMAL:
-			color = vec4(normal, 1.0f);
-			break;
-		case NORMAL_TEX:
-			color = vec4(normal, 1.0f);
-			break;
-		case DIRLIGHT_SHADING:
-			color += pbrShadingDir(material, normal, viewDirectionWS);
-			break;
-		case POINTLIGHT_SHADING:
-			color += pbrShadingPoint(material, fragPosWS, normal, viewDirectionWS);
-			break;
-		case FINAL:
-		{
-			color += pbrShadingDir(material, normal, viewDirectionWS);
-			color += pbrShadingPoint(material, fragPosWS, normal, viewDirectionWS);
-			break;
-		}
-		default:
-			color = vec4(0.0f, 0.0f, 1.0f, 1.0f);
-	}
+	// Calculate lighting, the display mode is selected at compile time
+#if DISPLAY_MODE == DISPLAY_DIFFUSE
+	color = vec4(material.color, 1.0f);
+#elif DISPLAY_MODE == DISPLAY_NORMAL
+	color = vec4(normal, 1.0f);
+#elif DISPLAY_MODE == DISPLAY_NORMAL_TEX
+	color = vec4(normal, 1.0f);
+#elif DISPLAY_MODE == DISPLAY_DIRLIGHT_SHADING
+	color += pbrShadingDir(material, normal, viewDirectionWS);
+#elif DISPLAY_MODE == DISPLAY_POINTLIGHT_SHADING
+	color += pbrShadingLocal(material, fragPosWS, normal, viewDirectionWS);
+#elif DISPLAY_MODE == DISPLAY_FINAL
+	color += pbrShadingDir(material, normal, viewDirectionWS);
+	color += pbrShadingLocal(material, fragPosWS, normal, viewDirectionWS);
+#else
+	color = vec4(0.0f, 0.0f, 1.0f, 1.0f);
+#endif
 
 	// --------------------------------------
 
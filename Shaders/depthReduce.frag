@@ -0,0 +1,30 @@
+#version 330 core
+
+// Conservative downsample of the depth buffer: every output texel keeps the
+// farthest depth of the REDUCTION_FACTOR x REDUCTION_FACTOR block it covers
+
+const int REDUCTION_FACTOR = 4;
+
+in vec2 UV;
+
+out float maxDepth;
+
+uniform sampler2D depthTexture;
+
+void main()
+{
+	ivec2 depthSize = textureSize(depthTexture, 0);
+	ivec2 base = ivec2(gl_FragCoord.xy) * REDUCTION_FACTOR;
+
+	float result = 0.0f;
+	for (int y = 0; y < REDUCTION_FACTOR; y++)
+	{
+		for (int x = 0; x < REDUCTION_FACTOR; x++)
+		{
+			ivec2 texel = min(base + ivec2(x, y), depthSize - ivec2(1));
+			result = max(result, texelFetch(depthTexture, texel, 0).r);
+		}
+	}
+
+	maxDepth = result;
+}
\ No newline at end of file
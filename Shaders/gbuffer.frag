@@ -1,9 +1,18 @@
 #version 330 core
 
+#ifdef COMPACT_GBUFFER
+// No position, the lighting passes rebuild it from the depth
+#include "common/normalEncoding.glsl"
+
+layout (location = 0) out vec2 gNormal;
+layout (location = 1) out vec4 gAlbedo;
+layout (location = 2) out vec4 gPBR;
+#else
 layout (location = 0) out vec3 gPosition;
 layout (location = 1) out vec3 gNormal;
 layout (location = 2) out vec4 gAlbedo;
 layout (location = 3) out vec3 gPBR;
+#endif
 
 in VS_OUT
 {
@@ -12,12 +21,23 @@ in VS_OUT
     mat3 tbn;
 } fs_in;
 
-uniform float dispMapScale;
-uniform vec2 textureOffset;
-uniform vec2 textureTile;
-uniform vec3 viewPos;
+layout(std140) uniform FrameData
+{
+	vec2 textureOffset;
+	vec2 textureTile;
+	float gamma;
+	float gammaHDR;
+	float exposure;
+	float exposureBias;
+	float dispMapScale;
+	float normalMapScale;
+	int displayMode;
+	int toneMapper;
+};
+
+// Camera matrices shared by all the programs
+#include "common/camera.glsl"
 
-uniform mat4 normalMat;
 uniform sampler2D diffuseTexture1;
 uniform sampler2D displacementTexture;
 uniform sampler2D normalTexture1;
@@ -144,16 +164,24 @@ void main()
 		texCoordParallax = texCoord;
 	}
 
-	// Fragment position
-	gPosition = fs_in.wsPosition;
 	// Normal
 	vec4 normal = texture(normalTexture1, texCoordParallax);
+#ifdef COMPACT_GBUFFER
+	gNormal = encodeNormal(normalize(fs_in.tbn * normal.rgb));
+#else
+	// Fragment position
+	gPosition = fs_in.wsPosition;
 	gNormal = normalize(fs_in.tbn * normal.rgb);
+#endif
 	// Albedo
 	gAlbedo = texture(diffuseTexture1, texCoordParallax);
 	// PBR - contains rough, metal, ao
 	float roughness = texture(roughnessTexture, texCoordParallax).r;
 	float metalness = texture(metalnessTexture, texCoordParallax).r;
 	float ao = texture(aoTexture, texCoordParallax).r;
+#ifdef COMPACT_GBUFFER
+	gPBR = vec4(roughness, metalness, ao, 0.0f);
+#else
 	gPBR = vec3(roughness, metalness, ao);
+#endif
 }
\ No newline at end of file
@@ -12,10 +12,14 @@ out VS_OUT
     mat3 tbn;
 } vs_out;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform mat4 normalMat;
+layout(std140) uniform ObjectData
+{
+	mat4 model;
+	mat4 normalMat;
+};
+
+// Camera matrices shared by all the programs
+#include "common/camera.glsl"
 
 void calculateTNBMatrix()
 {
@@ -37,6 +41,6 @@ void main()
 	vec4 wsPosition = model * vec4(vertexPosition, 1.0f);
 	vs_out.wsPosition = wsPosition.xyz;
 	vs_out.uv = vertexTexCoord;
-	gl_Position = projection * view * wsPosition;
+	gl_Position = viewProjection * wsPosition;
     calculateTNBMatrix();
 }
\ No newline at end of file
@@ -0,0 +1,44 @@
+#version 330 core
+
+layout(location = 0) in vec3 vertexPosition;
+layout(location = 1) in vec3 vertexNormal;
+layout(location = 2) in vec2 vertexTexCoord;
+layout(location = 3) in vec3 vertexTangent;
+
+// Per instance data (InstanceData)
+layout(location = 5) in mat4 instanceModel;
+layout(location = 9) in mat4 instanceNormalMat;
+
+out VS_OUT
+{
+    vec3 wsPosition;
+    vec2 uv;
+    mat3 tbn;
+} vs_out;
+
+// Camera matrices shared by all the programs
+#include "common/camera.glsl"
+
+void calculateTNBMatrix()
+{
+	// Transform the normal, tangent and calculate binormals
+	vec3 n = normalize(mat3(instanceNormalMat) * vertexNormal);
+	vec3 t = normalize(mat3(instanceNormalMat) * vertexTangent);
+	
+	// Make sure the t and n vectors are orthogonal
+	t = normalize(t - dot(t, n) * n);
+	
+	vec3 b = normalize(cross(t, n)); // Order important
+	
+	// Create the TBN matrix
+	vs_out.tbn = mat3(t, b, n);
+}
+
+void main()
+{
+	vec4 wsPosition = instanceModel * vec4(vertexPosition, 1.0f);
+	vs_out.wsPosition = wsPosition.xyz;
+	vs_out.uv = vertexTexCoord;
+	gl_Position = viewProjection * wsPosition;
+    calculateTNBMatrix();
+}
\ No newline at end of file
@@ -5,11 +5,22 @@ in vec2 UV;
 out vec4 color;
 
 uniform sampler2D renderedTexture;
-uniform float gammaHDR;
-uniform float exposure;
-uniform float exposureBias;
 
-uniform int toneMapper;
+layout(std140) uniform FrameData
+{
+	vec2 textureOffset;
+	vec2 textureTile;
+	float gamma;
+	float gammaHDR;
+	float exposure;
+	float exposureBias;
+	float dispMapScale;
+	float normalMapScale;
+	int displayMode;
+	int toneMapper;
+};
+
+// Tone mappers
 const int NORMAL = 0x00;
 const int REINHARD = 0x01;
 const int EXPOSURE_TONE_MAP = 0x02;
@@ -0,0 +1,15 @@
+#version 330 core
+
+// Light volume proxy, a unit sphere or cone placed over the light by LightVolumes
+
+layout(location = 0) in vec3 vertexPosition;
+
+#include "common/camera.glsl"
+
+// Proxy to world space
+uniform mat4 volumeModel;
+
+void main()
+{
+	gl_Position = viewProjection * volumeModel * vec4(vertexPosition, 1.0f);
+}
\ No newline at end of file
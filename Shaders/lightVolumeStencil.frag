@@ -0,0 +1,7 @@
+#version 330 core
+
+// Stencil marking pass of the light volumes, no color is written
+
+void main()
+{
+}
\ No newline at end of file
@@ -16,11 +16,14 @@ out VS_OUT
 	vec3 fragmentPosTangent;
 } vs_out;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform mat4 normalMat;
-uniform vec3 viewPos;
+layout(std140) uniform ObjectData
+{
+	mat4 model;
+	mat4 normalMat;
+};
+
+// Camera matrices shared by all the programs
+#include "common/camera.glsl"
 
 void calculateTNBMatrix()
 {
@@ -40,7 +43,7 @@ void calculateTNBMatrix()
 void main()
 {
 	// Calculate fragment position in screen space
-	gl_Position = projection * view * model * vec4(vertexPosition, 1.0f);
+	gl_Position = viewProjection * model * vec4(vertexPosition, 1.0f);
 	
 	// Calculate vertex position in world coordinates
 	vs_out.vertexW 	= vec3(model * vec4(vertexPosition, 1.0f));
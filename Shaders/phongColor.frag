@@ -8,7 +8,10 @@ in vec3 vNorm;
 uniform vec3 lightDir;
 uniform vec3 lightColor;
 uniform vec4 objectColor;
-uniform vec3 viewPos;
+
+// Camera matrices shared by all the programs
+#include "common/camera.glsl"
+
 uniform float shininess;
 uniform float specularStrength;
 
@@ -6,15 +6,19 @@ layout (location = 1) in vec3 vNormal;
 out vec3 vPosWorld;
 out vec3 vNorm;
 
-uniform mat4 model;
-uniform mat4 normalMat;
-uniform mat4 view;
-uniform mat4 projection;
+layout(std140) uniform ObjectData
+{
+	mat4 model;
+	mat4 normalMat;
+};
+
+// Camera matrices shared by all the programs
+#include "common/camera.glsl"
 
 void main()
 {
 	vPosWorld = vec3(model * vec4(vPos, 1.0f));
 	vNorm = vec3(normalMat * vec4(vNormal, 0.0f));
 
-	gl_Position = projection * view * vec4(vPosWorld, 1.0);
+	gl_Position = viewProjection * vec4(vPosWorld, 1.0);
 }
\ No newline at end of file
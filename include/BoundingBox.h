@@ -0,0 +1,69 @@
+#ifndef BOUNDINGBOX_H
+#define BOUNDINGBOX_H
+
+// ----------------------------------------------------------------------------
+
+#include <float.h>
+
+#include <glm/glm.hpp>
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+
+// ----------------------------------------------------------------------------
+
+// Axis aligned bounding box. Default constructed boxes are empty and grow with expand().
+struct BoundingBox
+{
+	glm::vec3 min;
+	glm::vec3 max;
+
+	BoundingBox()
+		: min(FLT_MAX), max(-FLT_MAX) {}
+	BoundingBox(const glm::vec3& boxMin, const glm::vec3& boxMax)
+		: min(boxMin), max(boxMax) {}
+
+	inline bool empty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+
+	inline glm::vec3 center() const { return (min + max) * 0.5f; }
+	inline glm::vec3 extents() const { return (max - min) * 0.5f; }
+
+	inline float surfaceArea() const
+	{
+		glm::vec3 size = max - min;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	inline bool contains(const BoundingBox& box) const
+	{
+		return box.min.x >= min.x && box.min.y >= min.y && box.min.z >= min.z &&
+			box.max.x <= max.x && box.max.y <= max.y && box.max.z <= max.z;
+	}
+
+	inline void expand(const glm::vec3& point) { min = glm::min(min, point); max = glm::max(max, point); }
+	inline void expand(const BoundingBox& box) { min = glm::min(min, box.min); max = glm::max(max, box.max); }
+
+	inline bool operator==(const BoundingBox& box) const { return min == box.min && max == box.max; }
+	inline bool operator!=(const BoundingBox& box) const { return !(*this == box); }
+
+	static inline BoundingBox merge(const BoundingBox& a, const BoundingBox& b) { return BoundingBox(glm::min(a.min, b.min), glm::max(a.max, b.max)); }
+
+	// Box enclosing the transformed box (Arvo) - the extents are projected on the absolute matrix axes
+	inline BoundingBox transformed(const glm::mat4& matrix) const
+	{
+		if (empty())
+			return *this;
+
+		glm::vec3 newCenter = glm::vec3(matrix * glm::vec4(center(), 1.0f));
+		glm::vec3 boxExtents = extents();
+		glm::vec3 newExtents =
+			glm::abs(glm::vec3(matrix[0])) * boxExtents.x +
+			glm::abs(glm::vec3(matrix[1])) * boxExtents.y +
+			glm::abs(glm::vec3(matrix[2])) * boxExtents.z;
+
+		return BoundingBox(newCenter - newExtents, newCenter + newExtents);
+	}
+};
+
+// ----------------------------------------------------------------------------
+
+#endif // BOUNDINGBOX_H
@@ -0,0 +1,78 @@
+#ifndef DEPTHPYRAMID_H
+#define DEPTHPYRAMID_H
+
+// ----------------------------------------------------------------------------
+
+#include "Common.h"
+
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+
+#include "BoundingBox.h"
+#include "Framebuffer.h"
+#include "Shader.h"
+
+// ----------------------------------------------------------------------------
+
+// CPU side hierarchical Z buffer built from the G-buffer depth. The depth is reduced on the
+// GPU (farthest depth of every 4x4 block) and read back asynchronously through two pixel
+// buffers, so the pyramid used for the tests is one frame old. Boxes are projected with the
+// view projection matrix of the frame which produced the depth.
+class DepthPyramid
+{
+public:
+	// Must match REDUCTION_FACTOR in depthReduce.frag
+	static const GLsizei REDUCTION_FACTOR = 4;
+
+	DepthPyramid();
+	~DepthPyramid();
+
+	DepthPyramid(const DepthPyramid&) = delete;
+	DepthPyramid& operator=(const DepthPyramid&) = delete;
+
+	bool initialize(GLsizei depthWidth, GLsizei depthHeight);
+
+	// Collect the read back started by the previous capture, then reduce depthTexture and start
+	// reading it back. viewProjection is the matrix the depth was rendered with.
+	void capture(GLuint depthTexture, GLuint quadVAO, const glm::mat4& viewProjection);
+
+	// True if the box is behind the stored depth everywhere it covers on screen
+	bool isOccluded(const BoundingBox& box) const;
+
+	inline bool valid() const { return m_valid; }
+	inline size_t levelCount() const { return m_levelList.size(); }
+
+private:
+	struct Level
+	{
+		GLsizei width = 0;
+		GLsizei height = 0;
+		std::vector<float> depth;
+	};
+
+	// Max reduce every level from the previous one
+	void buildLevels();
+	float maxDepth(const Level& level, int minX, int minY, int maxX, int maxY) const;
+
+	Shader m_reduceShader;
+	Framebuffer m_reduceFramebuffer;
+
+	// Double buffered asynchronous read back
+	GLuint m_pixelBuffers[2];
+	bool m_pending[2];
+	glm::mat4 m_pendingViewProjection[2];
+	unsigned int m_frameIndex;
+
+	// Size of the source depth buffer
+	GLsizei m_depthWidth;
+	GLsizei m_depthHeight;
+
+	std::vector<Level> m_levelList;
+	glm::mat4 m_viewProjection;
+	bool m_valid;
+};
+
+// ----------------------------------------------------------------------------
+
+#endif // DEPTHPYRAMID_H
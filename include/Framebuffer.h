@@ -2,6 +2,7 @@
 #define FRAMEBUFFER_H
 
 #include "Common.h"
+#include "GLState.h"
 #include <map>
 #include <vector>
 #include <assert.h>
@@ -23,13 +24,14 @@ public:
 	Framebuffer &initialize(GLsizei width, GLsizei height);
 	bool create();
 	Framebuffer &addColorTarget(const std::string &rtName, GLint internalFormat, GLenum elementFormat, GLenum elementType);
+	// Depth stencil formats (GL_DEPTH24_STENCIL8) also attach the stencil buffer
 	Framebuffer &addDepthTarget(GLint internalFormat, GLsizei width = 0, GLsizei height = 0, bool readDepth = true);
 
 	void renderToTexture(RenderTargetType targetType = RenderTargetType::COLOR_TARGET, bool clear = true);
 	void renderColorTargetToScreen(int x, int y, int width, int height, GLuint textureUnit);
 	void renderDepthTargetToScreen(int x, int y, int width, int height, GLuint textureUnit);
-	inline void set() const { glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferHandle); }
-	inline void unset() const { glBindFramebuffer(GL_FRAMEBUFFER, 0); }
+	inline void set() const { GLState::Instance().bindFramebuffer(GL_FRAMEBUFFER, m_framebufferHandle); }
+	inline void unset() const { GLState::Instance().bindFramebuffer(GL_FRAMEBUFFER, 0); }
 
 	// Getters/setters
 	inline const GLsizei width() const { return m_width; }
@@ -55,6 +57,7 @@ private:
 
 	bool m_depthEnabled = false;
 	bool m_readDepth = false;
+	bool m_stencilEnabled = false;
 
 	GLuint m_depthTexture;
 	
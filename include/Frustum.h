@@ -0,0 +1,68 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+// ----------------------------------------------------------------------------
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include "BoundingBox.h"
+
+// ----------------------------------------------------------------------------
+
+// View frustum described by 6 normalized planes (inside when dot(plane.xyz, p) + plane.w >= 0).
+// Extracted from a combined matrix, so proj * view * model yields the planes in model space.
+class Frustum
+{
+public:
+
+	enum class Plane
+	{
+		Left = 0,
+		Right,
+		Bottom,
+		Top,
+		Near,
+		Far,
+
+		Count,
+	};
+
+	enum class Intersection
+	{
+		Outside = 0,
+		Intersecting,
+		Inside,
+	};
+
+	Frustum();
+	Frustum(const glm::mat4& matrix);
+
+	void update(const glm::mat4& matrix);
+
+	// Returns false only if the sphere is completely outside one of the planes
+	bool intersectsSphere(const glm::vec3& center, float radius) const;
+	// Classify the box against all the planes at once (SSE when available)
+	Intersection testBox(const BoundingBox& box) const;
+
+	inline const glm::vec4& plane(Plane plane) const { return m_planes[static_cast<int>(plane)]; }
+
+private:
+	void updatePlaneBatches();
+
+	// Planes padded to 8 so they can be tested 4 at a time
+	static const int PLANE_BATCH_SIZE = 8;
+
+	glm::vec4 m_planes[static_cast<int>(Plane::Count)];
+
+	// Structure of arrays copy of the planes
+	alignas(16) float m_planeX[PLANE_BATCH_SIZE];
+	alignas(16) float m_planeY[PLANE_BATCH_SIZE];
+	alignas(16) float m_planeZ[PLANE_BATCH_SIZE];
+	alignas(16) float m_planeW[PLANE_BATCH_SIZE];
+};
+
+// ----------------------------------------------------------------------------
+
+#endif // FRUSTUM_H
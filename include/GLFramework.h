@@ -7,6 +7,10 @@
 #include "Model.h"
 #include "TextureMan.h"
 #include "Object.h"
+#include "InstanceBatch.h"
+#include "UniformBuffer.h"
+#include "DepthPyramid.h"
+#include "ShaderVariants.h"
 
 class GUI;
 class Camera;
@@ -23,9 +27,23 @@ public:
 
 	virtual bool initialize(const char* windowTitle, bool enableMultisampling, bool enableSRGB);
 
+	// Compact G-buffer layout: position rebuilt from the depth, octahedral normal in RG16 and
+	// the material in RGBA8. Must be set before initialize.
+	inline void setCompactGbuffer(bool enabled) { m_compactGbuffer = enabled; }
+
 private:
 	virtual bool setupScene();
 	virtual void drawScene(double dt);
+	void updateCameraUniforms();
+	void updateFrameUniforms();
+	// Display mode, light counts and light culling compiled into the lighting programs
+	ShaderDefines lightingDefines() const;
+	// G-buffer layout of the programs writing and reading it
+	ShaderDefines gbufferDefines() const;
+	// Lighting defines plus the G-buffer layout and the light volumes of the deferred pass
+	ShaderDefines deferredLightingDefines() const;
+	// Bind the point lights and the cluster lists of the lighting programs
+	void bindLights(const Shader& shader) const;
 	void drawToGBuffer(double dt);
 	void drawDeferredLighting(double dt);
 	void drawForwardLighting(double dt);
@@ -53,6 +71,14 @@ private:
 	Framebuffer m_displayFramebuffer;
 	Framebuffer m_shadowFramebuffer;
 	Framebuffer m_gbufferFramebuffer;
+	bool m_compactGbuffer = false;
+
+	// Camera matrices and render settings shared by all the programs, updated once per frame
+	UniformBuffer m_cameraUniformBuffer;
+	UniformBuffer m_frameUniformBuffer;
+
+	// Hierarchical Z built from the g buffer depth for occlusion culling
+	DepthPyramid m_depthPyramid;
 
 	// CameraMan reference
 	const CameraMan& m_cameraMan;
@@ -60,7 +86,8 @@ private:
 #pragma region Shaders
 
 	Shader m_debugSolidColor, m_basicShader, m_finalShader, m_phongColorShader, m_phongTextureShader, m_parallaxMapping, m_normalMapping;
-	Shader m_colorPBR, m_pbr, m_depth, m_skyBox, m_gbuffer, m_quadShader, m_quadDepthShader, m_deferredLighting;
+	Shader m_colorPBR, m_depth, m_skyBox, m_gbuffer, m_gbufferInstanced, m_quadShader, m_quadDepthShader;
+	ShaderVariants m_pbr, m_deferredLighting;
 
 #pragma endregion // Shaders
 
@@ -128,6 +155,9 @@ private:
 	std::unique_ptr<Object<VertexPNTT>> m_planeObjectDeferred;
 	std::unique_ptr<Object<VertexPNTT>> m_torusModelDeferred;
 
+	// Instanced rock field
+	std::unique_ptr<InstanceBatch<VertexPNTT>> m_rockBatch;
+
 #pragma endregion // Models/Objects
 	
 };
@@ -0,0 +1,106 @@
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+// ----------------------------------------------------------------------------
+
+#include "Common.h"
+
+#include <unordered_map>
+
+// ----------------------------------------------------------------------------
+
+// Calls sent to the driver and calls skipped because the state was already current
+struct GLStateStats
+{
+	GLuint issuedCount = 0;
+	GLuint elidedCount = 0;
+};
+
+// ----------------------------------------------------------------------------
+
+// Shadow copy of the OpenGL state changed by the framework. Every bind goes through here so
+// calls setting the value already current are skipped. Code changing the state behind its
+// back (third party libraries) has to be followed by invalidate().
+class GLState
+{
+private:
+	GLState(void);
+	~GLState(void);
+
+public:
+	static const GLuint MAX_TEXTURE_UNITS = 32;
+
+	// Static access function
+	static GLState& Instance()
+	{
+		static GLState refInstance;
+		return refInstance;
+	}
+
+	// Forget the shadowed state, the next call of every kind is issued
+	void invalidate();
+
+	void useProgram(GLuint program);
+	void bindVertexArray(GLuint vertexArrayObject);
+	// GL_FRAMEBUFFER binds both the read and the draw framebuffer
+	void bindFramebuffer(GLenum target, GLuint framebuffer);
+	void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+	void depthFunc(GLenum function);
+	void depthMask(GLboolean mask);
+	void enable(GLenum capability);
+	void disable(GLenum capability);
+
+	// Texture unit index, not GL_TEXTUREi
+	void activeTexture(GLuint unit);
+	// Bind on the active texture unit
+	void bindTexture(GLenum target, GLuint texture);
+	// Bind on the given unit, the active unit only changes if the binding does
+	void bindTexture(GLuint unit, GLenum target, GLuint texture);
+
+	inline GLuint program() const { return m_program; }
+	inline GLuint vertexArray() const { return m_vertexArray; }
+	GLuint boundTexture(GLuint unit, GLenum target) const;
+
+	inline void resetStats() { m_stats = GLStateStats(); }
+	inline const GLStateStats& stats() const { return m_stats; }
+
+private:
+	// Value used for state which is not known
+	static const GLuint UNKNOWN = ~0u;
+
+	// Tracked texture targets
+	enum class TextureTarget
+	{
+		Texture2D = 0,
+		CubeMap,
+		TextureBuffer,
+
+		Count,
+	};
+
+	static int textureTargetIndex(GLenum target);
+
+	inline void issued() { m_stats.issuedCount++; }
+	inline void elided() { m_stats.elidedCount++; }
+
+	GLuint m_program;
+	GLuint m_vertexArray;
+	GLuint m_readFramebuffer;
+	GLuint m_drawFramebuffer;
+	GLint m_viewport[4];
+
+	GLenum m_depthFunc;
+	GLuint m_depthMask;
+	// Enabled state of the capabilities, missing entries are unknown
+	std::unordered_map<GLenum, bool> m_capabilities;
+
+	GLuint m_activeTexture;
+	GLuint m_textures[MAX_TEXTURE_UNITS][static_cast<int>(TextureTarget::Count)];
+
+	GLStateStats m_stats;
+};
+
+// ----------------------------------------------------------------------------
+
+#endif // GLSTATE_H
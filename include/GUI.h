@@ -19,10 +19,12 @@ private:
 	void drawGbufferSettings();
 	void drawLightPanel();
 	void updateLightSourcesList();
+	// Scatter count short range point lights over the scene
+	void addTestPointLights(unsigned int count);
 	void updateAssetList();
-	void drawDirLightSettings(DirectionalLight &dirLight);
-	void drawPointLightSettings(PointLight &pointLight);
-	void drawSpotLightSettings(SpotLight &spotLight);
+	void drawDirLightSettings(LightHandle lightHandle);
+	void drawPointLightSettings(LightHandle lightHandle);
+	void drawSpotLightSettings(LightHandle lightHandle);
 	void drawObjectSettings();
 	void expandDirectory(const std::filesystem::directory_entry &dirEntry);
 
@@ -143,6 +145,7 @@ public:
 	glm::vec3 m_clearColor = glm::vec3(0.2f, 0.2f, 0.2f);
 	GLFWwindow *m_window = nullptr;
 	bool m_enableVsync = true;
+	bool m_enableInstancedRocks = false;
 
 	int m_framebufferWidth, m_framebufferHeight;
 
@@ -0,0 +1,67 @@
+#ifndef GEOMETRYMAN_H
+#define GEOMETRYMAN_H
+
+// ----------------------------------------------------------------------------
+
+#include <map>
+#include <memory>
+#include <string>
+#include <typeindex>
+#include <utility>
+
+#include "Model.h"
+
+// ----------------------------------------------------------------------------
+
+class GeometryMan
+{
+private:
+	GeometryMan(void);
+	~GeometryMan(void);
+
+public:
+
+	// Static access function
+	static GeometryMan& Instance()
+	{
+		static GeometryMan refInstance;
+		return refInstance;
+	}
+
+	// Returns the model loaded from the path with the vertex layout T, importing and
+	// uploading it only the first time. All the callers share the same GPU buffers.
+	template<class T>
+	std::shared_ptr<Model<T>> getModel(const std::string& modelPath);
+
+	inline size_t modelCount() const { return m_modelMap.size(); }
+
+private:
+
+	// Models are cached per path and vertex layout
+	typedef std::pair<std::string, std::type_index> ModelKey;
+
+	std::map<ModelKey, std::shared_ptr<void>> m_modelMap;
+};
+
+// ----------------------------------------------------------------------------
+
+template<class T>
+std::shared_ptr<Model<T>> GeometryMan::getModel(const std::string& modelPath)
+{
+	ModelKey modelKey(modelPath, std::type_index(typeid(T)));
+
+	// Look for the model
+	auto model = m_modelMap.find(modelKey);
+	if (model != m_modelMap.end())
+		return std::static_pointer_cast<Model<T>>(model->second);
+
+	// Load model
+	auto newModel = std::make_shared<Model<T>>(modelPath);
+	m_modelMap[modelKey] = newModel;
+
+	return newModel;
+}
+
+// ----------------------------------------------------------------------------
+
+#endif // GEOMETRYMAN_H
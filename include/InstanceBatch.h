@@ -0,0 +1,152 @@
+#ifndef INSTANCEBATCH_H
+#define INSTANCEBATCH_H
+
+// ----------------------------------------------------------------------------
+
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/mat4x4.hpp>
+
+#include "GeometryMan.h"
+#include "Transform.h"
+#include "Shader.h"
+
+// ----------------------------------------------------------------------------
+
+// Objects sharing a model and a shader, drawn with one instanced draw call per submesh.
+// The shader reads the model and normal matrices from the InstanceData vertex attributes.
+// For static sets of copies drawn outside the render queue, which groups its own items.
+template<class T>
+class InstanceBatch
+{
+public:
+	InstanceBatch(const std::string& filePath);
+	InstanceBatch(const std::shared_ptr<Model<T>>& model);
+	~InstanceBatch();
+
+	InstanceBatch(const InstanceBatch&) = delete;
+	InstanceBatch& operator=(const InstanceBatch&) = delete;
+
+	void add(const glm::mat4& modelMat);
+	void add(const glm::mat4& modelMat, const glm::mat4& normalMat);
+	inline void add(const Transform& transform) { add(transform.modelMat(), transform.normalMat()); }
+	void clear();
+
+	void render(Shader &shader);
+
+	inline size_t instanceCount() const { return m_instanceList.size(); }
+	inline const std::shared_ptr<Model<T>> &model() const { return m_model; }
+
+private:
+	void uploadInstances();
+
+	std::shared_ptr<Model<T>> m_model;
+
+	std::vector<InstanceData> m_instanceList;
+	GLuint m_instanceBuffer;
+	// Size of the buffer storage in instances
+	size_t m_instanceCapacity;
+	bool m_dirty;
+};
+
+// ----------------------------------------------------------------------------
+
+template<class T>
+InstanceBatch<T>::InstanceBatch(const std::string& filePath)
+	: InstanceBatch(GeometryMan::Instance().getModel<T>(filePath))
+{
+}
+
+// ----------------------------------------------------------------------------
+
+template<class T>
+InstanceBatch<T>::InstanceBatch(const std::shared_ptr<Model<T>>& model)
+	: m_model(model), m_instanceBuffer(0), m_instanceCapacity(0), m_dirty(false)
+{
+	glGenBuffers(1, &m_instanceBuffer);
+}
+
+// ----------------------------------------------------------------------------
+
+template<class T>
+InstanceBatch<T>::~InstanceBatch()
+{
+	glDeleteBuffers(1, &m_instanceBuffer);
+}
+
+// ----------------------------------------------------------------------------
+
+template<class T>
+void InstanceBatch<T>::add(const glm::mat4& modelMat)
+{
+	add(modelMat, glm::transpose(glm::inverse(modelMat)));
+}
+
+// ----------------------------------------------------------------------------
+
+template<class T>
+void InstanceBatch<T>::add(const glm::mat4& modelMat, const glm::mat4& normalMat)
+{
+	InstanceData instance;
+	instance.modelMat = modelMat;
+	instance.normalMat = normalMat;
+
+	m_instanceList.push_back(instance);
+	m_dirty = true;
+}
+
+// ----------------------------------------------------------------------------
+
+template<class T>
+void InstanceBatch<T>::clear()
+{
+	m_instanceList.clear();
+	m_dirty = true;
+}
+
+// ----------------------------------------------------------------------------
+
+template<class T>
+void InstanceBatch<T>::uploadInstances()
+{
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+
+	if (m_instanceList.size() > m_instanceCapacity)
+	{
+		// Grow the storage
+		m_instanceCapacity = m_instanceList.size();
+		glBufferData(GL_ARRAY_BUFFER, sizeof(InstanceData) * m_instanceCapacity, (const void*)m_instanceList.data(), GL_DYNAMIC_DRAW);
+	}
+	else
+	{
+		// Orphan the previous storage so the update doesn't wait for pending draws
+		glBufferData(GL_ARRAY_BUFFER, sizeof(InstanceData) * m_instanceCapacity, nullptr, GL_DYNAMIC_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(InstanceData) * m_instanceList.size(), (const void*)m_instanceList.data());
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	m_dirty = false;
+}
+
+// ----------------------------------------------------------------------------
+
+template<class T>
+void InstanceBatch<T>::render(Shader &shader)
+{
+	if (m_instanceList.size() == 0)
+		return;
+
+	// Upload only when the instances changed
+	if (m_dirty)
+		uploadInstances();
+
+	// Render
+	m_model->renderInstanced(m_instanceBuffer, (GLsizei)m_instanceList.size());
+}
+
+// ----------------------------------------------------------------------------
+
+#endif // INSTANCEBATCH_H
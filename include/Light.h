@@ -5,7 +5,6 @@
 
 #include "Common.h"
 #include <glm/glm.hpp>
-#include <sstream>
 
 // ----------------------------------------------------------------------------
 
@@ -18,14 +17,29 @@ enum class LightSourceType
 
 // ----------------------------------------------------------------------------
 
+// Handle to a light stored in LightData. It stays valid while other lights are added or
+// removed, and is invalidated when its own light is removed.
+struct LightHandle
+{
+	static const unsigned int INVALID_SLOT = 0xffffffff;
+
+	unsigned int slot = INVALID_SLOT;
+	unsigned int generation = 0;
+
+	inline bool operator==(const LightHandle& other) const { return slot == other.slot && generation == other.generation; }
+	inline bool operator!=(const LightHandle& other) const { return !(*this == other); }
+};
+
+// ----------------------------------------------------------------------------
+
+// Description of a light, used to add a light to LightData and to read and edit it.
+// LightData keeps the lights in per field arrays, not in these structs.
 struct BaseLight
 {
 	glm::vec3 color;
 	glm::vec3 ambientComp;
 	glm::vec3 diffuseComp;
 	glm::vec3 specularComp;
-	unsigned int id;
-	LightSourceType lightSourceType;
 	bool enabled = true;
 	bool pbrLight = true;
 
@@ -41,12 +55,11 @@ struct BaseLight
 		const glm::vec3& diffuse,
 		const glm::vec3& specular)
 	{
+		color = glm::vec3(1.0f);
 		ambientComp = ambient;
 		diffuseComp = diffuse;
 		specularComp = specular;	
 	}
-
-	virtual const std::string getId() const = 0;
 };
 
 // ----------------------------------------------------------------------------
@@ -59,12 +72,6 @@ struct DirectionalLight : public BaseLight
 		: BaseLight()
 	{
 		direction = glm::vec3(0.0f);
-		ambientComp = glm::vec3(1.0f);
-		diffuseComp = glm::vec3(1.0f);
-		specularComp = glm::vec3(1.0f);
-		color = glm::vec3(1.0f);
-		lightSourceType = LightSourceType::Directional;
-		id = m_dirLightCounter++;
 	}
 
 	DirectionalLight(const glm::vec3& dir,
@@ -75,8 +82,6 @@ struct DirectionalLight : public BaseLight
 	{
 		direction = dir;
 		color = glm::vec3(0.0f);
-		lightSourceType = LightSourceType::Directional;
-		id = m_dirLightCounter++;
 	}
 
 	DirectionalLight(const glm::vec3& dir,
@@ -86,15 +91,6 @@ struct DirectionalLight : public BaseLight
 		direction = dir;
 		this->color = color;
 	}
-
-	const std::string getId() const override
-	{
-		std::ostringstream stream;
-		stream << "DirectionalLight" << id;
-		return stream.str();
-	}
-
-	static unsigned int m_dirLightCounter;
 };
 
 // -------------------------------------------------------------------------
@@ -103,15 +99,16 @@ struct PointLight : public BaseLight
 {
 	glm::vec3 position;
 	glm::vec3 attenuation;
-	unsigned int id;
+	// Distance at which the light falls below the cutoff of LightData. Computed by LightData
+	// from the color and the attenuation, ignored when adding or editing a light.
+	float range;
 
 	PointLight()
 		: BaseLight()
 	{
 		position = glm::vec3(0.0f);
 		attenuation = glm::vec3(1.0f, 1.0f, 1.0f);
-		lightSourceType = LightSourceType::Point;
-		id = m_pointLightCounter++;
+		range = 0.0f;
 	}
 
 	PointLight(const glm::vec3& pos,
@@ -133,18 +130,8 @@ struct PointLight : public BaseLight
 	{
 		position = pos;
 		attenuation = att;
-		lightSourceType = LightSourceType::Point;
-		id = m_pointLightCounter++;
-	}
-
-	const std::string getId() const override
-	{
-		std::ostringstream stream;
-		stream << "PointLight" << id;
-		return stream.str().c_str();
+		range = 0.0f;
 	}
-
-	static unsigned int m_pointLightCounter;
 };
 
 // -------------------------------------------------------------------------
@@ -156,7 +143,6 @@ struct SpotLight : public BaseLight
 	float coscutoff;
 	glm::vec3 position;
 	glm::vec3 direction;
-	unsigned int id;
 
 	SpotLight()
 		: BaseLight()
@@ -166,8 +152,6 @@ struct SpotLight : public BaseLight
 		coscutoff = 0.0f;
 		position = glm::vec3(0.0f);
 		direction = glm::vec3(0.0f);
-		lightSourceType = LightSourceType::Spot;
-		id = m_spotLightCounter++;
 	}
 
 	SpotLight(const glm::vec3& pos,
@@ -201,18 +185,7 @@ struct SpotLight : public BaseLight
 		exponent = exponentVal;
 		cutoff = cutoffVal;
 		coscutoff = coscutoffVal;
-		lightSourceType = LightSourceType::Spot;
-		id = m_spotLightCounter++;
-	}
-
-	const std::string getId() const override
-	{
-		std::ostringstream stream;
-		stream << "SpotLight" << id;
-		return stream.str().c_str();
 	}
-
-	static unsigned int m_spotLightCounter;
 };
 
 // ----------------------------------------------------------------------------
@@ -4,23 +4,69 @@
 #include "Common.h"
 #include <glm/glm.hpp>
 #include "Light.h"
+#include "UniformBuffer.h"
 
 #include <vector>
-#include <map>
 
 #define WHITE glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)
 #define WHITE3 glm::vec3(1.0f, 1.0f, 1.0f)
 #define BLACK glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)
 #define BLACK3 glm::vec3(0.0f, 0.0f, 0.0f)
 
-const unsigned int MAX_POINT_LIGHTS = 20;
 const unsigned int MAX_DIR_LIGHTS = 20;
 const unsigned int MAX_SPOT_LIGHTS = 20;
 
+class Frustum;
+class Shader;
+
+// Lights of the scene, stored per type in arrays of their fields so the buffer updates and
+// the culling read tightly packed data. Lights are referenced by LightHandle, their position
+// in the arrays changes when another light is removed. Changes go through the setters,
+// which flag the light so the next update only writes the changed lights.
+// Point lights are unbounded and read by the shaders from a texture buffer, directional and
+// spot lights fill fixed size uniform blocks.
 class LightData
 {
 
 public:
+	// Fields shared by the light types, one element per light
+	struct LightArrays
+	{
+		std::vector<glm::vec3> color;
+		std::vector<glm::vec3> ambientComp;
+		std::vector<glm::vec3> diffuseComp;
+		std::vector<glm::vec3> specularComp;
+		std::vector<GLubyte> enabled;
+		std::vector<GLubyte> pbrLight;
+		// Set when the light changed or moved in the arrays since the last buffer update
+		std::vector<GLubyte> dirty;
+		// Handle slot of the light
+		std::vector<GLuint> slot;
+
+		inline size_t count() const { return slot.size(); }
+	};
+
+	struct DirectionalLightArrays : public LightArrays
+	{
+		std::vector<glm::vec3> direction;
+	};
+
+	struct PointLightArrays : public LightArrays
+	{
+		// Position and range, read together by the frustum test
+		std::vector<glm::vec4> positionRange;
+		std::vector<glm::vec3> attenuation;
+	};
+
+	struct SpotLightArrays : public LightArrays
+	{
+		std::vector<glm::vec3> position;
+		std::vector<glm::vec3> direction;
+		std::vector<float> exponent;
+		std::vector<float> cutoff;
+		std::vector<float> coscutoff;
+	};
+
 	static LightData& getInstance()
 	{
 		static LightData instance;
@@ -33,69 +79,127 @@ public:
 	inline glm::vec3 &debugVisLightDir() { return m_visualisationLightDirection; }
 
 	// Add light sources
-	inline void addPointLight(const PointLight &pointLight) 
-	{
-		assert(m_pointLights.size() < MAX_POINT_LIGHTS);
-		m_pointLights.push_back(pointLight);
-		m_globalLights[m_globalIndex++] = &m_pointLights.back();
-	}
-	inline void addDirectionalLight(const DirectionalLight &directionalLight) 
-	{
-		assert(m_directionalLights.size() < MAX_DIR_LIGHTS);
-		m_directionalLights.push_back(directionalLight);
-		m_globalLights[m_globalIndex++] = &m_directionalLights.back();
-	}
-	inline void addSpotLight(const SpotLight &spotLight) 
+	LightHandle addPointLight(const PointLight &pointLight);
+	LightHandle addDirectionalLight(const DirectionalLight &directionalLight);
+	LightHandle addSpotLight(const SpotLight &spotLight);
+	// Remove a light, the last light of its type takes its place in the arrays
+	void removeLight(LightHandle handle);
+
+	bool isValid(LightHandle handle) const;
+	inline LightSourceType lightType(LightHandle handle) const
 	{
-		assert(m_spotLights.size() < MAX_SPOT_LIGHTS);
-		m_spotLights.push_back(spotLight);
-		m_globalLights[m_globalIndex++] = &m_spotLights.back();
+		assert(isValid(handle));
+		return m_slots[handle.slot].type;
 	}
 
-	// Get light sources
-	inline PointLight &pointLight(int index)
+	// Lights in the order they were added
+	inline size_t lightCount() const { return m_lightHandles.size(); }
+	inline LightHandle lightHandle(size_t index) const
 	{
-		assert(index < (int)m_pointLights.size());
-		return m_pointLights[index];
-	}
-	inline DirectionalLight &directionalLight(int index)
-	{
-		assert(index < (int)m_directionalLights.size());
-		return m_directionalLights[index];
-	}
-	inline SpotLight &spotLight(int index)
-	{
-		assert(index < (int)m_spotLights.size());
-		return m_spotLights[index];
-	}
-	inline BaseLight* getLight(int index)
-	{
-		assert(index < (int)m_globalLights.size());
-		return m_globalLights[index];
+		assert(index < m_lightHandles.size());
+		return m_lightHandles[index];
 	}
 
-	std::vector<std::string> getIds()
-	{
-		std::vector<std::string> ids;
-		for (auto &lightSource : m_globalLights)
-			ids.push_back(lightSource.second->getId());
-		return ids;
-	}
-
-	inline size_t lightCount() const { return m_pointLights.size() + m_directionalLights.size() + m_spotLights.size(); }
-	inline size_t pointLightCount() const { return m_pointLights.size(); }
-	inline size_t directionalLightCount() const { return m_directionalLights.size(); }
-	inline size_t spotLightCount() const { return m_spotLights.size(); }
+	// Copy of a light, the handle must be valid and of the right type
+	PointLight pointLight(LightHandle handle) const;
+	DirectionalLight directionalLight(LightHandle handle) const;
+	SpotLight spotLight(LightHandle handle) const;
+
+	// Overwrite a light and flag it for the next update
+	void setPointLight(LightHandle handle, const PointLight &pointLight);
+	void setDirectionalLight(LightHandle handle, const DirectionalLight &directionalLight);
+	void setSpotLight(LightHandle handle, const SpotLight &spotLight);
+
+	// Read only access to the arrays, an index is the position of a light in its arrays
+	inline const PointLightArrays& pointLights() const { return m_pointLights; }
+	inline const DirectionalLightArrays& directionalLights() const { return m_directionalLights; }
+	inline const SpotLightArrays& spotLights() const { return m_spotLights; }
+
+	inline size_t pointLightCount() const { return m_pointLights.count(); }
+	inline size_t directionalLightCount() const { return m_directionalLights.count(); }
+	inline size_t spotLightCount() const { return m_spotLights.count(); }
+
+	// Write the lights changed since the last call to the light uniform buffers, and the point
+	// lights intersecting the frustum to the point light buffer
+	void updateBuffers(const Frustum& frustum);
+	// Bytes written by the last update
+	inline size_t uploadedSize() const { return m_uploadedSize; }
+	// True if the last update changed the point light buffer
+	inline bool pointLightsChanged() const { return m_pointLightsChanged; }
+
+	// Bind the point light buffer to the pointLightData sampler
+	void bindPointLights(const Shader& shader, GLuint textureUnit) const;
+
+	// Point lights written by the last update, the enabled ones with a range intersecting the
+	// frustum. Position and range of the light, color and enabled flag, zero for lights
+	// without PBR color. The index is the position in the point light buffer.
+	inline size_t visiblePointLightCount() const { return m_visiblePointLightList.size(); }
+	inline const glm::vec4* pointLightPositions() const { return m_pointLightTexels.data(); }
+	inline const glm::vec4* pointLightColors() const { return m_pointLightTexels.data() + m_pointLightTexels.size() / 3; }
+
+	// Attenuated light below this fraction of its brightest channel is ignored. Changing it
+	// updates the range of every point light.
+	inline float lightCutoff() const { return m_lightCutoff; }
+	void setLightCutoff(float cutoff);
+
+	// Bound of the point light ranges, lights without falloff would reach infinitely far
+	static const float MAX_LIGHT_RANGE;
+	// Distance at which the attenuated light drops below the cutoff, at most MAX_LIGHT_RANGE.
+	// The spot lights use an inverse square falloff.
+	static float pointLightRange(const glm::vec3& attenuation, const glm::vec3& color, float cutoff);
+	static float spotLightRange(const glm::vec3& color, float cutoff);
 
 private:
 	LightData() {}
 
-	std::map<int, BaseLight*> m_globalLights;
-	int m_globalIndex = 0;
+	// Where the light of a handle is, the generation is incremented when the light is
+	// removed so the old handles become invalid
+	struct LightSlot
+	{
+		LightSourceType type;
+		GLuint index;
+		GLuint generation;
+	};
+
+	LightHandle allocateHandle(LightSourceType type, size_t index);
+	// Index of a light in the arrays of its type
+	inline size_t lightIndex(LightHandle handle, LightSourceType type) const
+	{
+		assert(isValid(handle) && m_slots[handle.slot].type == type);
+		return m_slots[handle.slot].index;
+	}
 
-	std::vector<PointLight> m_pointLights;
-	std::vector<DirectionalLight> m_directionalLights;
-	std::vector<SpotLight> m_spotLights;
+	// Range of the point light from its color and attenuation
+	void updateRange(size_t index);
+
+	std::vector<LightSlot> m_slots;
+	std::vector<GLuint> m_freeSlots;
+	std::vector<LightHandle> m_lightHandles;
+
+	PointLightArrays m_pointLights;
+	DirectionalLightArrays m_directionalLights;
+	SpotLightArrays m_spotLights;
+
+	// Light uniform buffers, their content and the light count of the last update
+	UniformBuffer m_dirLightBuffer;
+	UniformBuffer m_spotLightBuffer;
+	std::vector<DirectionalLightUniformData> m_dirLightUniforms;
+	std::vector<SpotLightUniformData> m_spotLightUniforms;
+	size_t m_uploadedDirLightCount = 0;
+	size_t m_uploadedSpotLightCount = 0;
+	size_t m_uploadedSize = 0;
+
+	// Point light texture buffer (RGBA32F), three sections of one texel per light: position
+	// and range, color and enabled flag, attenuation. The texels are a copy of the buffer
+	// content, the list of the lights they hold is kept to only write the changed texels.
+	GLuint m_pointLightBuffer = 0;
+	GLuint m_pointLightTexture = 0;
+	std::vector<glm::vec4> m_pointLightTexels;
+	std::vector<size_t> m_visiblePointLightList;
+	std::vector<size_t> m_uploadedPointLightList;
+	bool m_pointLightsChanged = true;
+
+	float m_lightCutoff = 1.0f / 256.0f;
 
 	// Debug visualization light properties
 	glm::vec3 m_visualisationLightColor = glm::vec3(1.0f, 1.0f, 1.0f);
@@ -0,0 +1,122 @@
+#ifndef LIGHTGRID_H
+#define LIGHTGRID_H
+
+// ----------------------------------------------------------------------------
+
+#include "Common.h"
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// ----------------------------------------------------------------------------
+
+class Shader;
+
+// ----------------------------------------------------------------------------
+
+// Clusters covered by a light, inclusive
+struct LightClusterBounds
+{
+	GLuint lightIndex;
+	GLuint minX, minY, minZ;
+	GLuint maxX, maxY, maxZ;
+};
+
+// ----------------------------------------------------------------------------
+
+// Per cluster light lists. clusterList holds an (offset, count) pair per cluster, ordered by
+// slice, row and column, pointing into the indices of indexList.
+struct ClusterLightLists
+{
+	GLuint clusterCountX = 0;
+	GLuint clusterCountY = 0;
+	GLuint clusterCountZ = 0;
+	std::vector<GLuint> clusterList;
+	std::vector<GLuint> indexList;
+};
+
+// ----------------------------------------------------------------------------
+
+struct LightGridStats
+{
+	GLuint clusterCount = 0;
+	GLuint binnedLightCount = 0;
+	// Light indices over all the clusters
+	GLuint indexCount = 0;
+	GLuint maxClusterLightCount = 0;
+	double binTime = 0.0;
+};
+
+// ----------------------------------------------------------------------------
+
+// Clustered light culling for the forward and deferred passes. The view frustum is split into
+// TILE_SIZE x TILE_SIZE screen tiles and DEPTH_SLICES exponential depth slices, and every
+// cluster gets the list of point lights whose bounds overlap it, so a pixel only shades the
+// lights of its cluster. The lists are built on the CPU, bands of cluster rows in parallel,
+// and read by the shaders from two texture buffers.
+class LightGrid
+{
+private:
+	LightGrid(void);
+	~LightGrid(void);
+
+public:
+	// Must match LIGHT_TILE_SIZE in the lighting shaders, injected as a define
+	static const GLuint TILE_SIZE = 32;
+	static const GLuint DEPTH_SLICES = 16;
+
+	// Static access function
+	static LightGrid& Instance()
+	{
+		static LightGrid refInstance;
+		return refInstance;
+	}
+
+	bool initialize(GLsizei screenWidth, GLsizei screenHeight);
+
+	// Bin the point lights of LightData for the camera and upload the lists. Skipped when
+	// neither the camera nor the point light buffer changed since the last binning.
+	void update(const glm::mat4& view, const glm::mat4& projection);
+	// Bind the lists to the clusterLightGrid and clusterLightIndices samplers, uses two texture units
+	void bind(const Shader& shader, GLuint firstTextureUnit) const;
+
+	// Build the per cluster lists from the light bounds, split over jobCount threads.
+	// No GL calls, so it can run anywhere.
+	static void binLights(const std::vector<LightClusterBounds>& boundsList, GLuint clusterCountX, GLuint clusterCountY,
+		GLuint clusterCountZ, GLuint jobCount, ClusterLightLists& outLists);
+
+	// Slice of a view space depth, slices grow exponentially from the near to the far plane
+	static GLuint depthSlice(float depth, float nearPlane, float farPlane);
+
+	inline bool &enabled() { return m_enabled; }
+	inline const LightGridStats& stats() const { return m_stats; }
+
+private:
+	// Clusters covered by the sphere, false if it is outside the frustum
+	bool clusterBounds(const glm::vec3& viewPosition, float radius, const glm::mat4& projection, LightClusterBounds& outBounds) const;
+
+	GLuint m_screenWidth;
+	GLuint m_screenHeight;
+
+	std::vector<LightClusterBounds> m_boundsList;
+	ClusterLightLists m_lists;
+
+	// Texture buffers with the cluster ranges (RG32UI) and the light indices (R32UI)
+	GLuint m_clusterBuffer;
+	GLuint m_clusterTexture;
+	GLuint m_indexBuffer;
+	GLuint m_indexTexture;
+
+	// Camera of the current lists
+	glm::mat4 m_binnedView;
+	glm::mat4 m_binnedProjection;
+	bool m_listsValid;
+
+	bool m_enabled;
+	LightGridStats m_stats;
+};
+
+// ----------------------------------------------------------------------------
+
+#endif // LIGHTGRID_H
@@ -0,0 +1,95 @@
+#ifndef LIGHTVOLUMES_H
+#define LIGHTVOLUMES_H
+
+// ----------------------------------------------------------------------------
+
+#include "Common.h"
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Framebuffer.h"
+#include "Shader.h"
+
+// ----------------------------------------------------------------------------
+
+struct LightVolumeStats
+{
+	// Volumes drawn by the last render, after the frustum test
+	GLuint pointLightCount = 0;
+	GLuint spotLightCount = 0;
+};
+
+// ----------------------------------------------------------------------------
+
+// Deferred shading of the point and spot lights through their bounding volumes, a low-poly
+// sphere per point light and a cone per spot light. Every volume is drawn twice: the first
+// draw marks in the stencil buffer the pixels whose G-buffer depth lies inside the volume,
+// the second shades only those pixels and adds the light to an accumulation target. The
+// deferred lighting pass adds the accumulated light before its gamma correction.
+class LightVolumes
+{
+private:
+	LightVolumes(void);
+	~LightVolumes(void);
+
+public:
+
+	// Static access function
+	static LightVolumes& Instance()
+	{
+		static LightVolumes refInstance;
+		return refInstance;
+	}
+
+	// The G-buffer defines select the layout read by the light programs
+	bool initialize(GLsizei width, GLsizei height, const ShaderDefines& gbufferDefines);
+
+	// Shade the enabled lights of LightData into the accumulation target. The G-buffer depth
+	// is copied first, so it must use the same depth stencil format (GL_DEPTH24_STENCIL8).
+	void render(const Framebuffer& gbuffer, const glm::mat4& view, const glm::mat4& projection);
+
+	inline GLuint accumulationTexture() const { return static_cast<GLuint>(m_accumulationFramebuffer.colorTexture("Light")); }
+
+	inline bool &enabled() { return m_enabled; }
+	inline const LightVolumeStats& stats() const { return m_stats; }
+
+private:
+	struct ProxyMesh
+	{
+		GLuint vertexArray = 0;
+		GLuint vertexBuffer = 0;
+		GLuint indexBuffer = 0;
+		GLsizei indexCount = 0;
+	};
+
+	// Unit sphere around the origin and unit cone with its apex at the origin and its base at
+	// z = 1. The vertices are pushed out so the faces enclose the exact shape.
+	static void createSphere(GLuint ringCount, GLuint segmentCount, ProxyMesh& outMesh);
+	static void createCone(GLuint segmentCount, ProxyMesh& outMesh);
+	static void uploadMesh(const std::vector<glm::vec3>& vertexList, const std::vector<GLushort>& indexList, ProxyMesh& outMesh);
+	static void deleteMesh(ProxyMesh& mesh);
+
+	// Bind the G-buffer textures and the point light buffer of a light program. Without a
+	// position target the depth is bound, the compact layout rebuilds the position from it.
+	void bindInputs(Shader& lightShader, const Framebuffer& gbuffer) const;
+	// Mark the pixels inside the volume in the stencil buffer, then shade them
+	void drawVolume(const ProxyMesh& mesh, const glm::mat4& model, Shader& lightShader, GLint lightIndex);
+
+	Framebuffer m_accumulationFramebuffer;
+
+	Shader m_stencilShader;
+	Shader m_pointLightShader;
+	Shader m_spotLightShader;
+
+	ProxyMesh m_sphere;
+	ProxyMesh m_cone;
+
+	bool m_enabled;
+	LightVolumeStats m_stats;
+};
+
+// ----------------------------------------------------------------------------
+
+#endif // LIGHTVOLUMES_H
@@ -9,8 +9,13 @@
 #include <glm/vec4.hpp>
 #include <glm/vec3.hpp>
 #include <glm/vec2.hpp>
+#include <glm/mat4x4.hpp>
 
 #include "Common.h"
+#include "MeshOptimizer.h"
+#include "MeshCluster.h"
+#include "BoundingBox.h"
+#include "GLState.h"
 
 // ----------------------------------------------------------------------------
 // ----------------------------------------------------------------------------
@@ -108,6 +113,30 @@ struct VertexPTT : public VertexP
 	glm::vec3 tangent;
 };
 
+// ----------------------------------------------------------------------------
+
+// Per instance data of instanced draws, read from vertex attributes 5 - 12
+struct InstanceData
+{
+	static const GLuint ATTRIBUTE_LOCATION = 5;
+
+	glm::mat4 modelMat;
+	glm::mat4 normalMat;
+
+	// Read the instances from the buffer bound to GL_ARRAY_BUFFER into the bound vertex array,
+	// starting offset bytes into the buffer. Each mat4 takes 4 consecutive attribute locations.
+	static void setupVertexInput(GLintptr offset)
+	{
+		for (GLuint column = 0; column < 8; column++)
+		{
+			GLuint location = ATTRIBUTE_LOCATION + column;
+			glEnableVertexAttribArray(location);
+			glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (GLvoid*)(offset + sizeof(glm::vec4) * column));
+			glVertexAttribDivisor(location, 1);
+		}
+	}
+};
+
 // ----------------------------------------------------------------------------
 // ----------------------------------------------------------------------------
 
@@ -115,11 +144,24 @@ template<class T>
 class Mesh
 {
 public:
-	Mesh(std::vector<T> vertexList, std::vector<GLushort> indexList);
+	Mesh(std::vector<T> vertexList, std::vector<GLushort> indexList,
+		const MeshOptimizationStats& optimizationStats = MeshOptimizationStats());
 	~Mesh();
 
 	inline const GLuint vertexArrayObject() const { return m_vertexArrayObject; }
+	inline const MeshOptimizationStats& optimizationStats() const { return m_optimizationStats; }
+	inline const std::vector<MeshCluster>& clusters() const { return m_clusterList; }
+	inline GLsizei indexCount() const { return (GLsizei)m_indexList.size(); }
+	// Model space bounds computed at import
+	inline const BoundingBox& bounds() const { return m_bounds; }
+
 	void render();
+	// Draw only the clusters passing the frustum and back face tests (model space frustum and view position)
+	void render(const Frustum& frustum, const glm::vec3& viewPos);
+	// Ranges of the clusters passing the frustum and back face tests, for deferred submission
+	inline void cullClusters(const Frustum& frustum, const glm::vec3& viewPos, ClusterDrawList& drawList) const { ClusterCuller::Instance().cull(m_clusterList, frustum, viewPos, drawList); }
+	// Draw instanceCount copies using the InstanceData stored in instanceBuffer
+	void renderInstanced(GLuint instanceBuffer, GLsizei instanceCount);
 
 	static GLuint vaoCubeSetup();
 	static GLuint vaoQuadSetup();
@@ -128,20 +170,32 @@ public:
 private:
 
 	void setupVertexInput();
+	// Culling clusters and bounding box
+	void buildClusters();
+	void setupInstanceInput(GLuint instanceBuffer);
 
 	GLuint m_vertexArrayObject;
 
 	std::vector<T> m_vertexList;
 	std::vector<GLushort> m_indexList;
+
+	MeshOptimizationStats m_optimizationStats;
+
+	std::vector<MeshCluster> m_clusterList;
+	ClusterDrawList m_clusterDrawList;
+
+	BoundingBox m_bounds;
 };
 
 // ----------------------------------------------------------------------------
 
 template <class T>
-Mesh<T>::Mesh(std::vector<T> vertexList, std::vector<GLushort> indexList)
-	: m_vertexList(vertexList), m_indexList(indexList) 
+Mesh<T>::Mesh(std::vector<T> vertexList, std::vector<GLushort> indexList,
+	const MeshOptimizationStats& optimizationStats)
+	: m_vertexList(vertexList), m_indexList(indexList), m_optimizationStats(optimizationStats)
 {
 	setupVertexInput();
+	buildClusters();
 }
 
 template <class T>
@@ -151,13 +205,41 @@ Mesh<T>::~Mesh()
 
 // ----------------------------------------------------------------------------
 
+template <class T>
+void Mesh<T>::buildClusters()
+{
+	std::vector<glm::vec3> positions;
+	positions.reserve(m_vertexList.size());
+	for (const T& vertex : m_vertexList)
+	{
+		positions.push_back(vertex.position);
+		m_bounds.expand(vertex.position);
+	}
+
+	m_clusterList = MeshClusterBuilder::build(m_indexList, positions);
+}
+
+// ----------------------------------------------------------------------------
+
+template <class T>
+void Mesh<T>::setupInstanceInput(GLuint instanceBuffer)
+{
+	GLState::Instance().bindVertexArray(m_vertexArrayObject);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	InstanceData::setupVertexInput(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState::Instance().bindVertexArray(0);
+}
+
+// ----------------------------------------------------------------------------
+
 template<class T>
 inline GLuint Mesh<T>::vaoCubeSetup()
 {
 	// Create cube vertex array
 	GLuint cubeVertexArray;
 	glGenVertexArrays(1, &cubeVertexArray);
-	glBindVertexArray(cubeVertexArray);
+	GLState::Instance().bindVertexArray(cubeVertexArray);
 
 	// Cube vertex data
 	static const GLfloat cubeVertexData[] =
@@ -227,7 +309,7 @@ inline GLuint Mesh<T>::vaoCubeSetup()
 	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 6, (void*)(3 * sizeof(float)));
 
 	// Unbind vertex array
-	glBindVertexArray(0);
+	GLState::Instance().bindVertexArray(0);
 
 	return cubeVertexArray;
 }
@@ -240,7 +322,7 @@ inline GLuint Mesh<T>::vaoQuadSetup()
 	// Create quad vertex object
 	GLuint quadVertexArray;
 	glGenVertexArrays(1, &quadVertexArray);
-	glBindVertexArray(quadVertexArray);
+	GLState::Instance().bindVertexArray(quadVertexArray);
 
 	// Quad vertex data
 	static const GLfloat quadVertexData[] = {
@@ -269,7 +351,7 @@ inline GLuint Mesh<T>::vaoQuadSetup()
 	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 5, (void*)(3 * sizeof(float)));
 
 	// Unbind vertex array object
-	glBindVertexArray(0);
+	GLState::Instance().bindVertexArray(0);
 
 	return quadVertexArray;
 }
@@ -281,7 +363,7 @@ inline GLuint Mesh<T>::vaoSkyboxSetup()
 	// Create skybox vertex object
 	GLuint skyboxVertexArray;
 	glGenVertexArrays(1, &skyboxVertexArray);
-	glBindVertexArray(skyboxVertexArray);
+	GLState::Instance().bindVertexArray(skyboxVertexArray);
 
 	// Quad vertex data
 	static const GLfloat skyboxVertexData[] = {
@@ -341,7 +423,7 @@ inline GLuint Mesh<T>::vaoSkyboxSetup()
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, (void*)0);
 
 	// Unbind vertex array object
-	glBindVertexArray(0);
+	GLState::Instance().bindVertexArray(0);
 
 	return skyboxVertexArray;
 }
@@ -351,9 +433,45 @@ inline GLuint Mesh<T>::vaoSkyboxSetup()
 template<class T>
 void Mesh<T>::render()
 {
-	glBindVertexArray(m_vertexArrayObject);
+	GLState::Instance().bindVertexArray(m_vertexArrayObject);
 	glDrawElements(GL_TRIANGLES, (GLsizei)m_indexList.size(), GL_UNSIGNED_SHORT, 0);
-	glBindVertexArray(0);
+	GLState::Instance().bindVertexArray(0);
+}
+
+// ----------------------------------------------------------------------------
+
+template<class T>
+void Mesh<T>::render(const Frustum& frustum, const glm::vec3& viewPos)
+{
+	ClusterCuller::Instance().cull(m_clusterList, frustum, viewPos, m_clusterDrawList);
+
+	// Everything culled
+	if (m_clusterDrawList.counts.size() == 0)
+		return;
+
+	GLState::Instance().bindVertexArray(m_vertexArrayObject);
+	glMultiDrawElements(GL_TRIANGLES,
+		m_clusterDrawList.counts.data(),
+		GL_UNSIGNED_SHORT,
+		m_clusterDrawList.offsets.data(),
+		(GLsizei)m_clusterDrawList.counts.size());
+	GLState::Instance().bindVertexArray(0);
+}
+
+// ----------------------------------------------------------------------------
+
+template<class T>
+void Mesh<T>::renderInstanced(GLuint instanceBuffer, GLsizei instanceCount)
+{
+	if (instanceCount == 0)
+		return;
+
+	// The render queue points the same vertex array at its own instances, attach the buffer every draw
+	setupInstanceInput(instanceBuffer);
+
+	GLState::Instance().bindVertexArray(m_vertexArrayObject);
+	glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)m_indexList.size(), GL_UNSIGNED_SHORT, 0, instanceCount);
+	GLState::Instance().bindVertexArray(0);
 }
 
 // ----------------------------------------------------------------------------
@@ -0,0 +1,110 @@
+#ifndef MESHCLUSTER_H
+#define MESHCLUSTER_H
+
+// ----------------------------------------------------------------------------
+
+#include "Common.h"
+#include "Frustum.h"
+
+#include <vector>
+#include <glm/vec3.hpp>
+
+// ----------------------------------------------------------------------------
+
+// Contiguous range of triangles in the mesh index buffer together with its culling data
+struct MeshCluster
+{
+	// Range in the index buffer
+	GLuint indexOffset = 0;
+	GLuint indexCount = 0;
+
+	// Bounding sphere
+	glm::vec3 center;
+	float radius = 0.0f;
+
+	// Normal cone - the cluster is back facing for all viewers satisfying
+	// dot(center - viewPos, coneAxis) >= coneCutoff * length(center - viewPos) + radius
+	glm::vec3 coneAxis;
+	float coneCutoff = 1.0f;
+};
+
+// Compacted index ranges ready for glMultiDrawElements
+struct ClusterDrawList
+{
+	std::vector<GLsizei> counts;
+	std::vector<const void*> offsets;
+
+	inline void clear() { counts.clear(); offsets.clear(); }
+};
+
+// Cluster culling counters for the current frame
+struct ClusterCullingStats
+{
+	unsigned int clusterCount = 0;
+	unsigned int visibleClusterCount = 0;
+	unsigned int triangleCount = 0;
+	unsigned int visibleTriangleCount = 0;
+	unsigned int drawRangeCount = 0;
+};
+
+// ----------------------------------------------------------------------------
+
+class MeshClusterBuilder
+{
+public:
+
+	static const unsigned int MAX_CLUSTER_VERTICES = 64;
+	static const unsigned int MAX_CLUSTER_TRIANGLES = 124;
+
+	// Split the (already cache optimized) index list into runs of consecutive triangles referencing
+	// at most maxVertices unique vertices and maxTriangles triangles. The index list is not modified.
+	static std::vector<MeshCluster> build(const std::vector<GLushort>& indexList,
+		const std::vector<glm::vec3>& positions,
+		unsigned int maxVertices = MAX_CLUSTER_VERTICES,
+		unsigned int maxTriangles = MAX_CLUSTER_TRIANGLES);
+
+private:
+	static void computeBounds(MeshCluster& cluster, const std::vector<GLushort>& indexList, const std::vector<glm::vec3>& positions);
+};
+
+// ----------------------------------------------------------------------------
+
+class ClusterCuller
+{
+private:
+	ClusterCuller(void);
+	~ClusterCuller(void);
+
+public:
+
+	// Static access function
+	static ClusterCuller& Instance()
+	{
+		static ClusterCuller refInstance;
+		return refInstance;
+	}
+
+	// Frustum test of every cluster, plus the back face cone test when enabled; visible neighbours
+	// are merged into a single range. The frustum and the view position have to be in the same (model)
+	// space as the clusters. The cone test is only valid for closed or single sided meshes, so it stays
+	// off while face culling is disabled.
+	void cull(const std::vector<MeshCluster>& clusters,
+		const Frustum& frustum,
+		const glm::vec3& viewPos,
+		ClusterDrawList& drawList);
+
+	inline void resetStats() { m_stats = ClusterCullingStats(); }
+	inline const ClusterCullingStats& stats() const { return m_stats; }
+
+	inline bool& enabled() { return m_enabled; }
+	inline bool& coneCullingEnabled() { return m_coneCullingEnabled; }
+
+private:
+	bool m_enabled;
+	bool m_coneCullingEnabled;
+	ClusterCullingStats m_stats;
+};
+
+// ----------------------------------------------------------------------------
+
+#endif // MESHCLUSTER_H
@@ -0,0 +1,106 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+// ----------------------------------------------------------------------------
+
+#include "Common.h"
+
+#include <vector>
+#include <glm/vec3.hpp>
+
+// ----------------------------------------------------------------------------
+
+// Post-transform vertex cache statistics of an indexed triangle list
+struct VertexCacheStats
+{
+	// Average cache miss ratio - transformed vertices per triangle (best case 0.5)
+	float acmr = 0.0f;
+	// Average transformed vertex ratio - transformed vertices per referenced vertex (best case 1.0)
+	float atvr = 0.0f;
+};
+
+// Result of the optimization pass, kept together with the mesh
+struct MeshOptimizationStats
+{
+	VertexCacheStats before;
+	VertexCacheStats after;
+	unsigned int clusterCount = 0;
+	bool optimized = false;
+};
+
+// ----------------------------------------------------------------------------
+
+class MeshOptimizer
+{
+public:
+
+	// Size of the simulated FIFO post-transform cache used for the statistics
+	static const unsigned int VERTEX_CACHE_SIZE = 32;
+	// Remap value of vertices that are not referenced by the index list
+	static const GLuint INVALID_INDEX = ~0u;
+
+	// Run the full pipeline: vertex cache order, overdraw cluster order, vertex fetch order.
+	// Reorders the vertex list to match the new index order.
+	template<class T>
+	static MeshOptimizationStats optimize(std::vector<T>& vertexList, std::vector<GLushort>& indexList);
+
+	// Measure ACMR/ATVR for the given index order
+	static VertexCacheStats analyzeVertexCache(const std::vector<GLushort>& indexList, size_t vertexCount, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+	// Reorder the triangles for post-transform cache locality (Forsyth's linear-speed algorithm)
+	static void optimizeVertexCache(std::vector<GLushort>& indexList, size_t vertexCount);
+
+	// Split the cache optimized triangle list into clusters and sort them front to back by their
+	// outward facing direction so the mesh occludes itself (Tipsify style). Returns the cluster count.
+	// threshold - allowed ACMR degradation of a cluster relative to its cache run (1.05 = 5%)
+	static unsigned int optimizeOverdraw(std::vector<GLushort>& indexList, const std::vector<glm::vec3>& positions, float threshold = 1.05f);
+
+	// Build a remap table (old index -> new index) that orders the vertices by first use in the
+	// index list and rewrites the indices with it. Unreferenced vertices are dropped (remap = INVALID_INDEX).
+	static size_t optimizeVertexFetchRemap(std::vector<GLushort>& indexList, size_t vertexCount, std::vector<GLuint>& outRemap);
+};
+
+// ----------------------------------------------------------------------------
+
+template<class T>
+MeshOptimizationStats MeshOptimizer::optimize(std::vector<T>& vertexList, std::vector<GLushort>& indexList)
+{
+	MeshOptimizationStats stats;
+
+	// Only indexed triangle lists can be optimized
+	if (indexList.size() == 0 || indexList.size() % 3 != 0)
+		return stats;
+
+	stats.before = analyzeVertexCache(indexList, vertexList.size());
+
+	// Extract positions for the overdraw sorting
+	std::vector<glm::vec3> positions;
+	positions.reserve(vertexList.size());
+	for (const T& vertex : vertexList)
+		positions.push_back(vertex.position);
+
+	// Reorder triangles
+	optimizeVertexCache(indexList, vertexList.size());
+	stats.clusterCount = optimizeOverdraw(indexList, positions);
+
+	// Reorder vertices to match the new index order
+	std::vector<GLuint> remap;
+	size_t uniqueVertexCount = optimizeVertexFetchRemap(indexList, vertexList.size(), remap);
+
+	std::vector<T> reorderedVertexList(uniqueVertexCount);
+	for (size_t vertexIndex = 0; vertexIndex < vertexList.size(); ++vertexIndex)
+	{
+		if (remap[vertexIndex] != INVALID_INDEX)
+			reorderedVertexList[remap[vertexIndex]] = vertexList[vertexIndex];
+	}
+	vertexList.swap(reorderedVertexList);
+
+	stats.after = analyzeVertexCache(indexList, vertexList.size());
+	stats.optimized = true;
+
+	return stats;
+}
+
+// ----------------------------------------------------------------------------
+
+#endif // MESHOPTIMIZER_H
@@ -4,6 +4,7 @@
 // ----------------------------------------------------------------------------
 
 #include "Mesh.h"
+#include "ObjParser.h"
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -11,6 +12,7 @@
 
 #include <vector>
 #include <map>
+#include <chrono>
 
 // ----------------------------------------------------------------------------
 
@@ -22,16 +24,28 @@ public:
 	~Model();
 
 	void render();
+	void render(const Frustum& frustum, const glm::vec3& viewPos);
+	void renderInstanced(GLuint instanceBuffer, GLsizei instanceCount);
+
+	inline const std::vector<Mesh<T>>& meshes() const { return m_meshList; }
+
+	// Model space bounds of all the meshes
+	inline const BoundingBox& bounds() const { return m_bounds; }
 
 private:
 	
 	void loadModel(const std::string& filePath);
 
+	bool loadObjModel(const std::string& filePath);
+
 	Mesh<T> processMesh(aiMesh* pModel);
+	Mesh<T> processMesh(ObjMesh& objMesh);
+	Mesh<T> createMesh(std::vector<T>& vertexList, std::vector<GLushort> indexList);
 	void processNode(aiNode* pNode, const aiScene* pScene);
 	std::vector<GLushort> processIndices(aiMesh* pModel);
 
 	std::vector<Mesh<T>> m_meshList;
+	BoundingBox m_bounds;
 };
 
 // ----------------------------------------------------------------------------
@@ -46,6 +60,9 @@ Model<T>::Model(const std::string& filePath)
 	}
 
 	loadModel(filePath);
+
+	for (const Mesh<T>& mesh : m_meshList)
+		m_bounds.expand(mesh.bounds());
 }
 
 // ----------------------------------------------------------------------------
@@ -66,17 +83,38 @@ void Model<T>::render()
 
 // ----------------------------------------------------------------------------
 
+template <class T>
+void Model<T>::render(const Frustum& frustum, const glm::vec3& viewPos)
+{
+	for (auto &mesh : m_meshList)
+		mesh.render(frustum, viewPos);
+}
+
+// ----------------------------------------------------------------------------
+
+template <class T>
+void Model<T>::renderInstanced(GLuint instanceBuffer, GLsizei instanceCount)
+{
+	for (auto &mesh : m_meshList)
+		mesh.renderInstanced(instanceBuffer, instanceCount);
+}
+
+// ----------------------------------------------------------------------------
+
 template <class T>
 void Model<T>::loadModel(const std::string& filePath)
 {
+	// Fast path for plain OBJ files, Assimp handles everything else or anything the parser rejects
+	if (ObjParser::isObjFile(filePath) && loadObjModel(filePath))
+		return;
+
 	Assimp::Importer assimpImporter;
 
 	const aiScene* pScene = assimpImporter.ReadFile(filePath.c_str(),
 		aiProcess_Triangulate |
 		aiProcess_GenSmoothNormals |
 		aiProcess_FlipUVs |
-		aiProcess_CalcTangentSpace |
-		aiProcess_ImproveCacheLocality);
+		aiProcess_CalcTangentSpace);
 
 	if (!pScene || pScene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || pScene->mRootNode == nullptr)
 	{
@@ -91,6 +129,27 @@ void Model<T>::loadModel(const std::string& filePath)
 
 // ----------------------------------------------------------------------------
 
+template <class T>
+bool Model<T>::loadObjModel(const std::string& filePath)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	std::vector<ObjMesh> objMeshList;
+	if (ObjParser::load(filePath, objMeshList) == false)
+		return false;
+
+	auto parseTime = std::chrono::high_resolution_clock::now();
+	std::cout << "Mesh loaded successfully: " << filePath << " (OBJ parser "
+		<< std::chrono::duration<double, std::milli>(parseTime - startTime).count() << " ms)" << std::endl;
+
+	for (auto &objMesh : objMeshList)
+		m_meshList.push_back(processMesh(objMesh));
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+
 template <class T>
 void Model<T>::processNode(aiNode* pNode, const aiScene* pScene)
 {
@@ -127,4 +186,22 @@ std::vector<GLushort> Model<T>::processIndices(aiMesh* pModel)
 
 // ----------------------------------------------------------------------------
 
+template <class T>
+Mesh<T> Model<T>::createMesh(std::vector<T>& vertexList, std::vector<GLushort> indexList)
+{
+	// Reorder for the post-transform cache, overdraw and vertex fetch before the upload
+	MeshOptimizationStats stats = MeshOptimizer::optimize(vertexList, indexList);
+
+	if (stats.optimized)
+	{
+		std::cout << "Mesh optimized: " << indexList.size() / 3 << " triangles, " << stats.clusterCount << " clusters, "
+			<< "ACMR " << stats.before.acmr << " -> " << stats.after.acmr << ", "
+			<< "ATVR " << stats.before.atvr << " -> " << stats.after.atvr << std::endl;
+	}
+
+	return Mesh<T>(vertexList, indexList, stats);
+}
+
+// ----------------------------------------------------------------------------
+
 #endif // MODEL_H
\ No newline at end of file
@@ -0,0 +1,50 @@
+#ifndef OBJPARSER_H
+#define OBJPARSER_H
+
+// ----------------------------------------------------------------------------
+
+#include "Common.h"
+
+#include <string>
+#include <vector>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+// ----------------------------------------------------------------------------
+
+// Triangulated, de-indexed OBJ mesh - one entry per unique (position, texture coordinate, normal)
+// triple, same content as the aiMesh produced by Assimp with the Model<T> post processing flags
+struct ObjMesh
+{
+	std::string name;
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> textureCoords;
+	std::vector<glm::vec3> tangents;
+	std::vector<glm::vec3> bitangents;
+
+	std::vector<GLushort> indices;
+
+	bool hasTextureCoords = false;
+};
+
+// ----------------------------------------------------------------------------
+
+// Memory mapped, multithreaded OBJ parser used as a fast path instead of Assimp
+class ObjParser
+{
+public:
+
+	// Parse the file into one mesh per object/group/material. Faces are triangulated as fans,
+	// missing normals are generated (smooth), V is flipped and tangents are computed when
+	// texture coordinates are present. Meshes are split to stay addressable with GLushort.
+	static bool load(const std::string& filePath, std::vector<ObjMesh>& outMeshList);
+
+	// Returns true for paths with the .obj extension
+	static bool isObjFile(const std::string& filePath);
+};
+
+// ----------------------------------------------------------------------------
+
+#endif // OBJPARSER_H
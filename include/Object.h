@@ -6,10 +6,12 @@
 #include <glm/glm.hpp>
 #include <glm/mat4x4.hpp>
 
-#include "Model.h"
-#include "Transform.h"
+#include "GeometryMan.h"
+#include "TransformSystem.h"
+#include "SceneCuller.h"
 #include "Shader.h"
 #include "CameraMan.h"
+#include "RenderQueue.h"
 
 template<class T>
 class Object
@@ -18,28 +20,47 @@ public:
 	Object(const std::string& filePath);
 	~Object();
 
+	// Owns its node in the transform hierarchy
+	Object(const Object&) = delete;
+	Object& operator=(const Object&) = delete;
+
 	virtual void update(double dt);
 	virtual void render(Shader &shader);
+	// Queue one draw per mesh instead of drawing immediately
+	virtual void submit(RenderQueue &queue, RenderPass pass, Shader &shader, MaterialTexturePBR* material = nullptr);
+
+	// Local transform, relative to the parent object if any
+	inline Transform &transform() { return TransformSystem::Instance().local(m_transform); }
+	inline TransformHandle transformHandle() const { return m_transform; }
+	inline void setParent(const Object* parent) { TransformSystem::Instance().setParent(m_transform, parent != nullptr ? parent->transformHandle() : INVALID_TRANSFORM); }
+	inline const std::shared_ptr<Model<T>> &model() const { return m_model; }
 
-	inline auto &transform() { return m_transform; }
+	// Result of the last SceneCuller::cull
+	inline bool isVisible() const { return SceneCuller::Instance().isVisible(m_cullingProxy); }
 
 private:
-	Model<T> m_model;
-	Transform m_transform;
+	std::shared_ptr<Model<T>> m_model;
+	TransformHandle m_transform;
+	GLuint m_cullingProxy;
+
+	// Scratch cluster ranges, copied by the render queue
+	ClusterDrawList m_clusterDrawList;
 
 };
 
 template<class T>
 Object<T>::Object(const std::string& filePath)
-	: m_model(filePath)
+	: m_model(GeometryMan::Instance().getModel<T>(filePath)),
+	m_transform(TransformSystem::Instance().create()),
+	m_cullingProxy(SceneCuller::Instance().add(m_transform, m_model->bounds()))
 {
-
 }
 
 template<class T>
 Object<T>::~Object()
 {
-
+	SceneCuller::Instance().remove(m_cullingProxy);
+	TransformSystem::Instance().destroy(m_transform);
 }
 
 template<class T>
@@ -51,16 +72,58 @@ void Object<T>::update(double dt)
 template<class T>
 void Object<T>::render(Shader &shader)
 {
-	// Set uniforms
-	glm::mat4 model = m_transform.modelMat();
-	shader.set<glm::mat4>(ShaderUniform::ModelMat, model);
-	shader.set<glm::mat4>(ShaderUniform::NormalMat, glm::transpose(glm::inverse(model)));
-	shader.set<glm::mat4>(ShaderUniform::ViewMat, CameraMan::Instance().getActiveCamera()->viewMatrix());
-	shader.set<glm::mat4>(ShaderUniform::ProjMat, CameraMan::Instance().getActiveCamera()->projMatrix());
-	shader.set<glm::vec3>(ShaderUniform::ViewPos, CameraMan::Instance().getActiveCamera()->viewPos());
+	const Camera* camera = CameraMan::Instance().getActiveCamera();
+
+	// Set uniforms - the matrices are computed by the transform stage and the
+	// camera matrices are shared by all the programs through the CameraData block
+	const TransformSystem& transformSystem = TransformSystem::Instance();
+	const glm::mat4 &model = transformSystem.worldMat(m_transform);
+	RenderQueue::Instance().bindObjectData(model, transformSystem.normalMat(m_transform));
 
 	// Render
-	m_model.render();
+	if (ClusterCuller::Instance().enabled())
+	{
+		// Cull the clusters in model space
+		Frustum frustum(camera->projMatrix() * camera->viewMatrix() * model);
+		glm::vec3 viewPos = transformSystem.toLocal(m_transform, camera->viewPos());
+		m_model->render(frustum, viewPos);
+	}
+	else
+		m_model->render();
+}
+
+template<class T>
+void Object<T>::submit(RenderQueue &queue, RenderPass pass, Shader &shader, MaterialTexturePBR* material)
+{
+	const Camera* camera = CameraMan::Instance().getActiveCamera();
+
+	const TransformSystem& transformSystem = TransformSystem::Instance();
+	const glm::mat4 &model = transformSystem.worldMat(m_transform);
+	const glm::mat4 &normal = transformSystem.normalMat(m_transform);
+
+	// Distance along the view direction, for the front to back order
+	float viewDepth = -(camera->viewMatrix() * model[3]).z;
+
+	bool clusterCulling = ClusterCuller::Instance().enabled();
+	Frustum frustum;
+	glm::vec3 viewPos;
+	if (clusterCulling)
+	{
+		// Cull the clusters in model space
+		frustum.update(camera->projMatrix() * camera->viewMatrix() * model);
+		viewPos = transformSystem.toLocal(m_transform, camera->viewPos());
+	}
+
+	for (const Mesh<T>& mesh : m_model->meshes())
+	{
+		if (clusterCulling)
+		{
+			mesh.cullClusters(frustum, viewPos, m_clusterDrawList);
+			queue.add(pass, shader, material, mesh.vertexArrayObject(), m_clusterDrawList, model, normal, viewDepth);
+		}
+		else
+			queue.add(pass, shader, material, mesh.vertexArrayObject(), mesh.indexCount(), model, normal, viewDepth);
+	}
 }
 
 #endif // OBJECT_H
\ No newline at end of file
@@ -0,0 +1,96 @@
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+// ----------------------------------------------------------------------------
+
+#include "Common.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// ----------------------------------------------------------------------------
+
+// Programs loaded from the cache and built from source since the start
+struct ProgramCacheStats
+{
+	GLuint hitCount = 0;
+	GLuint missCount = 0;
+	// Time spent loading the cached binaries
+	double loadTime = 0.0;
+	// Time the cached programs took to compile and link when they were stored
+	double buildTime = 0.0;
+};
+
+// ----------------------------------------------------------------------------
+
+// Linked program binaries stored on disk and keyed by the hash of the program sources.
+// The file is tied to the driver which produced it, a different vendor, renderer or
+// version string discards all the entries. A binary rejected by the driver counts as
+// a miss and the caller builds the program from source. New binaries are kept in memory
+// until save, at exit the entries not used by this run are dropped and the file is written.
+class ProgramCache
+{
+private:
+	ProgramCache(void);
+	~ProgramCache(void);
+
+public:
+
+	// Static access function
+	static ProgramCache& Instance()
+	{
+		static ProgramCache refInstance;
+		return refInstance;
+	}
+
+	// 64 bit FNV-1a, chain calls by passing the previous hash
+	static std::uint64_t hash(const std::string& data, std::uint64_t hash = 14695981039346656037ull);
+
+	// Needs GL 4.1 or ARB_get_program_binary and at least one binary format
+	bool supported();
+
+	// Load the binary into the program, true if it linked
+	bool load(GLuint program, std::uint64_t sourceHash);
+	// Store the binary of a program linked with the retrievable hint, buildTime in ms
+	void store(GLuint program, std::uint64_t sourceHash, double buildTime);
+	// Write the cache file if an entry changed since the last write
+	void save();
+
+	inline const ProgramCacheStats& stats() const { return m_stats; }
+	// Build time of the cached programs minus the time it took to load them, in ms
+	inline double savedTime() const { return m_stats.buildTime - m_stats.loadTime; }
+
+private:
+	static const char* FILE_PATH;
+	static const std::uint32_t FILE_VERSION = 1;
+
+	struct Entry
+	{
+		GLenum format;
+		float buildTime;
+		std::vector<char> binary;
+		// Loaded or stored by this run
+		bool used = false;
+	};
+
+	// Read the cache file on first use
+	void open();
+	bool readFile();
+	bool writeFile() const;
+
+	std::unordered_map<std::uint64_t, Entry> m_entryList;
+	std::string m_driverVersion;
+
+	bool m_opened;
+	bool m_supported;
+	// Entries added or removed since the file was written
+	bool m_modified;
+
+	ProgramCacheStats m_stats;
+};
+
+// ----------------------------------------------------------------------------
+
+#endif // PROGRAMCACHE_H
@@ -0,0 +1,173 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+// ----------------------------------------------------------------------------
+
+#include "Common.h"
+
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+
+#include <glm/mat4x4.hpp>
+
+#include "Material.h"
+#include "Mesh.h"
+#include "MeshCluster.h"
+#include "Shader.h"
+
+// ----------------------------------------------------------------------------
+
+enum class RenderPass
+{
+	GBuffer = 0,
+	Forward,
+
+	Count,
+};
+
+// ----------------------------------------------------------------------------
+
+// State changes issued and skipped by the queue during the frame
+struct RenderQueueStats
+{
+	GLuint itemCount = 0;
+	GLuint programBinds = 0;
+	GLuint programBindsSkipped = 0;
+	GLuint textureBinds = 0;
+	GLuint textureBindsSkipped = 0;
+	GLuint vertexArrayBinds = 0;
+	GLuint vertexArrayBindsSkipped = 0;
+	GLuint instancedDraws = 0;
+	GLuint instancedItems = 0;
+};
+
+// ----------------------------------------------------------------------------
+
+// Draws collected for a pass, sorted on a 64 bit key and submitted with the redundant
+// program, texture and vertex array binds removed. Key layout from the most significant bit:
+// pass (4) | shader (12) | material (16) | mesh (16) | view depth (16, front to back).
+// Uniforms shared by all the draws of a program have to be set before flush, the per draw
+// matrices are written to the ObjectData ring once per flush.
+// Consecutive items with the same shader, material, vertex array and index ranges are drawn
+// with one instanced draw when the shader has an instanced counterpart, which reads the
+// matrices from the InstanceData vertex attributes instead of the ObjectData block.
+class RenderQueue
+{
+private:
+	RenderQueue(void);
+	~RenderQueue(void);
+
+public:
+
+	// Static access function
+	static RenderQueue& Instance()
+	{
+		static RenderQueue refInstance;
+		return refInstance;
+	}
+
+	// Create the per draw uniform buffer ring and the instance buffer
+	bool initialize();
+
+	// Program used for the instanced draws of the items queued with shader.
+	// Uniforms set on shader before flush have to be set on instancedShader too.
+	void setInstancedShader(const Shader& shader, Shader& instancedShader);
+
+	// Draw the whole index buffer of the vertex array
+	void add(RenderPass pass, Shader& shader, MaterialTexturePBR* material, GLuint vertexArrayObject,
+		GLsizei indexCount, const glm::mat4& modelMat, const glm::mat4& normalMat, float viewDepth);
+	// Draw the ranges left by the cluster culling
+	void add(RenderPass pass, Shader& shader, MaterialTexturePBR* material, GLuint vertexArrayObject,
+		const ClusterDrawList& drawList, const glm::mat4& modelMat, const glm::mat4& normalMat, float viewDepth);
+
+	// Sort and draw all the queued items, then clear the queue
+	void flush();
+
+	inline size_t itemCount() const { return m_itemList.size(); }
+
+	// Write and bind the ObjectData block of a draw issued outside the queue
+	void bindObjectData(const glm::mat4& modelMat, const glm::mat4& normalMat);
+
+	inline void resetStats() { m_stats = RenderQueueStats(); }
+	inline const RenderQueueStats& stats() const { return m_stats; }
+
+private:
+	// Draws which can be in flight in the ObjectData ring
+	static const GLuint OBJECT_RING_SIZE = 4096;
+
+	struct RenderItem
+	{
+		Shader* shader;
+		MaterialTexturePBR* material;
+		GLuint vertexArrayObject;
+
+		// Index ranges in m_rangeCounts/m_rangeOffsets
+		size_t firstRange;
+		size_t rangeCount;
+
+		glm::mat4 modelMat;
+		glm::mat4 normalMat;
+	};
+
+	// Run of sorted items drawn by a single draw call
+	struct DrawGroup
+	{
+		// Position of the first item in m_sortedList
+		GLuint position;
+		// 0 for a regular draw using the ObjectData block
+		GLuint instanceCount;
+		// First element in m_instanceDataList
+		GLuint firstInstance;
+	};
+
+	void addItem(RenderPass pass, Shader& shader, MaterialTexturePBR* material, GLuint vertexArrayObject,
+		size_t firstRange, size_t rangeCount, const glm::mat4& modelMat, const glm::mat4& normalMat, float viewDepth);
+
+	// Small stable ids so the handles and pointers fit in the key fields
+	GLuint shaderId(GLuint program);
+	GLuint materialId(const MaterialTexturePBR* material);
+	GLuint meshId(GLuint vertexArrayObject);
+
+	// LSD radix sort of m_keyList, the result is the item order in m_sortedList
+	void sortItems();
+
+	// Split the sorted items into regular draws and instanced runs
+	void buildDrawGroups();
+	bool canInstance(const RenderItem& first, const RenderItem& item) const;
+	void uploadInstances();
+
+	// Bind the textures not already bound to their unit
+	void bindMaterial(const MaterialTexturePBR& material, GLuint program, bool changed);
+
+	std::vector<RenderItem> m_itemList;
+	std::vector<std::uint64_t> m_keyList;
+	std::vector<GLuint> m_sortedList;
+	std::vector<GLuint> m_sortScratch;
+
+	std::vector<GLsizei> m_rangeCounts;
+	std::vector<const GLvoid*> m_rangeOffsets;
+
+	std::unordered_map<GLuint, GLuint> m_shaderIds;
+	std::unordered_map<const MaterialTexturePBR*, GLuint> m_materialIds;
+	std::unordered_map<GLuint, GLuint> m_meshIds;
+	std::unordered_map<const Shader*, Shader*> m_instancedShaders;
+
+	std::vector<DrawGroup> m_drawGroupList;
+
+	// Per draw uniforms, in draw order
+	UniformBufferRing m_objectUniforms;
+	std::vector<ObjectUniformData> m_objectDataList;
+
+	// Per instance matrices of the instanced runs, uploaded once per flush
+	GLuint m_instanceBuffer;
+	// Size of the buffer storage in instances
+	size_t m_instanceCapacity;
+	std::vector<InstanceData> m_instanceDataList;
+
+	RenderQueueStats m_stats;
+};
+
+// ----------------------------------------------------------------------------
+
+#endif // RENDERQUEUE_H
@@ -0,0 +1,75 @@
+#ifndef SCENEBVH_H
+#define SCENEBVH_H
+
+// ----------------------------------------------------------------------------
+
+#include "Common.h"
+
+#include <vector>
+
+#include "BoundingBox.h"
+#include "Frustum.h"
+
+// ----------------------------------------------------------------------------
+
+// Dynamic bounding volume hierarchy over world space boxes. Leaves are inserted next to the
+// sibling with the lowest surface area cost. A leaf moving inside its parent box only refits
+// (shrinks) its ancestors, a leaf leaving it is reinserted.
+class SceneBVH
+{
+public:
+	static const GLuint NULL_NODE = ~0u;
+
+	SceneBVH();
+	~SceneBVH();
+
+	// Returns the leaf node holding userData
+	GLuint insert(const BoundingBox& bounds, GLuint userData);
+	void remove(GLuint leaf);
+	// Replace the leaf bounds and update the ancestors until one of them doesn't change
+	void refit(GLuint leaf, const BoundingBox& bounds);
+
+	// Append the userData of the leaves intersecting the frustum. Subtrees completely
+	// inside the frustum are accepted without testing their children.
+	void cull(const Frustum& frustum, std::vector<GLuint>& visibleList);
+
+	inline const BoundingBox& bounds(GLuint node) const { return m_nodeList[node].bounds; }
+	inline size_t leafCount() const { return m_leafCount; }
+	// Number of box tests done by the last cull
+	inline size_t testCount() const { return m_testCount; }
+
+private:
+	struct Node
+	{
+		BoundingBox bounds;
+		GLuint parent = NULL_NODE;
+		GLuint children[2] = { NULL_NODE, NULL_NODE };
+		GLuint userData = 0;
+
+		inline bool isLeaf() const { return children[0] == NULL_NODE; }
+	};
+
+	GLuint allocateNode();
+	void freeNode(GLuint node);
+
+	void insertLeaf(GLuint leaf);
+	void removeLeaf(GLuint leaf);
+	// Recompute the bounds from the children, from node up to the root
+	void refitAncestors(GLuint node);
+
+	void collectLeaves(GLuint node, std::vector<GLuint>& visibleList) const;
+
+	std::vector<Node> m_nodeList;
+	std::vector<GLuint> m_freeNodeList;
+	GLuint m_root;
+
+	size_t m_leafCount;
+	size_t m_testCount;
+
+	// Traversal stack reused between culls
+	std::vector<GLuint> m_stack;
+};
+
+// ----------------------------------------------------------------------------
+
+#endif // SCENEBVH_H
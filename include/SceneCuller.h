@@ -0,0 +1,93 @@
+#ifndef SCENECULLER_H
+#define SCENECULLER_H
+
+// ----------------------------------------------------------------------------
+
+#include "Common.h"
+
+#include <vector>
+
+#include "BoundingBox.h"
+#include "Frustum.h"
+#include "SceneBVH.h"
+#include "TransformSystem.h"
+
+// ----------------------------------------------------------------------------
+
+class DepthPyramid;
+
+// ----------------------------------------------------------------------------
+
+struct SceneCullingStats
+{
+	GLuint objectCount = 0;
+	GLuint visibleObjectCount = 0;
+	// Objects inside the frustum rejected by the depth pyramid
+	GLuint occludedObjectCount = 0;
+	// Box tests done while traversing the BVH
+	GLuint testCount = 0;
+};
+
+// ----------------------------------------------------------------------------
+
+// View frustum culling of scene objects. Every object registers its model space bounds and
+// transform; the world space boxes are kept in a BVH which is refit only for the objects
+// moved by the last TransformSystem::update.
+class SceneCuller
+{
+private:
+	SceneCuller(void);
+	~SceneCuller(void);
+
+public:
+	static const GLuint INVALID_PROXY = ~0u;
+
+	// Static access function
+	static SceneCuller& Instance()
+	{
+		static SceneCuller refInstance;
+		return refInstance;
+	}
+
+	GLuint add(TransformHandle transform, const BoundingBox& localBounds);
+	void remove(GLuint proxy);
+
+	// Refit the boxes of the moved objects, call after TransformSystem::update
+	void update();
+	// Build the visible list for the frame
+	void cull(const Frustum& frustum);
+	// Remove the objects hidden behind the depth pyramid from the visible list
+	void cullOccluded(const DepthPyramid& depthPyramid);
+
+	inline bool isVisible(GLuint proxy) const { return m_enabled == false || m_visibleFlags[proxy] != 0; }
+	// Proxies of the objects which passed the last cull
+	inline const std::vector<GLuint>& visibleList() const { return m_visibleList; }
+
+	inline const SceneCullingStats& stats() const { return m_stats; }
+	inline bool& enabled() { return m_enabled; }
+	inline bool& occlusionEnabled() { return m_occlusionEnabled; }
+
+private:
+	struct Proxy
+	{
+		TransformHandle transform = INVALID_TRANSFORM;
+		BoundingBox localBounds;
+		GLuint leaf = SceneBVH::NULL_NODE;
+	};
+
+	SceneBVH m_bvh;
+
+	std::vector<Proxy> m_proxyList;
+	std::vector<GLuint> m_freeProxyList;
+
+	std::vector<GLuint> m_visibleList;
+	std::vector<GLubyte> m_visibleFlags;
+
+	bool m_enabled;
+	bool m_occlusionEnabled;
+	SceneCullingStats m_stats;
+};
+
+// ----------------------------------------------------------------------------
+
+#endif // SCENECULLER_H
@@ -3,7 +3,9 @@
 
 #include <string>
 #include "Common.h"
+#include "GLState.h"
 #include "LightData.h"
+#include "UniformBuffer.h"
 
 #include <glm/glm.hpp>
 #include <glm/vec2.hpp>
@@ -11,6 +13,15 @@
 #include <glm/vec4.hpp>
 #include <glm/mat4x4.hpp>
 #include <vector>
+#include <unordered_map>
+#include <map>
+#include <future>
+#include <mutex>
+#include <ctime>
+
+// Preprocessor definitions added to every stage of a program, name to value.
+// Ordered so equal sets produce the same source and the same program cache key.
+typedef std::map<std::string, std::string> ShaderDefines;
 
 enum class ShaderUniform
 {
@@ -60,62 +71,6 @@ enum class ShaderUniform
 	Count,
 };
 
-enum class PointLightUniform
-{
-	Position,
-	Attenuation,
-
-	// Defined for PBR materials
-	Color,
-
-	// Defined for materials rendered using Phong
-	ColorAmbientComp,
-	ColorDiffuseComp,
-	ColorSpecularComp,
-
-	Enabled,
-
-	Count,
-};
-
-enum class DirLightUniform
-{
-	Direction,
-
-	// Defined for PBR materials
-	Color,
-
-	// Defined for materials rendered using Phong
-	ColorAmbientComp,
-	ColorDiffuseComp,
-	ColorSpecularComp,
-
-	Enabled,
-
-	Count,
-};
-
-enum class SpotLightUniform
-{
-	Position,
-	Direction,
-	Exponent,
-	Cutoff,
-	CosCutoff,
-
-	// Defined for PBR materials
-	Color,
-
-	// Defined for materials rendered using Phong
-	ColorAmbientComp,
-	ColorDiffuseComp,
-	ColorSpecularComp,
-
-	Enabled,
-
-	Count,
-};
-
 enum class MaterialUniform
 {
 	AmbientComp,
@@ -151,13 +106,46 @@ public:
 	};
 
 	Shader();
+	// Variant of the program compiled with the given definitions
+	explicit Shader(const ShaderDefines& defines);
 	~Shader();
 
+	// Definitions of the stages added after the call, for variants chosen at startup
+	inline void setDefines(const ShaderDefines& defines) { m_defines = defines; }
+
+	// Blocking build, same as submit followed by finish
 	bool initialize();
-	const inline void useShader() { glUseProgram(m_program); }
+	// Start compiling and linking without waiting for the driver. With KHR/ARB_parallel_shader_compile
+	// the work runs on driver threads, so the programs of a scene can be built concurrently.
+	bool submit();
+	// True if finish won't block on the driver
+	bool isReady() const;
+	// Check the build result, store it in the program cache and reflect the uniforms
+	bool finish();
+	// Finish a set of submitted programs in the order the driver completes them
+	static bool finishAll(const std::vector<Shader*>& shaderList);
+
+	// Hot reload. A rebuild goes through submit and finish like the first build, and the
+	// program handle is only replaced after a successful link, so a broken edit keeps the
+	// previous program running.
+	bool sourcesModified() const;
+	// Read the stages again on worker threads
+	void reloadSources();
+	// True if submit won't wait for a file read
+	bool sourcesReady() const;
+	const inline void useShader() { GLState::Instance().useProgram(m_program); }
 	const inline GLuint program() const { return m_program; }
+	// True between submit and finish
+	inline bool pending() const { return m_pendingProgram != 0; }
+	// The file is read on a worker thread, the code is needed by submit
 	bool addShader(ShaderType type, const std::string &path);
 
+	// Location of an active uniform, -1 if the program doesn't use it. The locations are
+	// enumerated once after linking, so no name lookup reaches the driver while rendering.
+	inline GLint uniformLocation(const std::string& name) const { return uniformLocation(m_program, name); }
+	// Same lookup for code which only knows the program handle
+	static GLint uniformLocation(GLuint program, const std::string& name);
+
 	template<typename T>
 	void set(ShaderUniform uniform, const T& val);
 	template<typename T>
@@ -172,46 +160,79 @@ public:
 	template<typename T>
 	void setMaterialScalar(MaterialPBRUniform uniform, T val);
 
-	template<typename T>
-	void setDirLight(DirLightUniform uniform, unsigned int index, const T& val);
-	template<typename T>
-	void setDirLightScalar(DirLightUniform uniform, unsigned int index, float val);
-	template<typename T>
-	void setPointLight(PointLightUniform uniform, unsigned int index, const T& val);
-	template<typename T>
-	void setPointLightScalar(PointLightUniform uniform, unsigned int index, float val);
-	template<typename T>
-	void setSpotLight(SpotLightUniform uniform, unsigned int index, const T& val);
-	template<typename T>
-	void setSpotLightScalar(SpotLightUniform uniform, unsigned int index, T val);
-
 	// Set lighting
-	void updatePointLights();
-	void updateDirectionalLights();
-	void updateSpotLights();
 	void updateDebugLight();
 
 private:
+	typedef std::unordered_map<std::string, GLint> UniformTable;
+
+	// Active uniforms of every linked program
+	static std::unordered_map<GLuint, UniformTable> s_uniformTables;
+
+	// Stage code with the includes resolved
+	struct ShaderCode
+	{
+		std::string code;
+		// Index is the GLSL source string number used in the #line directives
+		std::vector<std::string> fileList;
+		std::vector<std::time_t> modifiedTimeList;
+	};
+
+	struct SourceFile
+	{
+		std::time_t modifiedTime;
+		std::string code;
+	};
+
+	// Contents of the shader files, shared by the programs including them
+	static std::unordered_map<std::string, SourceFile> s_sourceFiles;
+	static std::mutex s_sourceFileMutex;
+
+	struct ShaderSource
+	{
+		ShaderType type;
+		std::string path;
+		std::string code;
+		std::future<ShaderCode> pendingCode;
+		// Main file and included files, with the modification times of the code used
+		std::vector<std::string> fileList;
+		std::vector<std::time_t> modifiedTimeList;
+	};
+
+	ShaderDefines m_defines;
+
 	GLuint m_program;
-	std::vector<int> m_shaderObjects;
+	// Program being built by submit, replaces m_program in finish
+	GLuint m_pendingProgram;
+	std::vector<ShaderSource> m_shaderSources;
+	// Stages of the link in flight, deleted by finish
+	std::vector<GLuint> m_shaderObjects;
+	std::uint64_t m_sourceHash;
+	double m_buildTime;
+	bool m_linkPending;
 
 	GLint m_shaderUniforms[static_cast<int>(ShaderUniform::Count)];
-	GLint m_pointLightsUniforms[MAX_POINT_LIGHTS][static_cast<int>(PointLightUniform::Count)];
-	GLint m_dirLightsUniforms[MAX_DIR_LIGHTS][static_cast<int>(DirLightUniform::Count)];
-	GLint m_spotLightsUniforms[MAX_SPOT_LIGHTS][static_cast<int>(SpotLightUniform::Count)];
 	GLint m_materialUniforms[static_cast<int>(MaterialUniform::Count)];
 	GLint m_materialPBRUniforms[static_cast<int>(MaterialPBRUniform::Count)];
 
 private:
-	bool readShaderFromFile(const std::string& shaderFilePath, std::string& outShaderCode);
-	bool compileShader(GLuint shaderObject, const std::string& shaderCode);
-	bool linkProgram();
+	static bool parallelCompileSupported();
+	// Read a stage, resolving #include "path" directives relative to the including file
+	static bool readShaderFromFile(const std::string& shaderFilePath, const ShaderDefines& defines, ShaderCode& outShaderCode);
+	static bool appendShaderFile(const std::string& shaderFilePath, const ShaderDefines* defines, ShaderCode& outShaderCode);
+	static bool loadSourceFile(const std::string& shaderFilePath, std::string& outFileCode, std::time_t& outModifiedTime);
+	static std::string injectDefines(const ShaderDefines& defines, int nextLineNumber, int fileIndex);
+	static std::future<ShaderCode> readShaderAsync(const std::string& path, const ShaderDefines& defines);
+	static std::time_t modifiedTime(const std::string& path);
+	static bool compileStatus(GLuint shaderObject);
+	static bool linkStatus(GLuint program);
+	void discardPendingProgram();
+	void reflectUniforms();
 	void initializeUniforms();
+	void initializeUniformBlocks();
 
 };
 
-#endif // SHADER_H
-
 // ----------------------------------------------------------------------------
 
 // Template specialization - generic shader uniforms
@@ -245,45 +266,6 @@ inline void Shader::setMaterialScalar<float>(MaterialPBRUniform uniform, float v
 	glUniform1f(m_materialPBRUniforms[static_cast<int>(uniform)], val);
 }
 
-// Directional light
-template<>
-inline void Shader::setDirLightScalar<float>(DirLightUniform uniform, unsigned int index, float val)
-{
-	assert(index < MAX_DIR_LIGHTS && "Invalid dir light index specified.");
-	glUniform1f(m_dirLightsUniforms[index][static_cast<int>(uniform)], val);
-}
-template<>
-inline void Shader::setDirLight<glm::vec3>(DirLightUniform uniform, unsigned int index, const glm::vec3& val)
-{
-	assert(index < MAX_DIR_LIGHTS && "Invalid dir light index specified.");
-	glUniform3f(m_dirLightsUniforms[index][static_cast<int>(uniform)], val.x, val.y, val.z);
-}
-// Point light
-template<>
-inline void Shader::setPointLightScalar<float>(PointLightUniform uniform, unsigned int index, float val)
-{
-	assert(index < MAX_POINT_LIGHTS && "Invalid point light index specified.");
-	glUniform1f(m_pointLightsUniforms[index][static_cast<int>(uniform)], val);
-}
-template<>
-inline void Shader::setPointLight<glm::vec3>(PointLightUniform uniform, unsigned int index, const glm::vec3& val)
-{
-	assert(index < MAX_POINT_LIGHTS && "Invalid point light index specified.");
-	glUniform3f(m_pointLightsUniforms[index][static_cast<int>(uniform)], val.x, val.y, val.z);
-
-}
-// Spot light
-template<>
-inline void Shader::setSpotLightScalar<float>(SpotLightUniform uniform, unsigned int index, float val)
-{
-	assert(index < MAX_SPOT_LIGHTS && "Invalid spot light index specified.");
-	glUniform1f(m_spotLightsUniforms[index][static_cast<int>(uniform)], val);
-}
-template<>
-inline void Shader::setSpotLight<glm::vec3>(SpotLightUniform uniform, unsigned int index, const glm::vec3& val)
-{
-	assert(index < MAX_SPOT_LIGHTS && "Invalid spot light index specified.");
-	glUniform3f(m_spotLightsUniforms[index][static_cast<int>(uniform)], val.x, val.y, val.z);
-}
+// ----------------------------------------------------------------------------
 
-// ----------------------------------------------------------------------------
\ No newline at end of file
+#endif // SHADER_H
\ No newline at end of file
@@ -0,0 +1,55 @@
+#ifndef SHADERVARIANTS_H
+#define SHADERVARIANTS_H
+
+// ----------------------------------------------------------------------------
+
+#include "Shader.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ----------------------------------------------------------------------------
+
+// Permutations of one program. Features known up front (display mode, light counts, ...)
+// are compiled in through #defines instead of being branched on in the shader, and every
+// set of definitions is built once and cached, keyed by the definitions.
+class ShaderVariants
+{
+public:
+	ShaderVariants();
+	~ShaderVariants();
+
+	// Stages shared by all the variants
+	void addShader(Shader::ShaderType type, const std::string& path);
+
+	// Start building a variant without waiting for it, the returned shader can be finished
+	// together with the other programs
+	Shader* prepare(const ShaderDefines& defines);
+
+	// Variant for the draw. A variant still being compiled is replaced by the last variant
+	// returned, so switching features doesn't stall the frame; the first one is built blocking.
+	Shader& variant(const ShaderDefines& defines);
+
+	inline size_t variantCount() const { return m_variants.size(); }
+
+private:
+	static std::string variantKey(const ShaderDefines& defines);
+
+	struct Stage
+	{
+		Shader::ShaderType type;
+		std::string path;
+	};
+
+	std::vector<Stage> m_stageList;
+	std::unordered_map<std::string, std::unique_ptr<Shader> > m_variants;
+
+	// Fallback while a new variant compiles
+	Shader* m_lastVariant;
+};
+
+// ----------------------------------------------------------------------------
+
+#endif // SHADERVARIANTS_H
@@ -0,0 +1,78 @@
+#ifndef SHADERWATCHER_H
+#define SHADERWATCHER_H
+
+// ----------------------------------------------------------------------------
+
+#include "Common.h"
+
+#include <vector>
+#include <chrono>
+
+// ----------------------------------------------------------------------------
+
+class Shader;
+
+// ----------------------------------------------------------------------------
+
+struct ShaderWatcherStats
+{
+	GLuint reloadCount = 0;
+	GLuint failedCount = 0;
+};
+
+// ----------------------------------------------------------------------------
+
+// Shader hot reload. The modification times of the watched stages are polled and a changed
+// program is rebuilt over the following frames: the files are read on worker threads, the
+// compile and link run on the driver threads when parallel compilation is available, and the
+// program is swapped in once finished. Rendering keeps the old program until then.
+class ShaderWatcher
+{
+private:
+	ShaderWatcher(void);
+	~ShaderWatcher(void);
+
+public:
+	// Time between two checks of the file modification times
+	static const int POLL_INTERVAL_MS = 500;
+
+	// Static access function
+	static ShaderWatcher& Instance()
+	{
+		static ShaderWatcher refInstance;
+		return refInstance;
+	}
+
+	void watch(Shader* shader);
+	void watch(const std::vector<Shader*>& shaderList);
+
+	// Advance the pending reloads and check the files, call once per frame
+	void update();
+
+	inline const ShaderWatcherStats& stats() const { return m_stats; }
+
+private:
+	enum class ReloadState
+	{
+		Idle,
+		Reading,
+		Linking,
+
+		Count,
+	};
+
+	struct WatchedShader
+	{
+		Shader* shader;
+		ReloadState state;
+	};
+
+	std::vector<WatchedShader> m_shaderList;
+	std::chrono::steady_clock::time_point m_lastPollTime;
+
+	ShaderWatcherStats m_stats;
+};
+
+// ----------------------------------------------------------------------------
+
+#endif // SHADERWATCHER_H
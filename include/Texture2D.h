@@ -31,7 +31,12 @@ public:
 
 	void init();
 	void bind(GLuint program);
+	// Point the sampler of the program to the texture unit, without binding the texture
+	void setSamplerUniform(GLuint program) const;
 	inline GLuint getHandler() { return m_uiTexture; }
+	inline GLuint handle() const { return m_uiTexture; }
+	// Every texture type has its own texture unit
+	inline GLuint textureUnit() const { return static_cast<GLuint>(m_textureType); }
 	inline const std::string& getPath() const { return m_sTexturePath; }
 	inline const TextureType getTextureType() const { return m_textureType; }
 
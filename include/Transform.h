@@ -11,39 +11,62 @@
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/quaternion.hpp>
 
+// Local transform stored as translation, rotation and scale. The matrices are cached
+// and recomputed only after a setter changed one of the components.
 class Transform
 {
 
 private:
-	
-	const glm::mat4 IDENTITY = glm::mat4(1.0f);
-	const glm::vec3 UP = glm::vec3(0.0f, 1.0f, 0.0f);
-	const glm::vec3 RIGHT = glm::vec3(1.0f, 0.0f, 0.0f);
-	const glm::vec3 FORWARD = glm::vec3(0.0f, 0.0f, 1.0f);
+
+	static const glm::vec3 UP;
+	static const glm::vec3 RIGHT;
+	static const glm::vec3 FORWARD;
 
 public:
 
 	Transform()
-		: m_scaleMat(IDENTITY), m_rotationMat(IDENTITY), m_translationMat(IDENTITY) {}
+		: m_position(0.0f), m_rotation(1.0f, 0.0f, 0.0f, 0.0f), m_scale(1.0f), m_modelMat(1.0f), m_normalMat(1.0f), m_dirty(false) {}
+
+	// Local matrices. Transforms owned by the TransformSystem are part of a hierarchy,
+	// use TransformSystem::worldMat/normalMat for the world space matrices.
+	inline const glm::mat4 &modelMat() const { if (m_dirty) updateMatrices(); return m_modelMat; }
+	inline const glm::mat4 &normalMat() const { if (m_dirty) updateMatrices(); return m_normalMat; }
+
+	// Parent space point to local space, without inverting the model matrix
+	inline glm::vec3 toLocal(const glm::vec3& point) const { return (glm::inverse(m_rotation) * (point - m_position)) / m_scale; }
+
+	inline bool dirty() const { return m_dirty; }
+	// No scaling - the normal matrix is the rotation and needs no inverse
+	inline bool isRigid() const { return m_scale == glm::vec3(1.0f); }
 
-	inline glm::mat4 modelMat() const { return m_translationMat * m_rotationMat * m_scaleMat; }
+	inline const glm::vec3 &position() const { return m_position; }
+	inline const glm::quat &rotation() const { return m_rotation; }
+	inline const glm::vec3 &scale() const { return m_scale; }
 
-	inline Transform &setPos(const glm::vec3& pos) { m_translationMat = glm::translate(pos); return *this; }
-	inline Transform &setPos(GLfloat x, GLfloat y, GLfloat z) { m_translationMat = glm::translate(glm::vec3(x, y, z)); return *this; }
+	inline Transform &setPos(const glm::vec3& pos) { if (pos != m_position) { m_position = pos; m_dirty = true; } return *this; }
+	inline Transform &setPos(GLfloat x, GLfloat y, GLfloat z) { return setPos(glm::vec3(x, y, z)); }
 
-	inline Transform &setRotation(const glm::vec3& rot) { m_rotationMat = glm::rotate(rot.z, FORWARD) * glm::rotate(rot.y, UP) * glm::rotate(rot.x, RIGHT); return *this; }
-	inline Transform &setRotation(GLfloat x, GLfloat y, GLfloat z) { m_rotationMat = glm::rotate(z, FORWARD) * glm::rotate(y, UP) * glm::rotate(x, RIGHT); return *this; }
-	inline Transform &setRotation(const glm::quat& rotation) { m_rotationMat = glm::toMat4(rotation); return *this; }
+	inline Transform &setRotation(const glm::vec3& rot) { return setRotation(glm::angleAxis(rot.z, FORWARD) * glm::angleAxis(rot.y, UP) * glm::angleAxis(rot.x, RIGHT)); }
+	inline Transform &setRotation(GLfloat x, GLfloat y, GLfloat z) { return setRotation(glm::vec3(x, y, z)); }
+	inline Transform &setRotation(const glm::quat& rotation) { if (rotation != m_rotation) { m_rotation = rotation; m_dirty = true; } return *this; }
+
+	inline Transform &setScale(const glm::vec3& scale) { if (scale != m_scale) { m_scale = scale; m_dirty = true; } return *this; }
+	inline Transform &setScale(GLfloat x, GLfloat y, GLfloat z) { return setScale(glm::vec3(x, y, z)); }
+
+	// Compute model = T * R * S and normal = R * S^-1 (the inverse transpose of the model matrix)
+	void updateMatrices() const;
 
-	inline Transform &setScale(const glm::vec3& scale) { m_scaleMat = glm::scale(scale); return *this; }
-	inline Transform &setScale(GLfloat x, GLfloat y, GLfloat z) { m_scaleMat = glm::scale(glm::vec3(x, y, z)); return *this; }
 protected:
 
 private:
 
-	glm::mat4 m_scaleMat;
-	glm::mat4 m_rotationMat;
-	glm::mat4 m_translationMat;
+	glm::vec3 m_position;
+	glm::quat m_rotation;
+	glm::vec3 m_scale;
+
+	mutable glm::mat4 m_modelMat;
+	mutable glm::mat4 m_normalMat;
+	mutable bool m_dirty;
 };
 
 
@@ -0,0 +1,92 @@
+#ifndef TRANSFORMSYSTEM_H
+#define TRANSFORMSYSTEM_H
+
+// ----------------------------------------------------------------------------
+
+#include <vector>
+
+#include "Transform.h"
+
+// ----------------------------------------------------------------------------
+
+// Stable reference to a transform owned by the TransformSystem
+typedef GLuint TransformHandle;
+const TransformHandle INVALID_TRANSFORM = ~0u;
+
+// ----------------------------------------------------------------------------
+
+// Transform hierarchy. The nodes are stored contiguously in depth-first order so parents
+// always come before their children and the world matrices are resolved in a single pass.
+// A world matrix is recomputed only when the node's local transform or its parent changed.
+class TransformSystem
+{
+private:
+	TransformSystem(void);
+	~TransformSystem(void);
+
+public:
+
+	// Static access function
+	static TransformSystem& Instance()
+	{
+		static TransformSystem refInstance;
+		return refInstance;
+	}
+
+	TransformHandle create(TransformHandle parent = INVALID_TRANSFORM);
+	// The children of the destroyed node are attached to its parent
+	void destroy(TransformHandle handle);
+	void setParent(TransformHandle handle, TransformHandle parent);
+
+	// Local transform, the reference is valid until the next create/destroy
+	inline Transform &local(TransformHandle handle) { return m_nodeList[m_handleToIndex[handle]].local; }
+	inline const Transform &local(TransformHandle handle) const { return m_nodeList[m_handleToIndex[handle]].local; }
+
+	inline const glm::mat4 &worldMat(TransformHandle handle) const { return m_nodeList[m_handleToIndex[handle]].worldMat; }
+	inline const glm::mat4 &normalMat(TransformHandle handle) const { return m_nodeList[m_handleToIndex[handle]].normalMat; }
+
+	// True if the world matrix changed in the last update
+	inline bool updated(TransformHandle handle) const { return m_nodeList[m_handleToIndex[handle]].updated; }
+
+	// World space point to the local space of the node
+	glm::vec3 toLocal(TransformHandle handle, const glm::vec3& point) const;
+
+	// Recompute the world matrices of the dirty nodes
+	void update();
+
+	inline size_t transformCount() const { return m_nodeList.size(); }
+	// Number of world matrices recomputed by the last update
+	inline size_t updatedCount() const { return m_updatedCount; }
+
+private:
+	struct Node
+	{
+		Transform local;
+		glm::mat4 worldMat = glm::mat4(1.0f);
+		glm::mat4 normalMat = glm::mat4(1.0f);
+
+		TransformHandle handle = INVALID_TRANSFORM;
+		TransformHandle parent = INVALID_TRANSFORM;
+		// Index of the parent in the node list, resolved when the order is rebuilt
+		GLuint parentIndex = INVALID_TRANSFORM;
+
+		// Attached to a new parent since the last update
+		bool reparented = true;
+		// World matrix recomputed by the current update
+		bool updated = false;
+	};
+
+	// Restore the depth-first order after the hierarchy changed
+	void sortNodes();
+
+	std::vector<Node> m_nodeList;
+	std::vector<GLuint> m_handleToIndex;
+	std::vector<TransformHandle> m_freeHandleList;
+
+	bool m_orderDirty;
+	size_t m_updatedCount;
+};
+
+// ----------------------------------------------------------------------------
+
+#endif // TRANSFORMSYSTEM_H
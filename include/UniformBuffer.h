@@ -0,0 +1,162 @@
+#ifndef UNIFORMBUFFER_H
+#define UNIFORMBUFFER_H
+
+// ----------------------------------------------------------------------------
+
+#include "Common.h"
+
+#include <assert.h>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+
+// ----------------------------------------------------------------------------
+
+// Uniform blocks shared by all the programs. The enum value is the binding point,
+// Shader::initialize connects every block found in a program to its binding point.
+enum class UniformBlock
+{
+	Camera = 0,
+	Frame,
+	Object,
+	DirectionalLights,
+	SpotLights,
+
+	Count,
+};
+
+// ----------------------------------------------------------------------------
+
+// std140 layout of the CameraData block
+struct CameraUniformData
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 viewProjection;
+	glm::vec3 viewPos;
+	float padding;
+	// Clip space to world space, for the positions rebuilt from depth
+	glm::mat4 inverseViewProjection;
+};
+
+// std140 layout of the FrameData block - render settings constant during the frame
+struct FrameUniformData
+{
+	glm::vec2 textureOffset;
+	glm::vec2 textureTile;
+	float gamma;
+	float gammaHDR;
+	float exposure;
+	float exposureBias;
+	float dispMapScale;
+	float normalMapScale;
+	GLint displayMode;
+	GLint toneMapper;
+};
+
+// ----------------------------------------------------------------------------
+
+// std140 layout of the ObjectData block - per draw data
+struct ObjectUniformData
+{
+	glm::mat4 model;
+	glm::mat4 normalMat;
+};
+
+// ----------------------------------------------------------------------------
+
+// std140 layout of one element of the DirectionalLightData block
+struct DirectionalLightUniformData
+{
+	glm::vec3 direction;
+	float padding0;
+	glm::vec3 color;
+	GLuint enabled;
+};
+
+// std140 layout of one element of the SpotLightData block
+struct SpotLightUniformData
+{
+	glm::vec3 position;
+	float padding0;
+	glm::vec3 color;
+	float padding1;
+	glm::vec3 direction;
+	float exponent;
+	float cutoff;
+	float coscutoff;
+	GLuint enabled;
+	float padding2;
+};
+
+// ----------------------------------------------------------------------------
+
+class UniformBuffer
+{
+public:
+	UniformBuffer();
+	~UniformBuffer();
+
+	UniformBuffer(const UniformBuffer&) = delete;
+	UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+	// Allocate the buffer storage and bind it to the block binding point
+	bool create(UniformBlock block, GLsizeiptr size);
+	void update(const void* data, GLsizeiptr size, GLintptr offset = 0);
+
+	template<typename T>
+	inline void update(const T& data) { update(&data, sizeof(T)); }
+
+	inline GLuint handle() const { return m_handle; }
+	inline GLsizeiptr size() const { return m_size; }
+
+	// Name of the block in the shader source
+	static const char* blockName(UniformBlock block);
+
+private:
+	GLuint m_handle;
+	GLsizeiptr m_size;
+	UniformBlock m_block;
+};
+
+// ----------------------------------------------------------------------------
+
+// Uniform buffer split in fixed size elements written front to back, for per draw data.
+// Consecutive writes never overwrite data a pending draw may still read, when the end is
+// reached the storage is orphaned and the writes start again from the front.
+class UniformBufferRing
+{
+public:
+	UniformBufferRing();
+	~UniformBufferRing();
+
+	UniformBufferRing(const UniformBufferRing&) = delete;
+	UniformBufferRing& operator=(const UniformBufferRing&) = delete;
+
+	bool create(UniformBlock block, GLsizeiptr elementSize, GLuint elementCount);
+
+	// Copy count tightly packed elements into the ring, returns the index of the first one.
+	// The elements stay valid until the ring wraps around.
+	GLuint write(const void* data, GLuint count);
+	// Attach an element to the block binding point
+	void bind(GLuint element) const;
+
+	template<typename T>
+	inline GLuint write(const T& data) { assert(sizeof(T) == m_elementSize); return write(&data, 1); }
+
+	inline GLuint capacity() const { return m_capacity; }
+
+private:
+	GLuint m_handle;
+	GLsizeiptr m_elementSize;
+	// Element size rounded up to the uniform buffer offset alignment
+	GLsizeiptr m_stride;
+	GLuint m_capacity;
+	GLuint m_head;
+	UniformBlock m_block;
+};
+
+// ----------------------------------------------------------------------------
+
+#endif // UNIFORMBUFFER_H
@@ -0,0 +1,239 @@
+#include "DepthPyramid.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <glm/glm.hpp>
+
+#include "Texture2D.h"
+#include "GLState.h"
+
+// ----------------------------------------------------------------------------
+
+DepthPyramid::DepthPyramid()
+	: m_frameIndex(0), m_depthWidth(0), m_depthHeight(0), m_viewProjection(1.0f), m_valid(false)
+{
+	for (int index = 0; index < 2; ++index)
+	{
+		m_pixelBuffers[index] = 0;
+		m_pending[index] = false;
+		m_pendingViewProjection[index] = glm::mat4(1.0f);
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+DepthPyramid::~DepthPyramid()
+{
+	glDeleteBuffers(2, m_pixelBuffers);
+}
+
+// ----------------------------------------------------------------------------
+
+bool DepthPyramid::initialize(GLsizei depthWidth, GLsizei depthHeight)
+{
+	m_depthWidth = depthWidth;
+	m_depthHeight = depthHeight;
+
+	GLsizei width = (depthWidth + REDUCTION_FACTOR - 1) / REDUCTION_FACTOR;
+	GLsizei height = (depthHeight + REDUCTION_FACTOR - 1) / REDUCTION_FACTOR;
+
+	// Reduction target
+	m_reduceFramebuffer.initialize(width, height)
+		.addColorTarget("MaxDepth", GL_R32F, GL_RED, GL_FLOAT);
+	if (m_reduceFramebuffer.create() == false)
+	{
+		std::cout << "Failed to initialize the depth reduction framebuffer.\n";
+		return false;
+	}
+
+	m_reduceShader.addShader(Shader::ShaderType::VERTEX, "../Shaders/quad.vert");
+	m_reduceShader.addShader(Shader::ShaderType::FRAGMENT, "../Shaders/depthReduce.frag");
+	if (m_reduceShader.initialize() == false)
+		return false;
+
+	// Read back buffers
+	glGenBuffers(2, m_pixelBuffers);
+	for (GLuint pixelBuffer : m_pixelBuffers)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, width * height * sizeof(float), nullptr, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	// Levels down to 1x1
+	m_levelList.clear();
+	while (true)
+	{
+		Level level;
+		level.width = width;
+		level.height = height;
+		level.depth.resize(width * height, 1.0f);
+		m_levelList.push_back(level);
+
+		if (width == 1 && height == 1)
+			break;
+
+		width = std::max(1, (width + 1) / 2);
+		height = std::max(1, (height + 1) / 2);
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+
+void DepthPyramid::capture(GLuint depthTexture, GLuint quadVAO, const glm::mat4& viewProjection)
+{
+	if (m_levelList.empty())
+		return;
+
+	Level& baseLevel = m_levelList[0];
+	const GLsizeiptr dataSize = baseLevel.width * baseLevel.height * sizeof(float);
+
+	unsigned int writeIndex = m_frameIndex % 2;
+	unsigned int readIndex = (m_frameIndex + 1) % 2;
+
+	// Collect the depth read back during the previous frame
+	if (m_pending[readIndex])
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pixelBuffers[readIndex]);
+		const float* data = static_cast<const float*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, dataSize, GL_MAP_READ_BIT));
+		if (data != nullptr)
+		{
+			memcpy(baseLevel.depth.data(), data, dataSize);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+
+			m_viewProjection = m_pendingViewProjection[readIndex];
+			buildLevels();
+			m_valid = true;
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		m_pending[readIndex] = false;
+	}
+
+	// Reduce the depth buffer
+	m_reduceFramebuffer.renderToTexture(Framebuffer::RenderTargetType::COLOR_TARGET, false);
+	m_reduceShader.useShader();
+	Texture2D::bind(m_reduceShader.uniformLocation("depthTexture"), depthTexture, 0);
+
+	GLState::Instance().bindVertexArray(quadVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 6);
+
+	// Start the read back, the data is fetched by the next capture
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pixelBuffers[writeIndex]);
+	glReadPixels(0, 0, baseLevel.width, baseLevel.height, GL_RED, GL_FLOAT, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	GLState::Instance().bindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	m_pending[writeIndex] = true;
+	m_pendingViewProjection[writeIndex] = viewProjection;
+	m_frameIndex++;
+}
+
+// ----------------------------------------------------------------------------
+
+void DepthPyramid::buildLevels()
+{
+	for (size_t levelIndex = 1; levelIndex < m_levelList.size(); ++levelIndex)
+	{
+		const Level& source = m_levelList[levelIndex - 1];
+		Level& destination = m_levelList[levelIndex];
+
+		for (GLsizei y = 0; y < destination.height; ++y)
+		{
+			GLsizei y0 = std::min(y * 2, source.height - 1);
+			GLsizei y1 = std::min(y * 2 + 1, source.height - 1);
+
+			for (GLsizei x = 0; x < destination.width; ++x)
+			{
+				GLsizei x0 = std::min(x * 2, source.width - 1);
+				GLsizei x1 = std::min(x * 2 + 1, source.width - 1);
+
+				destination.depth[y * destination.width + x] = std::max(
+					std::max(source.depth[y0 * source.width + x0], source.depth[y0 * source.width + x1]),
+					std::max(source.depth[y1 * source.width + x0], source.depth[y1 * source.width + x1]));
+			}
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+float DepthPyramid::maxDepth(const Level& level, int minX, int minY, int maxX, int maxY) const
+{
+	minX = std::max(minX, 0);
+	minY = std::max(minY, 0);
+	maxX = std::min(maxX, level.width - 1);
+	maxY = std::min(maxY, level.height - 1);
+
+	float result = 0.0f;
+	for (int y = minY; y <= maxY; ++y)
+		for (int x = minX; x <= maxX; ++x)
+			result = std::max(result, level.depth[y * level.width + x]);
+
+	return result;
+}
+
+// ----------------------------------------------------------------------------
+
+bool DepthPyramid::isOccluded(const BoundingBox& box) const
+{
+	if (m_valid == false || box.empty())
+		return false;
+
+	// Screen rectangle and nearest depth of the box
+	glm::vec2 screenMin(1.0f);
+	glm::vec2 screenMax(-1.0f);
+	float nearestDepth = 1.0f;
+
+	for (int corner = 0; corner < 8; ++corner)
+	{
+		glm::vec4 position(
+			(corner & 1) ? box.max.x : box.min.x,
+			(corner & 2) ? box.max.y : box.min.y,
+			(corner & 4) ? box.max.z : box.min.z,
+			1.0f);
+
+		glm::vec4 clip = m_viewProjection * position;
+
+		// Crossing the camera plane, can't be tested
+		if (clip.w <= 0.0f)
+			return false;
+
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		screenMin = glm::min(screenMin, glm::vec2(ndc));
+		screenMax = glm::max(screenMax, glm::vec2(ndc));
+		nearestDepth = std::min(nearestDepth, ndc.z * 0.5f + 0.5f);
+	}
+
+	// Outside the captured view, nothing to test against
+	if (screenMax.x < -1.0f || screenMax.y < -1.0f || screenMin.x > 1.0f || screenMin.y > 1.0f)
+		return false;
+
+	// Rectangle in base level texels
+	const float scaleX = 0.5f * m_depthWidth / REDUCTION_FACTOR;
+	const float scaleY = 0.5f * m_depthHeight / REDUCTION_FACTOR;
+	float minX = (glm::clamp(screenMin.x, -1.0f, 1.0f) + 1.0f) * scaleX;
+	float minY = (glm::clamp(screenMin.y, -1.0f, 1.0f) + 1.0f) * scaleY;
+	float maxX = (glm::clamp(screenMax.x, -1.0f, 1.0f) + 1.0f) * scaleX;
+	float maxY = (glm::clamp(screenMax.y, -1.0f, 1.0f) + 1.0f) * scaleY;
+
+	// Level where the rectangle covers at most 3x3 texels
+	float size = std::max(maxX - minX, maxY - minY);
+	int levelIndex = size > 2.0f ? static_cast<int>(std::ceil(std::log2(size * 0.5f))) : 0;
+	levelIndex = std::min(levelIndex, static_cast<int>(m_levelList.size()) - 1);
+
+	const float levelScale = 1.0f / static_cast<float>(1 << levelIndex);
+	float farthestDepth = maxDepth(m_levelList[levelIndex],
+		static_cast<int>(minX * levelScale), static_cast<int>(minY * levelScale),
+		static_cast<int>(maxX * levelScale), static_cast<int>(maxY * levelScale));
+
+	return nearestDepth > farthestDepth;
+}
+
+// ----------------------------------------------------------------------------
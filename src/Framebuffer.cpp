@@ -24,7 +24,7 @@ Framebuffer &Framebuffer::initialize(GLsizei width, GLsizei height)
 
 	// Create a render target
 	glGenFramebuffers(1, &m_framebufferHandle);
-	glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferHandle);
+	GLState::Instance().bindFramebuffer(GL_FRAMEBUFFER, m_framebufferHandle);
 
 	return *this;
 }
@@ -66,11 +66,14 @@ bool Framebuffer::create()
 	{
 		// Enable clear depth
 		m_clearMask |= GL_DEPTH_BUFFER_BIT;
+		if (m_stencilEnabled)
+			m_clearMask |= GL_STENCIL_BUFFER_BIT;
 
+		GLenum attachment = m_stencilEnabled ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
 		if (m_readDepth)
-			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, m_depthTexture, 0);
 		else
-			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthTexture);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, m_depthTexture);
 	}
 
 	// Check framebuffer status
@@ -78,7 +81,7 @@ bool Framebuffer::create()
 		return false;
 
 	// Unbind the framebuffer
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	GLState::Instance().bindFramebuffer(GL_FRAMEBUFFER, 0);
 
 	// Setup the vao for the rendering quad
 	m_uiScreenQuadVAO = renderTextureToScreenSetup();
@@ -97,7 +100,7 @@ Framebuffer &Framebuffer::addColorTarget(const std::string &rtName, GLint intern
 	GLuint colorTexture;
 	glGenTextures(1, &colorTexture);
 	// Bind color texture
-	glBindTexture(GL_TEXTURE_2D, colorTexture);
+	GLState::Instance().bindTexture(GL_TEXTURE_2D, colorTexture);
 	// Generate color texture
 	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, m_width, m_height, 0,
 		elementFormat,
@@ -117,6 +120,7 @@ Framebuffer &Framebuffer::addDepthTarget(GLint internalFormat, GLsizei width, GL
 {
 	m_depthEnabled = true;
 	m_readDepth = readDepth;
+	m_stencilEnabled = internalFormat == GL_DEPTH24_STENCIL8 || internalFormat == GL_DEPTH32F_STENCIL8;
 
 	// If we need the data from the depth buffer use a texture instead of a render buffer
 	if (readDepth)
@@ -124,9 +128,12 @@ Framebuffer &Framebuffer::addDepthTarget(GLint internalFormat, GLsizei width, GL
 		// Generate texture handle
 		glGenTextures(1, &m_depthTexture);
 		// Bind depth texture
-		glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+		GLState::Instance().bindTexture(GL_TEXTURE_2D, m_depthTexture);
 		// Generate depth texture
-		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width == 0 ? m_width : width, height == 0 ? m_height : height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
+		if (m_stencilEnabled)
+			glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width == 0 ? m_width : width, height == 0 ? m_height : height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, 0);
+		else
+			glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width == 0 ? m_width : width, height == 0 ? m_height : height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
 		// Setup filtering
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -154,7 +161,7 @@ GLuint Framebuffer::renderTextureToScreenSetup()
 	// Create quad vertex object
 	GLuint quadVertexArray;
 	glGenVertexArrays(1, &quadVertexArray);
-	glBindVertexArray(quadVertexArray);
+	GLState::Instance().bindVertexArray(quadVertexArray);
 
 	// Quad vertex data
 	static const GLfloat quadVertexData[] = {
@@ -179,7 +186,7 @@ GLuint Framebuffer::renderTextureToScreenSetup()
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
 
 	// Unbind vertex array object
-	glBindVertexArray(0);
+	GLState::Instance().bindVertexArray(0);
 
 	return quadVertexArray;
 }
@@ -188,7 +195,7 @@ GLuint Framebuffer::renderTextureToScreenSetup()
 
 void Framebuffer::renderToTexture(RenderTargetType targetType, bool clear)
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferHandle);
+	GLState::Instance().bindFramebuffer(GL_FRAMEBUFFER, m_framebufferHandle);
 	glClearColor(m_clearColor.x, m_clearColor.y, m_clearColor.z, m_clearColor.w);
 	
 	// Clear
@@ -205,7 +212,7 @@ void Framebuffer::renderToTexture(RenderTargetType targetType, bool clear)
 	}
 
 	// Set viewport and clear color and depth
-	glViewport(0, 0, m_width, m_height);
+	GLState::Instance().viewport(0, 0, m_width, m_height);
 }
 
 // ----------------------------------------------------------------------------
@@ -215,27 +222,21 @@ void Framebuffer::renderColorTargetToScreen(int x, int y, int width, int height,
 	assert(index < m_colorTextures.size());
 
 	// Bind the default framebuffer
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	GLState::Instance().bindFramebuffer(GL_FRAMEBUFFER, 0);
 	// Set the viewport and clear the color and depth buffers
-	glViewport(x, y, width, height);
-	// Bind the rendered texture to texture unit
-	// Activate texture unit 0
-	glActiveTexture(GL_TEXTURE0 + index);
+	GLState::Instance().viewport(x, y, width, height);
 	// Bind the rendered texture to texture unit
-	glBindTexture(GL_TEXTURE_2D, m_colorTextures[index]);
+	GLState::Instance().bindTexture(index, GL_TEXTURE_2D, m_colorTextures[index]);
 }
 
 void Framebuffer::renderDepthTargetToScreen(int x, int y, int width, int height, GLuint textureUnit)
 {
 	// Bind the default framebuffer
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	GLState::Instance().bindFramebuffer(GL_FRAMEBUFFER, 0);
 	// Set the viewport and clear the color and depth buffers
-	glViewport(x, y, width, height);
-	// Bind the rendered texture to texture unit
-	// Activate texture unit 0
-	glActiveTexture(GL_TEXTURE0 + textureUnit);
+	GLState::Instance().viewport(x, y, width, height);
 	// Bind the rendered texture to texture unit
-	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+	GLState::Instance().bindTexture(textureUnit, GL_TEXTURE_2D, m_depthTexture);
 }
 
 // ----------------------------------------------------------------------------
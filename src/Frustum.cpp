@@ -0,0 +1,144 @@
+#include "Frustum.h"
+
+#include <glm/glm.hpp>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#define FRUSTUM_USE_SSE 1
+#include <xmmintrin.h>
+#endif
+
+// ----------------------------------------------------------------------------
+
+Frustum::Frustum()
+{
+	for (glm::vec4& plane : m_planes)
+		plane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	updatePlaneBatches();
+}
+
+// ----------------------------------------------------------------------------
+
+Frustum::Frustum(const glm::mat4& matrix)
+{
+	update(matrix);
+}
+
+// ----------------------------------------------------------------------------
+
+void Frustum::update(const glm::mat4& matrix)
+{
+	// Rows of the column major matrix
+	glm::vec4 row0(matrix[0][0], matrix[1][0], matrix[2][0], matrix[3][0]);
+	glm::vec4 row1(matrix[0][1], matrix[1][1], matrix[2][1], matrix[3][1]);
+	glm::vec4 row2(matrix[0][2], matrix[1][2], matrix[2][2], matrix[3][2]);
+	glm::vec4 row3(matrix[0][3], matrix[1][3], matrix[2][3], matrix[3][3]);
+
+	// Gribb/Hartmann plane extraction
+	m_planes[static_cast<int>(Plane::Left)] = row3 + row0;
+	m_planes[static_cast<int>(Plane::Right)] = row3 - row0;
+	m_planes[static_cast<int>(Plane::Bottom)] = row3 + row1;
+	m_planes[static_cast<int>(Plane::Top)] = row3 - row1;
+	m_planes[static_cast<int>(Plane::Near)] = row3 + row2;
+	m_planes[static_cast<int>(Plane::Far)] = row3 - row2;
+
+	// Normalize so the plane equation gives the distance
+	for (glm::vec4& plane : m_planes)
+	{
+		float length = glm::length(glm::vec3(plane));
+		if (length > 0.0f)
+			plane /= length;
+	}
+
+	updatePlaneBatches();
+}
+
+// ----------------------------------------------------------------------------
+
+void Frustum::updatePlaneBatches()
+{
+	// The padding planes accept everything
+	for (int index = 0; index < PLANE_BATCH_SIZE; ++index)
+	{
+		glm::vec4 plane = index < static_cast<int>(Plane::Count) ? m_planes[index] : glm::vec4(0.0f, 0.0f, 0.0f, FLT_MAX);
+		m_planeX[index] = plane.x;
+		m_planeY[index] = plane.y;
+		m_planeZ[index] = plane.z;
+		m_planeW[index] = plane.w;
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+bool Frustum::intersectsSphere(const glm::vec3& center, float radius) const
+{
+	for (const glm::vec4& plane : m_planes)
+	{
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+			return false;
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+
+Frustum::Intersection Frustum::testBox(const BoundingBox& box) const
+{
+	const glm::vec3 center = box.center();
+	const glm::vec3 extents = box.extents();
+
+#ifdef FRUSTUM_USE_SSE
+	const __m128 centerX = _mm_set1_ps(center.x);
+	const __m128 centerY = _mm_set1_ps(center.y);
+	const __m128 centerZ = _mm_set1_ps(center.z);
+	const __m128 extentsX = _mm_set1_ps(extents.x);
+	const __m128 extentsY = _mm_set1_ps(extents.y);
+	const __m128 extentsZ = _mm_set1_ps(extents.z);
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+
+	int outsideMask = 0;
+	int intersectingMask = 0;
+
+	for (int batch = 0; batch < PLANE_BATCH_SIZE; batch += 4)
+	{
+		__m128 planeX = _mm_load_ps(m_planeX + batch);
+		__m128 planeY = _mm_load_ps(m_planeY + batch);
+		__m128 planeZ = _mm_load_ps(m_planeZ + batch);
+		__m128 planeW = _mm_load_ps(m_planeW + batch);
+
+		// Signed distance of the center
+		__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX, centerX), _mm_mul_ps(planeY, centerY)),
+			_mm_add_ps(_mm_mul_ps(planeZ, centerZ), planeW));
+		// Projected half size of the box on the plane normal
+		__m128 radius = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(_mm_andnot_ps(signMask, planeX), extentsX),
+			_mm_mul_ps(_mm_andnot_ps(signMask, planeY), extentsY)),
+			_mm_mul_ps(_mm_andnot_ps(signMask, planeZ), extentsZ));
+
+		outsideMask |= _mm_movemask_ps(_mm_cmplt_ps(distance, _mm_sub_ps(_mm_setzero_ps(), radius)));
+		intersectingMask |= _mm_movemask_ps(_mm_cmplt_ps(distance, radius));
+	}
+
+	if (outsideMask != 0)
+		return Intersection::Outside;
+
+	return intersectingMask != 0 ? Intersection::Intersecting : Intersection::Inside;
+#else
+	Intersection result = Intersection::Inside;
+	for (const glm::vec4& plane : m_planes)
+	{
+		float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+		float radius = glm::dot(glm::abs(glm::vec3(plane)), extents);
+
+		if (distance < -radius)
+			return Intersection::Outside;
+		if (distance < radius)
+			result = Intersection::Intersecting;
+	}
+
+	return result;
+#endif // FRUSTUM_USE_SSE
+}
+
+// ----------------------------------------------------------------------------
@@ -12,6 +12,17 @@
 #include "MaterialData.h"
 #include "Window.h"
 #include "CameraMan.h"
+#include "MeshCluster.h"
+#include "TransformSystem.h"
+#include "SceneCuller.h"
+#include "RenderQueue.h"
+#include "GLState.h"
+#include "ProgramCache.h"
+#include "ShaderWatcher.h"
+#include "LightGrid.h"
+#include "LightVolumes.h"
+
+#include <random>
 
 #include "ParticleSystem/ParticleSystem.h"
 
@@ -59,11 +70,139 @@ void GLFramework::update(double dt)
 		m_cameraMan.getActiveCamera()->updateView();
 	}
 
+	// Object transforms - unchanged values don't mark the transforms dirty
+	m_planeObjectDeferred->transform().setRotation(m_pGUI->m_rotation);
+	m_planeObjectDeferred->update(dt);
+
+	m_torusModelDeferred->transform().setRotation(m_pGUI->m_rotation);
+	m_torusModelDeferred->update(dt);
+
+	// The sphere follows the first point light
+	const LightData::PointLightArrays& pointLights = LightData::getInstance().pointLights();
+	if (pointLights.count() > 0)
+		m_pointLightObject->transform().setPos(glm::vec3(pointLights.positionRange[0]));
+	m_pointLightObject->transform().setRotation(m_pGUI->m_rotation);
+	m_pointLightObject->update(dt);
+
+	// Transform stage - recompute the matrices of the objects moved this frame
+	TransformSystem::Instance().update();
+	SceneCuller::Instance().update();
+
+	// Pick up edited shaders
+	ShaderWatcher::Instance().update();
+
+	// Publish the render settings, the camera matrices and the lights for the frame
+	updateFrameUniforms();
+	updateCameraUniforms();
+	const Camera* camera = m_cameraMan.getActiveCamera();
+	LightData::getInstance().updateBuffers(Frustum(camera->projMatrix() * camera->viewMatrix()));
+
+	// Bin the point lights to the view clusters
+	LightGrid::Instance().update(camera->viewMatrix(), camera->projMatrix());
+
 	// ------------------------------------------------------------------------
 }
 
 // ----------------------------------------------------------------------------
 
+void GLFramework::updateCameraUniforms()
+{
+	const Camera* camera = m_cameraMan.getActiveCamera();
+
+	CameraUniformData cameraData;
+	cameraData.view = camera->viewMatrix();
+	cameraData.projection = camera->projMatrix();
+	cameraData.viewProjection = cameraData.projection * cameraData.view;
+	cameraData.viewPos = camera->viewPos();
+	cameraData.padding = 0.0f;
+	cameraData.inverseViewProjection = glm::inverse(cameraData.viewProjection);
+
+	m_cameraUniformBuffer.update(cameraData);
+}
+
+// ----------------------------------------------------------------------------
+
+ShaderDefines GLFramework::lightingDefines() const
+{
+	// Loops only run over the lights in use and the debug views are separate programs.
+	// The point light count is read from the light buffer, adding lights doesn't recompile.
+	const LightData& lightData = LightData::getInstance();
+	ShaderDefines defines {
+		{ "DISPLAY_MODE", std::to_string(m_pGUI->m_displayModeSelection) },
+		{ "NUM_DIR_LIGHTS", std::to_string(lightData.directionalLightCount()) },
+	};
+
+	// Read the point lights from the cluster lists
+	if (LightGrid::Instance().enabled())
+	{
+		defines["CLUSTERED_LIGHTING"] = "1";
+		defines["LIGHT_TILE_SIZE"] = std::to_string(LightGrid::TILE_SIZE);
+	}
+
+	return defines;
+}
+
+// ----------------------------------------------------------------------------
+
+ShaderDefines GLFramework::gbufferDefines() const
+{
+	ShaderDefines defines;
+	if (m_compactGbuffer)
+		defines["COMPACT_GBUFFER"] = "1";
+
+	return defines;
+}
+
+// ----------------------------------------------------------------------------
+
+ShaderDefines GLFramework::deferredLightingDefines() const
+{
+	ShaderDefines defines = lightingDefines();
+	const ShaderDefines gbuffer = gbufferDefines();
+	defines.insert(gbuffer.begin(), gbuffer.end());
+
+	// The point and spot lights come from the light volumes
+	if (LightVolumes::Instance().enabled())
+	{
+		defines.erase("CLUSTERED_LIGHTING");
+		defines["LIGHT_VOLUMES"] = "1";
+	}
+
+	return defines;
+}
+
+// ----------------------------------------------------------------------------
+
+void GLFramework::bindLights(const Shader& shader) const
+{
+	// Past the units of the material and gbuffer textures
+	GLuint textureUnit = static_cast<GLuint>(TextureType::Count);
+	LightData::getInstance().bindPointLights(shader, textureUnit++);
+	if (LightGrid::Instance().enabled())
+		LightGrid::Instance().bind(shader, textureUnit);
+}
+
+// ----------------------------------------------------------------------------
+
+void GLFramework::updateFrameUniforms()
+{
+	FrameUniformData frameData;
+	frameData.textureOffset = m_pGUI->m_textureOffset;
+	frameData.textureTile = m_pGUI->m_textureTile;
+	frameData.gamma = m_pGUI->m_gamma;
+	frameData.gammaHDR = m_pGUI->m_gammaHDR;
+	frameData.exposure = m_pGUI->m_exposure;
+	frameData.exposureBias = m_pGUI->m_exposureBias;
+	frameData.dispMapScale = m_pGUI->m_dispMapScale;
+	frameData.normalMapScale = m_pGUI->m_normalMapScale;
+	frameData.displayMode = m_pGUI->m_displayModeSelection;
+	frameData.toneMapper = m_pGUI->m_toneMapperSelection;
+
+	m_frameUniformBuffer.update(frameData);
+}
+
+// ----------------------------------------------------------------------------
+
 void GLFramework::draw(double dt)
 {
 	glCheckError();
@@ -102,6 +241,16 @@ void GLFramework::draw(double dt)
 	// ------------------------------------------------------------------------
 	// Scene rendering
 
+	ClusterCuller::Instance().resetStats();
+	RenderQueue::Instance().resetStats();
+	GLState::Instance().resetStats();
+
+	// View frustum culling of the scene objects
+	const Camera* camera = m_cameraMan.getActiveCamera();
+	SceneCuller::Instance().cull(Frustum(camera->projMatrix() * camera->viewMatrix()));
+	if (SceneCuller::Instance().occlusionEnabled())
+		SceneCuller::Instance().cullOccluded(m_depthPyramid);
+
 	drawToGBuffer(dt);
 	drawDeferredLighting(dt);
 	drawForwardLighting(dt);
@@ -133,19 +282,22 @@ void GLFramework::drawGbufferToScreen()
 	glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, userEventID, -1, "GBufferToScreenPass");
 #endif // NDEBUG
 
-	glDepthFunc(GL_ALWAYS);
-	glDepthMask(GL_FALSE);
+	GLState::Instance().depthFunc(GL_ALWAYS);
+	GLState::Instance().depthMask(GL_FALSE);
 
 	// Draw gbuffer to screen
 	m_quadShader.useShader();
-	glBindVertexArray(m_quadVAO);
+	GLState::Instance().bindVertexArray(m_quadVAO);
 	GLuint textureUnit;
 	int leftOffset = 0;
 	int horizontalSpacing = 0;
 	int gbufferVisualisationWidth = 200;
 	int gbufferVisualisationHeight = 130;
 
-	if (m_pGUI->m_gBufferSettings.m_enablePosition)
+	// The compact layout has no position target, the others move down
+	const GLuint firstTarget = m_compactGbuffer ? 0 : 1;
+
+	if (m_pGUI->m_gBufferSettings.m_enablePosition && m_compactGbuffer == false)
 	{
 		// Position
 		textureUnit = 0;
@@ -159,7 +311,7 @@ void GLFramework::drawGbufferToScreen()
 	if (m_pGUI->m_gBufferSettings.m_enableNormal)
 	{
 		// Normal
-		textureUnit = 1;
+		textureUnit = firstTarget;
 		int left = leftOffset;
 		m_gbufferFramebuffer.renderColorTargetToScreen(left, 0, gbufferVisualisationWidth, gbufferVisualisationHeight, textureUnit);
 		m_quadShader.setScalar<unsigned int>(ShaderUniform::RenderedTexture, textureUnit);
@@ -170,7 +322,7 @@ void GLFramework::drawGbufferToScreen()
 	if (m_pGUI->m_gBufferSettings.m_enableAlbedo)
 	{
 		// Albedo
-		textureUnit = 2;
+		textureUnit = firstTarget + 1;
 		int left = leftOffset;
 		m_gbufferFramebuffer.renderColorTargetToScreen(left, 0, gbufferVisualisationWidth, gbufferVisualisationHeight, textureUnit);
 		m_quadShader.setScalar<unsigned int>(ShaderUniform::RenderedTexture, textureUnit);
@@ -181,7 +333,7 @@ void GLFramework::drawGbufferToScreen()
 	if (m_pGUI->m_gBufferSettings.m_enablePBR)
 	{
 		// PBR
-		textureUnit = 3;
+		textureUnit = firstTarget + 2;
 		int left = leftOffset;
 		m_gbufferFramebuffer.renderColorTargetToScreen(left, 0, gbufferVisualisationWidth, gbufferVisualisationHeight, textureUnit);
 		m_quadShader.setScalar<unsigned int>(ShaderUniform::RenderedTexture, textureUnit);
@@ -190,7 +342,7 @@ void GLFramework::drawGbufferToScreen()
 	}
 
 	m_quadDepthShader.useShader();
-	glBindVertexArray(m_quadVAO);
+	GLState::Instance().bindVertexArray(m_quadVAO);
 	if (m_pGUI->m_gBufferSettings.m_enableDepth)
 	{
 		// Depth
@@ -218,18 +370,14 @@ void GLFramework::drawToBackBuffer()
 #endif // NDEBUG
 
 	// Render color to screen
-	glDepthFunc(GL_ALWAYS);
-	glDepthMask(GL_FALSE);
+	GLState::Instance().depthFunc(GL_ALWAYS);
+	GLState::Instance().depthMask(GL_FALSE);
 	// Activate shader
-	glBindVertexArray(m_quadVAO);
+	GLState::Instance().bindVertexArray(m_quadVAO);
 	m_finalShader.useShader();
 	GLuint textureUnit = 0;
 	m_displayFramebuffer.renderColorTargetToScreen(0, 0, windowWidth(), windowHeight(), textureUnit);
-	// Set tone mapper
-	m_finalShader.setScalar<unsigned int>(ShaderUniform::ToneMapper, static_cast<unsigned int>(m_pGUI->m_toneMapperSelection));
-	m_finalShader.setScalar<float>(ShaderUniform::GammaHDR, m_pGUI->m_gammaHDR);
-	m_finalShader.setScalar<float>(ShaderUniform::Exposure, m_pGUI->m_exposure);
-	m_finalShader.setScalar<float>(ShaderUniform::ExposureBias, m_pGUI->m_exposureBias);
+	// Set the rendered texture, the tone mapper settings come from the FrameData block
 	m_finalShader.setScalar<unsigned int>(ShaderUniform::RenderedTexture, textureUnit);
 	// Draw triangles
 	glDrawArrays(GL_TRIANGLES, 0, 6);
@@ -250,7 +398,7 @@ void GLFramework::drawSkybox()
 #endif // NDEBUG
 
 	// Set the depth function to less or equal
-	glDepthFunc(GL_LEQUAL);
+	GLState::Instance().depthFunc(GL_LEQUAL);
 	// Activate the skybox shader
 	m_skyBox.useShader();
 	// Get rid of the translation component from the view matrix
@@ -260,7 +408,7 @@ void GLFramework::drawSkybox()
 	m_skyBox.set<glm::mat4>(ShaderUniform::ViewMat, v);
 	m_skyBox.set<glm::mat4>(ShaderUniform::ProjMat, p);
 	// Bind the cube VAO
-	glBindVertexArray(m_skyboxVAO);
+	GLState::Instance().bindVertexArray(m_skyboxVAO);
 	// Bind the environment texture
 	m_cubeMap2->bind(m_skyBox.program());
 	// Draw the cube
@@ -322,7 +470,7 @@ bool GLFramework::initialize(const char* windowTitle, bool enableMultisampling,
 	m_displayFramebuffer
 		.initialize(m_displayWidth, m_displayHeight)
 		.addColorTarget("DisplayColor", GL_RGBA16F, GL_RGBA, GL_FLOAT)
-		.addDepthTarget(GL_DEPTH_COMPONENT24);
+		.addDepthTarget(GL_DEPTH24_STENCIL8);
 	if (m_displayFramebuffer.create() == false)
 	{
 		std::cout << "Failed to initialize display framebuffer.\n";
@@ -339,18 +487,69 @@ bool GLFramework::initialize(const char* windowTitle, bool enableMultisampling,
 	}
 
 	// Create g buffer
-	m_gbufferFramebuffer.initialize(m_displayWidth, m_displayHeight)
-		.addColorTarget("Position", GL_RGB16F, GL_RGB, GL_FLOAT)
-		.addColorTarget("Normal", GL_RGB16F, GL_RGB, GL_FLOAT)
-		.addColorTarget("Albedo", GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE)
-		.addColorTarget("PBR", GL_RGB16F, GL_RGB, GL_FLOAT)
-		.addDepthTarget(GL_DEPTH_COMPONENT24);
+	m_gbufferFramebuffer.initialize(m_displayWidth, m_displayHeight);
+	if (m_compactGbuffer)
+	{
+		// 12 bytes per pixel instead of 22, the position is rebuilt from the depth
+		m_gbufferFramebuffer
+			.addColorTarget("Normal", GL_RG16, GL_RG, GL_UNSIGNED_SHORT)
+			.addColorTarget("Albedo", GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE)
+			.addColorTarget("PBR", GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+	}
+	else
+	{
+		m_gbufferFramebuffer
+			.addColorTarget("Position", GL_RGB16F, GL_RGB, GL_FLOAT)
+			.addColorTarget("Normal", GL_RGB16F, GL_RGB, GL_FLOAT)
+			.addColorTarget("Albedo", GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE)
+			.addColorTarget("PBR", GL_RGB16F, GL_RGB, GL_FLOAT);
+	}
+	m_gbufferFramebuffer.addDepthTarget(GL_DEPTH24_STENCIL8);
 	if (m_gbufferFramebuffer.create() == false)
 	{
 		std::cout << "Failed to initialize the g buffer.\n";
 		return false;
 	}
 
+	// Occlusion culling depth pyramid
+	if (m_depthPyramid.initialize(m_gbufferFramebuffer.width(), m_gbufferFramebuffer.height()) == false)
+	{
+		std::cout << "Failed to initialize the depth pyramid.\n";
+		return false;
+	}
+
+	// Per cluster light lists of the lighting passes
+	if (LightGrid::Instance().initialize(m_gbufferFramebuffer.width(), m_gbufferFramebuffer.height()) == false)
+	{
+		std::cout << "Failed to initialize the light grid.\n";
+		return false;
+	}
+
+	// Light volumes of the deferred pass, the G-buffer depth is copied into their stencil target
+	if (LightVolumes::Instance().initialize(m_gbufferFramebuffer.width(), m_gbufferFramebuffer.height(), gbufferDefines()) == false)
+	{
+		std::cout << "Failed to initialize the light volumes.\n";
+		return false;
+	}
+
+	glCheckError();
+
+	// Create the camera uniform buffer
+	if (m_cameraUniformBuffer.create(UniformBlock::Camera, sizeof(CameraUniformData)) == false)
+	{
+		std::cout << "Failed to initialize the camera uniform buffer.\n";
+		return false;
+	}
+
+	// Create the frame uniform buffer and the per draw ring
+	if (m_frameUniformBuffer.create(UniformBlock::Frame, sizeof(FrameUniformData)) == false)
+	{
+		std::cout << "Failed to initialize the frame uniform buffer.\n";
+		return false;
+	}
+	if (RenderQueue::Instance().initialize() == false)
+		return false;
+
 	glCheckError();
 
 	// Create the Texture2D object using the depth texture handler
@@ -390,63 +589,74 @@ bool GLFramework::setupScene()
 	// Load shaders
 	m_basicShader.addShader(Shader::ShaderType::VERTEX, "../Shaders/basic.vert");
 	m_basicShader.addShader(Shader::ShaderType::FRAGMENT, "../Shaders/basic.frag");
-	if (m_basicShader.initialize() == false) return false;
+	if (m_basicShader.submit() == false) return false;
 	
 	m_finalShader.addShader(Shader::ShaderType::VERTEX, "../Shaders/hdr.vert");
 	m_finalShader.addShader(Shader::ShaderType::FRAGMENT, "../Shaders/hdr.frag");
-	if (m_finalShader.initialize() == false) return false;
+	if (m_finalShader.submit() == false) return false;
 
 	m_phongColorShader.addShader(Shader::ShaderType::VERTEX, "../Shaders/phongColor.vert");
 	m_phongColorShader.addShader(Shader::ShaderType::FRAGMENT, "../Shaders/phongColor.frag");
-	if (m_phongColorShader.initialize() == false) return false;
+	if (m_phongColorShader.submit() == false) return false;
 
 	m_debugSolidColor.addShader(Shader::ShaderType::VERTEX, "../Shaders/debugSolidColor.vert");
 	m_debugSolidColor.addShader(Shader::ShaderType::FRAGMENT, "../Shaders/debugSolidColor.frag");
-	if (m_debugSolidColor.initialize() == false) return false;
+	if (m_debugSolidColor.submit() == false) return false;
 
 	m_phongTextureShader.addShader(Shader::ShaderType::VERTEX, "../Shaders/phongTexture.vert");
 	m_phongTextureShader.addShader(Shader::ShaderType::FRAGMENT, "../Shaders/phongTexture.frag");
-	if (m_phongTextureShader.initialize() == false) return false;
+	if (m_phongTextureShader.submit() == false) return false;
 
 	m_normalMapping.addShader(Shader::ShaderType::VERTEX, "../Shaders/normalMapping.vert");
 	m_normalMapping.addShader(Shader::ShaderType::FRAGMENT, "../Shaders/normalMapping.frag");
-	if (m_normalMapping.initialize() == false) return false;
+	if (m_normalMapping.submit() == false) return false;
 
 	m_parallaxMapping.addShader(Shader::ShaderType::VERTEX, "../Shaders/parallaxMapping.vert");
 	m_parallaxMapping.addShader(Shader::ShaderType::FRAGMENT, "../Shaders/parallaxMapping.frag");
-	if (m_parallaxMapping.initialize() == false) return false;
+	if (m_parallaxMapping.submit() == false) return false;
 
 	m_colorPBR.addShader(Shader::ShaderType::VERTEX, "../Shaders/simplePBR.vert");
 	m_colorPBR.addShader(Shader::ShaderType::FRAGMENT, "../Shaders/simplePBR.frag");
-	if (m_colorPBR.initialize() == false) return false;
+	if (m_colorPBR.submit() == false) return false;
 
 	m_pbr.addShader(Shader::ShaderType::VERTEX, "../Shaders/pbr.vert");
 	m_pbr.addShader(Shader::ShaderType::FRAGMENT, "../Shaders/pbr.frag");
-	if (m_pbr.initialize() == false) return false;
+
+	// Lighting variant for the startup settings, the others are built when selected
+	Shader* pbrVariant = m_pbr.prepare(lightingDefines());
 
 	m_depth.addShader(Shader::ShaderType::VERTEX, "../Shaders/shadowMap.vert");
 	m_depth.addShader(Shader::ShaderType::FRAGMENT, "../Shaders/shadowMap.frag");
-	if (m_depth.initialize() == false) return false;
+	if (m_depth.submit() == false) return false;
 
 	m_skyBox.addShader(Shader::ShaderType::VERTEX, "../Shaders/cubemap.vert");
 	m_skyBox.addShader(Shader::ShaderType::FRAGMENT, "../Shaders/cubemap.frag");
-	if (m_skyBox.initialize() == false) return false;
+	if (m_skyBox.submit() == false) return false;
 
+	m_gbuffer.setDefines(gbufferDefines());
 	m_gbuffer.addShader(Shader::ShaderType::VERTEX, "../Shaders/gbuffer.vert");
 	m_gbuffer.addShader(Shader::ShaderType::FRAGMENT, "../Shaders/gbuffer.frag");
-	if (m_gbuffer.initialize() == false) return false;
+	if (m_gbuffer.submit() == false) return false;
+
+	m_gbufferInstanced.setDefines(gbufferDefines());
+	m_gbufferInstanced.addShader(Shader::ShaderType::VERTEX, "../Shaders/gbufferInstanced.vert");
+	m_gbufferInstanced.addShader(Shader::ShaderType::FRAGMENT, "../Shaders/gbuffer.frag");
+	if (m_gbufferInstanced.submit() == false) return false;
+
+	// Objects queued with the same model and material are drawn instanced
+	RenderQueue::Instance().setInstancedShader(m_gbuffer, m_gbufferInstanced);
 
 	m_quadShader.addShader(Shader::ShaderType::VERTEX, "../Shaders/quad.vert");
 	m_quadShader.addShader(Shader::ShaderType::FRAGMENT, "../Shaders/quad.frag");
-	if (m_quadShader.initialize() == false) return false;
+	if (m_quadShader.submit() == false) return false;
 
 	m_quadDepthShader.addShader(Shader::ShaderType::VERTEX, "../Shaders/quadDepth.vert");
 	m_quadDepthShader.addShader(Shader::ShaderType::FRAGMENT, "../Shaders/quadDepth.frag");
-	if (m_quadDepthShader.initialize() == false) return false;
+	if (m_quadDepthShader.submit() == false) return false;
 
 	m_deferredLighting.addShader(Shader::ShaderType::VERTEX, "../Shaders/deferredLighting.vert");
 	m_deferredLighting.addShader(Shader::ShaderType::FRAGMENT, "../Shaders/deferredLighting.frag");
-	if (m_deferredLighting.initialize() == false) return false;
+	Shader* deferredLightingVariant = m_deferredLighting.prepare(deferredLightingDefines());
 
 	glCheckError();
 
@@ -529,6 +739,44 @@ bool GLFramework::setupScene()
 	m_planeObjectDeferred = std::make_unique<Object<VertexPNTT> >("../Assets/plane2.obj");
 	m_torusModelDeferred = std::make_unique<Object<VertexPNTT> >("../Assets/torus.obj");
 
+	// Static placement, only the rotation and the light position change per frame
+	m_planeObjectDeferred->transform()
+		.setPos(glm::vec3(0.0f, -1.0f, -2.0f))
+		.setScale(glm::vec3(0.5f, 0.001f, 0.5f));
+	m_torusModelDeferred->transform()
+		.setPos(glm::vec3(0.0f, -1.0f, -2.0f))
+		.setScale(glm::vec3(1.0f, 1.0f, 1.0f));
+	m_pointLightObject->transform()
+		.setScale(glm::vec3(0.01f));
+
+	// Scatter rocks over the deferred plane, drawn with one instanced draw call
+	m_rockBatch = std::make_unique<InstanceBatch<VertexPNTT> >("../Assets/rock.obj");
+	{
+		const int rockGridSize = 50;
+		const float rockSpacing = 8.0f / rockGridSize;
+
+		std::mt19937 randomGenerator(1234);
+		std::uniform_real_distribution<float> jitter(-0.4f, 0.4f);
+		std::uniform_real_distribution<float> angle(0.0f, glm::radians(360.0f));
+		std::uniform_real_distribution<float> scale(0.01f, 0.03f);
+
+		Transform rockTransform;
+		for (int x = 0; x < rockGridSize; x++)
+		{
+			for (int z = 0; z < rockGridSize; z++)
+			{
+				rockTransform
+					.setPos(glm::vec3(
+						(x - rockGridSize * 0.5f + jitter(randomGenerator)) * rockSpacing,
+						-1.0f,
+						-2.0f + (z - rockGridSize * 0.5f + jitter(randomGenerator)) * rockSpacing))
+					.setRotation(0.0f, angle(randomGenerator), 0.0f)
+					.setScale(glm::vec3(scale(randomGenerator)));
+				m_rockBatch->add(rockTransform);
+			}
+		}
+	}
+
 	// Load meshes
 	//m_pTorusModel = std::make_unique<Model<VertexPN> >("Assets/torus.obj");
 	//m_pMonkeyModel = std::make_unique<Model<VertexPN>>("Assets/mymodel.obj");
@@ -545,6 +793,28 @@ bool GLFramework::setupScene()
 
 	glCheckError();
 
+	// The programs were compiled by the driver while the assets were loading
+	std::vector<Shader*> shaderList = { &m_basicShader, &m_finalShader, &m_phongColorShader, &m_debugSolidColor, &m_phongTextureShader,
+		&m_normalMapping, &m_parallaxMapping, &m_colorPBR, &m_depth, &m_skyBox, &m_gbuffer, &m_gbufferInstanced,
+		&m_quadShader, &m_quadDepthShader };
+
+	// Rebuild the programs when their files are edited, the variants register themselves
+	ShaderWatcher::Instance().watch(shaderList);
+
+	shaderList.push_back(pbrVariant);
+	shaderList.push_back(deferredLightingVariant);
+
+	if (Shader::finishAll(shaderList) == false) return false;
+
+	// One write for the programs built at startup
+	ProgramCache::Instance().save();
+
+	const ProgramCacheStats& programCacheStats = ProgramCache::Instance().stats();
+	std::cout << "Programs loaded from the cache: " << programCacheStats.hitCount << " / " << programCacheStats.hitCount + programCacheStats.missCount
+		<< " (" << ProgramCache::Instance().savedTime() << " ms saved)\n";
+
+	glCheckError();
+
 	// Generate VAO
 	m_cubeVAO = Mesh<int>::vaoCubeSetup();
 	m_quadVAO = Mesh<int>::vaoQuadSetup();
@@ -553,7 +823,7 @@ bool GLFramework::setupScene()
 	// Generate and bind vertex array object (Required for OpenGL context > 3.1)
 	GLuint vertexArrayObject = 0;
 	glGenVertexArrays(1, &vertexArrayObject);
-	glBindVertexArray(vertexArrayObject);
+	GLState::Instance().bindVertexArray(vertexArrayObject);
 
 	glCheckError();
 
@@ -566,10 +836,12 @@ void GLFramework::drawScene(double dt)
 	// Do rendering
 	glm::mat4 v, p;
 
-	// Get lights
-	auto& pointLight0 = LightData::getInstance().pointLight(0);
-	//auto& directionalLight0 = LightData::getInstance().directionalLight(0);
-	auto& directionalLight1 = LightData::getInstance().directionalLight(1);
+	// Get lights, the first point light and the second directional light, if they exist
+	const LightData& lightData = LightData::getInstance();
+	const glm::vec3 pointLight0Position = lightData.pointLightCount() > 0 ?
+		glm::vec3(lightData.pointLights().positionRange[0]) : glm::vec3(0.0f);
+	const glm::vec3 directionalLight1Direction = lightData.directionalLightCount() > 1 ?
+		lightData.directionalLights().direction[1] : glm::vec3(1.0f, 0.0f, 0.0f);
 
 	// ------
 
@@ -578,47 +850,41 @@ void GLFramework::drawScene(double dt)
 	m_phongColorShader.useShader();
 	// Setup lighting
 	m_phongColorShader.set<glm::vec3>(ShaderUniform::LightColor, WHITE);
-	m_phongColorShader.set<glm::vec3>(ShaderUniform::LightDir, directionalLight1.direction);
+	m_phongColorShader.set<glm::vec3>(ShaderUniform::LightDir, directionalLight1Direction);
 	// Set uniforms
 	m_phongColorShader.setScalar<float>(ShaderUniform::Shininess, m_pGUI->m_shininess);
 	m_phongColorShader.setScalar<float>(ShaderUniform::SpecularStrength, m_pGUI->m_specularStrength);
 	// Draw point light sphere
 	m_pointLightObject->transform()
-		.setPos(pointLight0.position)
+		.setPos(pointLight0Position)
 		.setScale(glm::vec3(0.01f))
 		.setRotation(m_pGUI->m_rotation);
 	m_pointLightObject->update(dt);
+	TransformSystem::Instance().update();
 	m_pointLightObject->render(m_phongColorShader);
 
 	// ------------------------------------------------------------------------
 	// Render PBR
-	m_pbr.useShader();
-	// Setup lighting
-	m_pbr.updatePointLights();
-	m_pbr.updateDirectionalLights();
-	m_pbr.updateSpotLights();
+	Shader& pbrShader = m_pbr.variant(lightingDefines());
+	pbrShader.useShader();
 	// Set uniforms
-	m_depthMap->bind(m_pbr.program());
-	MaterialData::getInstance().matRustedIron.bindTextures(m_pbr.program());
-	m_pbr.set<glm::vec2>(ShaderUniform::TextureOffset, m_pGUI->m_textureOffset);
-	m_pbr.set<glm::vec2>(ShaderUniform::TextureTile, m_pGUI->m_textureTile);
-	m_pbr.setScalar<float>(ShaderUniform::DisplacementMapScale, m_pGUI->m_dispMapScale);
-	m_pbr.setScalar<float>(ShaderUniform::NormalMapScale, m_pGUI->m_normalMapScale);
-	m_pbr.setScalar<float>(ShaderUniform::Gamma, m_pGUI->m_gamma);
-	m_pbr.setScalar<unsigned int>(ShaderUniform::DisplayMode, m_pGUI->m_displayModeSelection);
+	m_depthMap->bind(pbrShader.program());
+	MaterialData::getInstance().matRustedIron.bindTextures(pbrShader.program());
+	bindLights(pbrShader);
 	// Draw main plane
 	m_planeObject->transform()
 		.setPos(glm::vec3(0.0f, -1.0f, -2.0f))
 		.setScale(glm::vec3(0.5f, 0.001f, 0.5f))
 		.setRotation(m_pGUI->m_rotation);
 	m_planeObject->update(dt);
-	m_planeObject->render(m_pbr);
+	TransformSystem::Instance().update();
+	m_planeObject->render(pbrShader);
 
 	// ------------------------------------------------------------------------
 	// Render the skybox
 
 	// Set the depth function to less or equal
-	glDepthFunc(GL_LEQUAL);
+	GLState::Instance().depthFunc(GL_LEQUAL);
 	// Activate the skybox shader
 	m_skyBox.useShader();
 	// Get rid of the translation component from the view matrix
@@ -628,13 +894,13 @@ void GLFramework::drawScene(double dt)
 	m_skyBox.set<glm::mat4>(ShaderUniform::ViewMat, v);
 	m_skyBox.set<glm::mat4>(ShaderUniform::ProjMat, p);
 	// Bind the cube VAO
-	glBindVertexArray(m_skyboxVAO);
+	GLState::Instance().bindVertexArray(m_skyboxVAO);
 	// Bind the environment texture
 	m_cubeMap2->bind(m_skyBox.program());
 	// Draw the cube
 	glDrawArrays(GL_TRIANGLES, 0, 36);
 	// Set the depth function to default
-	glDepthFunc(GL_LESS);
+	GLState::Instance().depthFunc(GL_LESS);
 
 	// ------------------------------------------------------------------------
 }
@@ -647,9 +913,9 @@ void GLFramework::drawToGBuffer(double dt)
 	glCheckError();
 #endif // NDEBUG
 
-	glEnable(GL_DEPTH_TEST);
-	glDepthFunc(GL_LESS);
-	glDepthMask(GL_TRUE);
+	GLState::Instance().enable(GL_DEPTH_TEST);
+	GLState::Instance().depthFunc(GL_LESS);
+	GLState::Instance().depthMask(GL_TRUE);
 
 	// -----------------------------------------------------------------------
 
@@ -657,38 +923,47 @@ void GLFramework::drawToGBuffer(double dt)
 	m_gbuffer.useShader();
 	m_gbufferFramebuffer.renderToTexture();
 
-	// Set uniforms
-	MaterialData::getInstance().matRustedIron.bindTextures(m_gbuffer.program());
-	m_gbuffer.set<glm::vec2>(ShaderUniform::TextureOffset, m_pGUI->m_textureOffset);
-	m_gbuffer.set<glm::vec2>(ShaderUniform::TextureTile, m_pGUI->m_textureTile);
-	m_gbuffer.setScalar<float>(ShaderUniform::DisplacementMapScale, m_pGUI->m_dispMapScale);
-	
-	// Draw main plane
-	m_planeObjectDeferred->transform()
-		.setPos(glm::vec3(0.0f, -1.0f, -2.0f))
-		.setScale(glm::vec3(0.5f, 0.001f, 0.5f))
-		.setRotation(m_pGUI->m_rotation);
-	m_planeObjectDeferred->update(dt);
-	m_planeObjectDeferred->render(m_gbuffer);
+	// The texture tiling and parallax settings come from the FrameData block,
+	// the textures are bound by the render queue
+	RenderQueue& renderQueue = RenderQueue::Instance();
+	MaterialTexturePBR* rustedIron = &MaterialData::getInstance().matRustedIron;
 
-	// Draw deferred torus
-	m_torusModelDeferred->transform()
-		.setPos(glm::vec3(0.0f, -1.0f, -2.0f))
-		.setScale(glm::vec3(1.0f, 1.0f, 1.0f))
-		.setRotation(m_pGUI->m_rotation);
-	m_torusModelDeferred->update(dt);
-	m_torusModelDeferred->render(m_gbuffer);
+	// Queue main plane
+	if (m_planeObjectDeferred->isVisible())
+		m_planeObjectDeferred->submit(renderQueue, RenderPass::GBuffer, m_gbuffer, rustedIron);
+
+	// Queue deferred torus
+	if (m_torusModelDeferred->isVisible())
+		m_torusModelDeferred->submit(renderQueue, RenderPass::GBuffer, m_gbuffer, rustedIron);
+
+	renderQueue.flush();
+
+	// Draw instanced rocks
+	if (m_pGUI->m_enableInstancedRocks)
+	{
+		m_gbufferInstanced.useShader();
+		MaterialData::getInstance().matRustedIron.bindTextures(m_gbufferInstanced.program());
+
+		m_rockBatch->render(m_gbufferInstanced);
+	}
 
 	// -----------------------------------------------------------------------
 
 	// Copy the contents of the depth buffer (gbuffer) into the depth buffer in the default framebuffer
-	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_gbufferFramebuffer.handle());
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_displayFramebuffer.handle());
+	GLState::Instance().bindFramebuffer(GL_READ_FRAMEBUFFER, m_gbufferFramebuffer.handle());
+	GLState::Instance().bindFramebuffer(GL_DRAW_FRAMEBUFFER, m_displayFramebuffer.handle());
 	glBlitFramebuffer(0, 0, m_gbufferFramebuffer.width(), m_gbufferFramebuffer.height(), 
 		0, 0, m_displayWidth, m_displayHeight, 
 		GL_DEPTH_BUFFER_BIT, 
 		GL_NEAREST);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	GLState::Instance().bindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	// Depth pyramid for the occlusion culling of the next frames
+	if (SceneCuller::Instance().occlusionEnabled())
+	{
+		const Camera* camera = m_cameraMan.getActiveCamera();
+		m_depthPyramid.capture(m_gbufferFramebuffer.depthTexture(), m_quadVAO, camera->projMatrix() * camera->viewMatrix());
+	}
 
 #ifndef NDEBUG
 	glPopDebugGroup();
@@ -703,36 +978,44 @@ void GLFramework::drawDeferredLighting(double dt)
 	glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, userEventID, -1, "DeferredLightingPass");
 #endif // NDDEBUG
 
-	glDepthFunc(GL_ALWAYS);
-	glDepthMask(GL_FALSE);
+	// Accumulate the point and spot lights through their volumes first
+	LightVolumes& lightVolumes = LightVolumes::Instance();
+	if (lightVolumes.enabled())
+	{
+		const Camera* camera = m_cameraMan.getActiveCamera();
+		lightVolumes.render(m_gbufferFramebuffer, camera->viewMatrix(), camera->projMatrix());
+	}
+
+	GLState::Instance().depthFunc(GL_ALWAYS);
+	GLState::Instance().depthMask(GL_FALSE);
 
 	// Set the display framebuffer as the active framebuffer
 	m_displayFramebuffer.renderToTexture();
 
 	// Set uniforms
-	m_deferredLighting.useShader();
-	// Setup lighting
-	m_deferredLighting.updatePointLights();
-	m_deferredLighting.updateDirectionalLights();
-	m_deferredLighting.updateSpotLights();
+	Shader& deferredLightingShader = m_deferredLighting.variant(deferredLightingDefines());
+	deferredLightingShader.useShader();
 	// Set uniforms
-	m_depthMap->bind(m_deferredLighting.program());
+	m_depthMap->bind(deferredLightingShader.program());
 	
 	// Bind gbuffer textures	
 	int textureUnitIndex = 0;
-	Texture2D::bind(glGetUniformLocation(m_deferredLighting.program(), "gPosition"), m_gbufferFramebuffer.colorTexture("Position"), textureUnitIndex++);
-	Texture2D::bind(glGetUniformLocation(m_deferredLighting.program(), "gNormal"), m_gbufferFramebuffer.colorTexture("Normal"), textureUnitIndex++);
-	Texture2D::bind(glGetUniformLocation(m_deferredLighting.program(), "gAlbedo"), m_gbufferFramebuffer.colorTexture("Albedo"), textureUnitIndex++);
-	Texture2D::bind(glGetUniformLocation(m_deferredLighting.program(), "gPBR"), m_gbufferFramebuffer.colorTexture("PBR"), textureUnitIndex++);
+	if (m_compactGbuffer)
+		Texture2D::bind(deferredLightingShader.uniformLocation("gDepth"), m_gbufferFramebuffer.depthTexture(), textureUnitIndex++);
+	else
+		Texture2D::bind(deferredLightingShader.uniformLocation("gPosition"), m_gbufferFramebuffer.colorTexture("Position"), textureUnitIndex++);
+	Texture2D::bind(deferredLightingShader.uniformLocation("gNormal"), m_gbufferFramebuffer.colorTexture("Normal"), textureUnitIndex++);
+	Texture2D::bind(deferredLightingShader.uniformLocation("gAlbedo"), m_gbufferFramebuffer.colorTexture("Albedo"), textureUnitIndex++);
+	Texture2D::bind(deferredLightingShader.uniformLocation("gPBR"), m_gbufferFramebuffer.colorTexture("PBR"), textureUnitIndex++);
+
+	// Point lights and their cluster lists
+	bindLights(deferredLightingShader);
+	if (lightVolumes.enabled())
+		Texture2D::bind(deferredLightingShader.uniformLocation("lightAccumulation"), lightVolumes.accumulationTexture(), textureUnitIndex++);
 
 	glCheckError();
 
-	m_deferredLighting.setScalar<float>(ShaderUniform::NormalMapScale, m_pGUI->m_normalMapScale);
-	m_deferredLighting.setScalar<float>(ShaderUniform::Gamma, m_pGUI->m_gamma);
-	m_deferredLighting.setScalar<unsigned int>(ShaderUniform::DisplayMode, m_pGUI->m_displayModeSelection);
-	m_deferredLighting.set<glm::vec3>(ShaderUniform::ViewPos, CameraMan::Instance().getActiveCamera()->viewPos());
-
-	glBindVertexArray(m_quadVAO);
+	GLState::Instance().bindVertexArray(m_quadVAO);
 	glDrawArrays(GL_TRIANGLES, 0, 6);
 
 #ifndef NDEBUG
@@ -748,8 +1031,8 @@ void GLFramework::drawForwardLighting(double dt)
 	glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, userEventID, -1, "ForwardLightingPass");
 #endif // NDEBUG
 
-	glDepthFunc(GL_LESS);
-	glDepthMask(GL_TRUE);
+	GLState::Instance().depthFunc(GL_LESS);
+	GLState::Instance().depthMask(GL_TRUE);
 
 	// Set the display framebuffer as the active framebuffer
 	m_displayFramebuffer.renderToTexture(Framebuffer::RenderTargetType::COLOR_TARGET, false);
@@ -763,12 +1046,9 @@ void GLFramework::drawForwardLighting(double dt)
 	// Set uniforms
 	m_debugSolidColor.set<glm::vec4>(ShaderUniform::DebugVisualisationObjectColor, WHITE);
 	// Draw point light sphere
-	m_pointLightObject->transform()
-		.setPos(LightData::getInstance().pointLight(0).position)
-		.setScale(glm::vec3(0.01f))
-		.setRotation(m_pGUI->m_rotation);
-	m_pointLightObject->update(dt);
-	m_pointLightObject->render(m_debugSolidColor);
+	if (m_pointLightObject->isVisible())
+		m_pointLightObject->submit(RenderQueue::Instance(), RenderPass::Forward, m_debugSolidColor);
+	RenderQueue::Instance().flush();
 
 	// ------------------------------------------------------------------------
 
@@ -785,8 +1065,11 @@ void GLFramework::drawSceneToDepth()
 	glm::mat4 lightProjection = glm::ortho(-10.0f, 10.0f,
 		-10.0f, 10.0f,
 		nearPlane, farPlane);
+	const LightData& lightData = LightData::getInstance();
+	const glm::vec3 lightDirection = lightData.directionalLightCount() > 0 ?
+		lightData.directionalLights().direction[0] : glm::vec3(1.0f, 0.0f, 0.0f);
 	glm::mat4 lightView = glm::lookAt(
-		-LightData::getInstance().directionalLight(0).direction,
+		-lightDirection,
 		glm::vec3(0.0f),
 		glm::vec3(0.0f, 1.0f, 0.0f)); // Up vector ?????
 	glm::mat4 lightMatrix = lightProjection * lightView;
@@ -798,7 +1081,7 @@ void GLFramework::drawSceneToDepth()
 	// Draw cube - phong
 
 	// Set matrices
-	glBindVertexArray(m_cubeVAO);
+	GLState::Instance().bindVertexArray(m_cubeVAO);
 	float scaleFactor = 0.04f;
 	glm::vec3 position = glm::vec3(-1.0f, 0.0f, -2.0f);
 	m = glm::mat4();
@@ -819,7 +1102,7 @@ void GLFramework::drawSceneToDepth()
 	// Draw cube pbr
 
 	// Set matrices
-	glBindVertexArray(m_cubeVAO);
+	GLState::Instance().bindVertexArray(m_cubeVAO);
 	scaleFactor = 0.08f;
 	position = glm::vec3(-3.0f, 0.0f, -2.0f);
 	m = glm::mat4();
@@ -0,0 +1,263 @@
+#include "GLState.h"
+
+#include <assert.h>
+
+// ----------------------------------------------------------------------------
+
+GLState::GLState()
+{
+	invalidate();
+}
+
+// ----------------------------------------------------------------------------
+
+GLState::~GLState()
+{
+}
+
+// ----------------------------------------------------------------------------
+
+void GLState::invalidate()
+{
+	m_program = UNKNOWN;
+	m_vertexArray = UNKNOWN;
+	m_readFramebuffer = UNKNOWN;
+	m_drawFramebuffer = UNKNOWN;
+	for (GLint& value : m_viewport)
+		value = -1;
+
+	m_depthFunc = UNKNOWN;
+	m_depthMask = UNKNOWN;
+	m_capabilities.clear();
+
+	m_activeTexture = UNKNOWN;
+	for (GLuint unit = 0; unit < MAX_TEXTURE_UNITS; ++unit)
+		for (GLuint& texture : m_textures[unit])
+			texture = UNKNOWN;
+}
+
+// ----------------------------------------------------------------------------
+
+int GLState::textureTargetIndex(GLenum target)
+{
+	switch (target)
+	{
+		case GL_TEXTURE_2D:
+			return static_cast<int>(TextureTarget::Texture2D);
+		case GL_TEXTURE_CUBE_MAP:
+			return static_cast<int>(TextureTarget::CubeMap);
+		case GL_TEXTURE_BUFFER:
+			return static_cast<int>(TextureTarget::TextureBuffer);
+		default:
+			return -1;
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+void GLState::useProgram(GLuint program)
+{
+	if (m_program == program)
+	{
+		elided();
+		return;
+	}
+
+	glUseProgram(program);
+	m_program = program;
+	issued();
+}
+
+// ----------------------------------------------------------------------------
+
+void GLState::bindVertexArray(GLuint vertexArrayObject)
+{
+	if (m_vertexArray == vertexArrayObject)
+	{
+		elided();
+		return;
+	}
+
+	glBindVertexArray(vertexArrayObject);
+	m_vertexArray = vertexArrayObject;
+	issued();
+}
+
+// ----------------------------------------------------------------------------
+
+void GLState::bindFramebuffer(GLenum target, GLuint framebuffer)
+{
+	bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+	bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+
+	if ((read == false || m_readFramebuffer == framebuffer) && (draw == false || m_drawFramebuffer == framebuffer))
+	{
+		elided();
+		return;
+	}
+
+	glBindFramebuffer(target, framebuffer);
+	if (read) m_readFramebuffer = framebuffer;
+	if (draw) m_drawFramebuffer = framebuffer;
+	issued();
+}
+
+// ----------------------------------------------------------------------------
+
+void GLState::viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	if (m_viewport[0] == x && m_viewport[1] == y && m_viewport[2] == width && m_viewport[3] == height)
+	{
+		elided();
+		return;
+	}
+
+	glViewport(x, y, width, height);
+	m_viewport[0] = x;
+	m_viewport[1] = y;
+	m_viewport[2] = width;
+	m_viewport[3] = height;
+	issued();
+}
+
+// ----------------------------------------------------------------------------
+
+void GLState::depthFunc(GLenum function)
+{
+	if (m_depthFunc == function)
+	{
+		elided();
+		return;
+	}
+
+	glDepthFunc(function);
+	m_depthFunc = function;
+	issued();
+}
+
+// ----------------------------------------------------------------------------
+
+void GLState::depthMask(GLboolean mask)
+{
+	if (m_depthMask == static_cast<GLuint>(mask))
+	{
+		elided();
+		return;
+	}
+
+	glDepthMask(mask);
+	m_depthMask = static_cast<GLuint>(mask);
+	issued();
+}
+
+// ----------------------------------------------------------------------------
+
+void GLState::enable(GLenum capability)
+{
+	auto it = m_capabilities.find(capability);
+	if (it != m_capabilities.end() && it->second)
+	{
+		elided();
+		return;
+	}
+
+	glEnable(capability);
+	m_capabilities[capability] = true;
+	issued();
+}
+
+// ----------------------------------------------------------------------------
+
+void GLState::disable(GLenum capability)
+{
+	auto it = m_capabilities.find(capability);
+	if (it != m_capabilities.end() && it->second == false)
+	{
+		elided();
+		return;
+	}
+
+	glDisable(capability);
+	m_capabilities[capability] = false;
+	issued();
+}
+
+// ----------------------------------------------------------------------------
+
+void GLState::activeTexture(GLuint unit)
+{
+	assert(unit < MAX_TEXTURE_UNITS && "Invalid texture unit.");
+
+	if (m_activeTexture == unit)
+	{
+		elided();
+		return;
+	}
+
+	glActiveTexture(GLenum(GL_TEXTURE0 + unit));
+	m_activeTexture = unit;
+	issued();
+}
+
+// ----------------------------------------------------------------------------
+
+void GLState::bindTexture(GLenum target, GLuint texture)
+{
+	int targetIndex = textureTargetIndex(target);
+
+	// Untracked target or unknown unit
+	if (targetIndex == -1 || m_activeTexture == UNKNOWN)
+	{
+		glBindTexture(target, texture);
+		if (m_activeTexture == UNKNOWN)
+		{
+			// Whichever unit is active now holds an unknown binding
+			for (GLuint unit = 0; unit < MAX_TEXTURE_UNITS; ++unit)
+				for (GLuint& boundTexture : m_textures[unit])
+					boundTexture = UNKNOWN;
+		}
+		issued();
+		return;
+	}
+
+	GLuint& boundTexture = m_textures[m_activeTexture][targetIndex];
+	if (boundTexture == texture)
+	{
+		elided();
+		return;
+	}
+
+	glBindTexture(target, texture);
+	boundTexture = texture;
+	issued();
+}
+
+// ----------------------------------------------------------------------------
+
+void GLState::bindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+	assert(unit < MAX_TEXTURE_UNITS && "Invalid texture unit.");
+
+	int targetIndex = textureTargetIndex(target);
+	if (targetIndex != -1 && m_textures[unit][targetIndex] == texture)
+	{
+		elided();
+		return;
+	}
+
+	activeTexture(unit);
+	bindTexture(target, texture);
+}
+
+// ----------------------------------------------------------------------------
+
+GLuint GLState::boundTexture(GLuint unit, GLenum target) const
+{
+	int targetIndex = textureTargetIndex(target);
+	if (unit >= MAX_TEXTURE_UNITS || targetIndex == -1)
+		return UNKNOWN;
+
+	return m_textures[unit][targetIndex];
+}
+
+// ----------------------------------------------------------------------------
@@ -2,6 +2,7 @@
 #include <iostream>
 #include <string>
 #include <algorithm>
+#include <random>
 #include <vector>
 
 #include "Input.h"
@@ -11,6 +12,14 @@
 #include "Material.h"
 #include "LightData.h"
 #include "MaterialData.h"
+#include "MeshCluster.h"
+#include "SceneCuller.h"
+#include "RenderQueue.h"
+#include "GLState.h"
+#include "ProgramCache.h"
+#include "ShaderWatcher.h"
+#include "LightGrid.h"
+#include "LightVolumes.h"
 
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
@@ -107,7 +116,68 @@ void GUI::draw()
 		// Frame
 		ImGui::ColorEdit3("Clear color", (float*)&m_clearColor);
 		ImGui::Checkbox("VSync", &m_enableVsync);
+		ImGui::Checkbox("Instanced rock field", &m_enableInstancedRocks);
 		ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+		ImGui::Separator();
+
+		// Object culling
+		auto &sceneCuller = SceneCuller::Instance();
+		const SceneCullingStats &sceneStats = sceneCuller.stats();
+		ImGui::Checkbox("Frustum culling", &sceneCuller.enabled());
+		ImGui::Text("Visible objects %u / %u (%u box tests)", sceneStats.visibleObjectCount, sceneStats.objectCount, sceneStats.testCount);
+		ImGui::Checkbox("Occlusion culling", &sceneCuller.occlusionEnabled());
+		ImGui::Text("Occluded objects %u", sceneStats.occludedObjectCount);
+
+		// Render queue
+		const RenderQueueStats &queueStats = RenderQueue::Instance().stats();
+		ImGui::Text("Queued draws %u", queueStats.itemCount);
+		ImGui::Text("Program binds %u (%u skipped)", queueStats.programBinds, queueStats.programBindsSkipped);
+		ImGui::Text("Texture binds %u (%u skipped)", queueStats.textureBinds, queueStats.textureBindsSkipped);
+		ImGui::Text("Vertex array binds %u (%u skipped)", queueStats.vertexArrayBinds, queueStats.vertexArrayBindsSkipped);
+		ImGui::Text("Instanced draws %u (%u items)", queueStats.instancedDraws, queueStats.instancedItems);
+
+		// State cache
+		const GLStateStats &stateStats = GLState::Instance().stats();
+		ImGui::Text("GL state calls %u (%u elided)", stateStats.issuedCount, stateStats.elidedCount);
+		ImGui::Text("Light upload %u bytes", (unsigned int)LightData::getInstance().uploadedSize());
+
+		// Light ranges, the point lights out of the view are not uploaded
+		auto &lightData = LightData::getInstance();
+		float lightCutoff = lightData.lightCutoff();
+		if (ImGui::SliderFloat("Light cutoff", &lightCutoff, 0.0005f, 0.05f, "%.4f", 2.0f))
+			lightData.setLightCutoff(lightCutoff);
+		ImGui::Text("Visible point lights %u / %u", (unsigned int)lightData.visiblePointLightCount(),
+			(unsigned int)lightData.pointLightCount());
+
+		// Program binary cache
+		const ProgramCacheStats &programCacheStats = ProgramCache::Instance().stats();
+		ImGui::Text("Cached programs %u / %u (%.1f ms saved)", programCacheStats.hitCount,
+			programCacheStats.hitCount + programCacheStats.missCount, ProgramCache::Instance().savedTime());
+		const ShaderWatcherStats &watcherStats = ShaderWatcher::Instance().stats();
+		ImGui::Text("Shader reloads %u (%u failed)", watcherStats.reloadCount, watcherStats.failedCount);
+
+		// Clustered lighting
+		auto &lightGrid = LightGrid::Instance();
+		const LightGridStats &lightGridStats = lightGrid.stats();
+		ImGui::Checkbox("Clustered lighting", &lightGrid.enabled());
+		ImGui::Text("Binned lights %u / %u, %.2f per cluster (max %u)", lightGridStats.binnedLightCount,
+			(unsigned int)lightData.visiblePointLightCount(),
+			lightGridStats.clusterCount > 0 ? (float)lightGridStats.indexCount / lightGridStats.clusterCount : 0.0f, lightGridStats.maxClusterLightCount);
+		ImGui::Text("Light binning %.3f ms", lightGridStats.binTime);
+
+		// Light volumes
+		auto &lightVolumes = LightVolumes::Instance();
+		const LightVolumeStats &lightVolumeStats = lightVolumes.stats();
+		ImGui::Checkbox("Light volumes", &lightVolumes.enabled());
+		ImGui::Text("Light volumes %u point, %u spot", lightVolumeStats.pointLightCount, lightVolumeStats.spotLightCount);
+
+		// Cluster culling
+		auto &clusterCuller = ClusterCuller::Instance();
+		const ClusterCullingStats &clusterStats = clusterCuller.stats();
+		ImGui::Checkbox("Cluster culling", &clusterCuller.enabled());
+		ImGui::Checkbox("Cluster back face culling", &clusterCuller.coneCullingEnabled());
+		ImGui::Text("Visible clusters %u / %u", clusterStats.visibleClusterCount, clusterStats.clusterCount);
+		ImGui::Text("Visible triangles %u / %u (%u draw ranges)", clusterStats.visibleTriangleCount, clusterStats.triangleCount, clusterStats.drawRangeCount);
 
 		ImGui::Unindent();
 	}
@@ -138,7 +208,7 @@ void GUI::draw()
 	// Rendering
 	ImGui::Render();
 	glfwGetFramebufferSize(m_window, &m_framebufferWidth, &m_framebufferHeight);
-	glViewport(0, 0, m_framebufferWidth, m_framebufferHeight);
+	GLState::Instance().viewport(0, 0, m_framebufferWidth, m_framebufferHeight);
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
 #ifndef NDEBUG
@@ -162,25 +232,40 @@ void GUI::drawLightPanel()
 	ImGui::ListBox("Light types", &m_lightTypeSelection, LightTypes.data(), (int)LightTypes.size());
 	// Add light source button
 	bool addLightSourcePressed = ImGui::Button("Add light source");
+	ImGui::SameLine();
+	if (ImGui::Button("Add 1024 small point lights"))
+	{
+		addTestPointLights(1024);
+		m_lightPanelRequiresUpdate = true;
+	}
 
 	ImGui::ListBox("Light sources", &m_lightSourceSelection, m_lightSourceNames.data(), (int)m_lightSourceNames.size());
 	// Display 
-	auto baseLight = LightData::getInstance().getLight(m_lightSourceSelection);
-	auto lightSourceType = baseLight->lightSourceType;
-	switch (lightSourceType)
+	LightData& lightData = LightData::getInstance();
+	if (m_lightSourceSelection >= 0 && m_lightSourceSelection < (int)lightData.lightCount())
 	{
-		case LightSourceType::Directional:
-			drawDirLightSettings(*(static_cast<DirectionalLight*>(baseLight)));
-			break;
-		case LightSourceType::Point:
-			drawPointLightSettings(*(static_cast<PointLight*>(baseLight)));
-			break;
-		case LightSourceType::Spot:
-			drawSpotLightSettings(*(static_cast<SpotLight*>(baseLight)));
-			break;
-		default:
-			std::cout << "Invalid light type selection.\n";
-			break;
+		LightHandle lightHandle = lightData.lightHandle(m_lightSourceSelection);
+		switch (lightData.lightType(lightHandle))
+		{
+			case LightSourceType::Directional:
+				drawDirLightSettings(lightHandle);
+				break;
+			case LightSourceType::Point:
+				drawPointLightSettings(lightHandle);
+				break;
+			case LightSourceType::Spot:
+				drawSpotLightSettings(lightHandle);
+				break;
+			default:
+				std::cout << "Invalid light type selection.\n";
+				break;
+		}
+
+		if (ImGui::Button("Remove light source"))
+		{
+			lightData.removeLight(lightHandle);
+			m_lightPanelRequiresUpdate = true;
+		}
 	}
 
 	if (addLightSourcePressed)
@@ -217,70 +302,127 @@ void GUI::drawLightPanel()
 	if (m_lightPanelRequiresUpdate) updateLightSourcesList();
 }
 
+void GUI::addTestPointLights(unsigned int count)
+{
+	// Short range lights scattered over the scene, for stress testing the light culling
+	static std::mt19937 generator;
+	std::uniform_real_distribution<float> horizontal(-10.0f, 10.0f);
+	std::uniform_real_distribution<float> vertical(-1.0f, 3.0f);
+	std::uniform_real_distribution<float> channel(0.0f, 1.0f);
+
+	for (unsigned int index = 0; index < count; ++index)
+	{
+		PointLight pointLight;
+		pointLight.position = glm::vec3(horizontal(generator), vertical(generator), horizontal(generator));
+		pointLight.color = glm::vec3(channel(generator), channel(generator), channel(generator));
+		pointLight.attenuation = glm::vec3(20.0f, 1.0f, 1.0f);
+		LightData::getInstance().addPointLight(pointLight);
+	}
+}
+
 void GUI::updateLightSourcesList()
 {
+	// Named after the type and the handle slot
+	const LightData& lightData = LightData::getInstance();
+	m_lightSources.clear();
+	for (size_t index = 0; index < lightData.lightCount(); ++index)
+	{
+		LightHandle lightHandle = lightData.lightHandle(index);
+		const char* typeName = "";
+		switch (lightData.lightType(lightHandle))
+		{
+			case LightSourceType::Directional: typeName = LightTypes[0]; break;
+			case LightSourceType::Point: typeName = LightTypes[1]; break;
+			case LightSourceType::Spot: typeName = LightTypes[2]; break;
+			default: break;
+		}
+		m_lightSources.push_back(typeName + std::to_string(lightHandle.slot));
+	}
+
 	m_lightSourceNames.clear();
-	m_lightSources = LightData::getInstance().getIds();
 	for (std::string &lightSource : m_lightSources)
 		m_lightSourceNames.push_back(lightSource.c_str());
 
+	m_lightSourceSelection = std::min(m_lightSourceSelection, (int)m_lightSources.size() - 1);
 	m_lightPanelRequiresUpdate = false;
 }
 
-void GUI::drawDirLightSettings(DirectionalLight &dirLight)
+// The settings edit a copy of the light, written back to LightData when a value changed
+
+void GUI::drawDirLightSettings(LightHandle lightHandle)
 {
-	ImGui::Checkbox("Enable", &dirLight.enabled);
-	ImGui::Checkbox("PBR color settings", &dirLight.pbrLight);
+	DirectionalLight dirLight = LightData::getInstance().directionalLight(lightHandle);
+
+	bool changed = ImGui::Checkbox("Enable", &dirLight.enabled);
+	changed |= ImGui::Checkbox("PBR color settings", &dirLight.pbrLight);
 	if (dirLight.pbrLight)
 	{
-		ImGui::ColorEdit3("Color", (float*)&dirLight.color);
+		changed |= ImGui::ColorEdit3("Color", (float*)&dirLight.color);
 	}
 	else
 	{
-		ImGui::ColorEdit3("AmbientComponent", (float*)&dirLight.ambientComp);
-		ImGui::ColorEdit3("DiffuseComponent", (float*)&dirLight.diffuseComp);
-		ImGui::ColorEdit3("SpecularComponent", (float*)&dirLight.specularComp);
+		changed |= ImGui::ColorEdit3("AmbientComponent", (float*)&dirLight.ambientComp);
+		changed |= ImGui::ColorEdit3("DiffuseComponent", (float*)&dirLight.diffuseComp);
+		changed |= ImGui::ColorEdit3("SpecularComponent", (float*)&dirLight.specularComp);
 	}
-	ImGui::SliderFloat3("Direction", &dirLight.direction.x, -1.0f, 1.0f);
+	changed |= ImGui::SliderFloat3("Direction", &dirLight.direction.x, -1.0f, 1.0f);
+
+	if (changed)
+		LightData::getInstance().setDirectionalLight(lightHandle, dirLight);
 }
 
-void GUI::drawPointLightSettings(PointLight &pointLight)
+void GUI::drawPointLightSettings(LightHandle lightHandle)
 {
-	ImGui::Checkbox("Enable", &pointLight.enabled);
-	ImGui::Checkbox("PBR color settings", &pointLight.pbrLight);
+	PointLight pointLight = LightData::getInstance().pointLight(lightHandle);
+
+	bool changed = ImGui::Checkbox("Enable", &pointLight.enabled);
+	changed |= ImGui::Checkbox("PBR color settings", &pointLight.pbrLight);
 	if (pointLight.pbrLight)
 	{
-		ImGui::ColorEdit3("Color", (float*)&pointLight.color);
+		changed |= ImGui::ColorEdit3("Color", (float*)&pointLight.color);
 	}
 	else
 	{
-		ImGui::ColorEdit3("AmbientComponent", (float*)&pointLight.ambientComp);
-		ImGui::ColorEdit3("DiffuseComponent", (float*)&pointLight.diffuseComp);
-		ImGui::ColorEdit3("SpecularComponent", (float*)&pointLight.specularComp);
+		changed |= ImGui::ColorEdit3("AmbientComponent", (float*)&pointLight.ambientComp);
+		changed |= ImGui::ColorEdit3("DiffuseComponent", (float*)&pointLight.diffuseComp);
+		changed |= ImGui::ColorEdit3("SpecularComponent", (float*)&pointLight.specularComp);
 	}
-	ImGui::SliderFloat3("Position", &pointLight.position.x, -100.0f, 100.0f);
-	ImGui::SliderFloat3("Attenuation", &pointLight.attenuation.x, 0.0f, 10.0f);
+	changed |= ImGui::SliderFloat3("Position", &pointLight.position.x, -100.0f, 100.0f);
+	changed |= ImGui::SliderFloat3("Attenuation", &pointLight.attenuation.x, 0.0f, 10.0f);
+
+	// The range follows the color and the attenuation
+	if (changed)
+	{
+		LightData::getInstance().setPointLight(lightHandle, pointLight);
+		pointLight = LightData::getInstance().pointLight(lightHandle);
+	}
+	ImGui::Text("Range %.2f", pointLight.range);
 }
 
-void GUI::drawSpotLightSettings(SpotLight &spotLight)
+void GUI::drawSpotLightSettings(LightHandle lightHandle)
 {
-	ImGui::Checkbox("Enable", &spotLight.enabled);
-	ImGui::Checkbox("PBR color settings", &spotLight.pbrLight);	
+	SpotLight spotLight = LightData::getInstance().spotLight(lightHandle);
+
+	bool changed = ImGui::Checkbox("Enable", &spotLight.enabled);
+	changed |= ImGui::Checkbox("PBR color settings", &spotLight.pbrLight);	
 	if (spotLight.pbrLight)
 	{
-		ImGui::ColorEdit3("Color", (float*)&spotLight.color);
+		changed |= ImGui::ColorEdit3("Color", (float*)&spotLight.color);
 	}
 	else
 	{
-		ImGui::ColorEdit3("AmbientComponent", (float*)&spotLight.ambientComp);
-		ImGui::ColorEdit3("DiffuseComponent", (float*)&spotLight.diffuseComp);
-		ImGui::ColorEdit3("SpecularComponent", (float*)&spotLight.specularComp);
+		changed |= ImGui::ColorEdit3("AmbientComponent", (float*)&spotLight.ambientComp);
+		changed |= ImGui::ColorEdit3("DiffuseComponent", (float*)&spotLight.diffuseComp);
+		changed |= ImGui::ColorEdit3("SpecularComponent", (float*)&spotLight.specularComp);
 	}
-	ImGui::SliderFloat3("Position", &spotLight.position.x, -100.0f, 100.0f);
-	ImGui::SliderFloat3("Direction", &spotLight.direction.x, -1.0f, 1.0f);
-	ImGui::SliderFloat("Coscutoff", &spotLight.coscutoff, -10.0f, 10.0f);
-	ImGui::SliderFloat("Cutoff", &spotLight.cutoff, -10.0f, 10.0f);
-	ImGui::SliderFloat("Exponent", &spotLight.exponent, -10.0f, 10.0f);
+	changed |= ImGui::SliderFloat3("Position", &spotLight.position.x, -100.0f, 100.0f);
+	changed |= ImGui::SliderFloat3("Direction", &spotLight.direction.x, -1.0f, 1.0f);
+	changed |= ImGui::SliderFloat("Coscutoff", &spotLight.coscutoff, -10.0f, 10.0f);
+	changed |= ImGui::SliderFloat("Cutoff", &spotLight.cutoff, -10.0f, 10.0f);
+	changed |= ImGui::SliderFloat("Exponent", &spotLight.exponent, -10.0f, 10.0f);
+
+	if (changed)
+		LightData::getInstance().setSpotLight(lightHandle, spotLight);
 }
 
 void GUI::drawObjectSettings()
@@ -0,0 +1,15 @@
+#include "GeometryMan.h"
+
+// ----------------------------------------------------------------------------
+
+GeometryMan::GeometryMan()
+{
+}
+
+// ----------------------------------------------------------------------------
+
+GeometryMan::~GeometryMan()
+{
+}
+
+// ----------------------------------------------------------------------------
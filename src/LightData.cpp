@@ -1,15 +1,44 @@
 #include "LightData.h"
 
-unsigned int DirectionalLight::m_dirLightCounter = 0;
-unsigned int PointLight::m_pointLightCounter = 0;
-unsigned int SpotLight::m_spotLightCounter = 0;
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "Frustum.h"
+#include "GLState.h"
+#include "Shader.h"
+
+const float LightData::MAX_LIGHT_RANGE = 10000.0f;
 
 void LightData::initialize()
 {
-	// Reserve space to store light source information
-	m_pointLights.reserve(MAX_POINT_LIGHTS);
-	m_directionalLights.reserve(MAX_DIR_LIGHTS);
-	m_spotLights.reserve(MAX_SPOT_LIGHTS);
+	// Light uniform buffers, cleared so the unused elements are disabled
+	m_dirLightUniforms.assign(MAX_DIR_LIGHTS, DirectionalLightUniformData{});
+	m_spotLightUniforms.assign(MAX_SPOT_LIGHTS, SpotLightUniformData{});
+
+	if (m_dirLightBuffer.create(UniformBlock::DirectionalLights, MAX_DIR_LIGHTS * sizeof(DirectionalLightUniformData)) == false ||
+		m_spotLightBuffer.create(UniformBlock::SpotLights, MAX_SPOT_LIGHTS * sizeof(SpotLightUniformData)) == false)
+	{
+		std::cout << "Failed to initialize the light uniform buffers.\n";
+	}
+	else
+	{
+		m_dirLightBuffer.update(m_dirLightUniforms.data(), m_dirLightBuffer.size());
+		m_spotLightBuffer.update(m_spotLightUniforms.data(), m_spotLightBuffer.size());
+	}
+
+	// Point light texture buffer, the storage is reallocated when the light count changes.
+	// An empty buffer can't back a texture, so it starts with one disabled light.
+	const glm::vec4 emptyLight[3] = { glm::vec4(0.0f), glm::vec4(0.0f), glm::vec4(0.0f) };
+	glGenBuffers(1, &m_pointLightBuffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, m_pointLightBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(emptyLight), emptyLight, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	glGenTextures(1, &m_pointLightTexture);
+	GLState::Instance().bindTexture(GL_TEXTURE_BUFFER, m_pointLightTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_pointLightBuffer);
+	m_pointLightTexels.assign(emptyLight, emptyLight + 3);
 
 	// Test point light source
 	PointLight pointLight0 = {};
@@ -39,3 +68,458 @@ void LightData::initialize()
 	directionalLight1.pbrLight = false;
 	addDirectionalLight(directionalLight1);
 }
+
+// ----------------------------------------------------------------------------
+
+// Append the shared fields of a light
+static void appendLight(LightData::LightArrays& lights, const BaseLight& light, GLuint slot)
+{
+	lights.color.push_back(light.color);
+	lights.ambientComp.push_back(light.ambientComp);
+	lights.diffuseComp.push_back(light.diffuseComp);
+	lights.specularComp.push_back(light.specularComp);
+	lights.enabled.push_back(light.enabled ? 1 : 0);
+	lights.pbrLight.push_back(light.pbrLight ? 1 : 0);
+	lights.dirty.push_back(1);
+	lights.slot.push_back(slot);
+}
+
+static void writeLight(LightData::LightArrays& lights, size_t index, const BaseLight& light)
+{
+	lights.color[index] = light.color;
+	lights.ambientComp[index] = light.ambientComp;
+	lights.diffuseComp[index] = light.diffuseComp;
+	lights.specularComp[index] = light.specularComp;
+	lights.enabled[index] = light.enabled ? 1 : 0;
+	lights.pbrLight[index] = light.pbrLight ? 1 : 0;
+	lights.dirty[index] = 1;
+}
+
+static void readLight(const LightData::LightArrays& lights, size_t index, BaseLight& outLight)
+{
+	outLight.color = lights.color[index];
+	outLight.ambientComp = lights.ambientComp[index];
+	outLight.diffuseComp = lights.diffuseComp[index];
+	outLight.specularComp = lights.specularComp[index];
+	outLight.enabled = lights.enabled[index] != 0;
+	outLight.pbrLight = lights.pbrLight[index] != 0;
+}
+
+// Move the last element to the removed one
+template<typename T>
+static void removeElement(std::vector<T>& list, size_t index)
+{
+	list[index] = list.back();
+	list.pop_back();
+}
+
+static void removeLightFields(LightData::LightArrays& lights, size_t index)
+{
+	removeElement(lights.color, index);
+	removeElement(lights.ambientComp, index);
+	removeElement(lights.diffuseComp, index);
+	removeElement(lights.specularComp, index);
+	removeElement(lights.enabled, index);
+	removeElement(lights.pbrLight, index);
+	removeElement(lights.dirty, index);
+	removeElement(lights.slot, index);
+
+	// The moved light has to be written at its new index
+	if (index < lights.count())
+		lights.dirty[index] = 1;
+}
+
+// ----------------------------------------------------------------------------
+
+LightHandle LightData::allocateHandle(LightSourceType type, size_t index)
+{
+	LightHandle handle;
+	if (m_freeSlots.empty())
+	{
+		handle.slot = static_cast<GLuint>(m_slots.size());
+		m_slots.push_back({ type, static_cast<GLuint>(index), 0 });
+	}
+	else
+	{
+		handle.slot = m_freeSlots.back();
+		m_freeSlots.pop_back();
+		m_slots[handle.slot].type = type;
+		m_slots[handle.slot].index = static_cast<GLuint>(index);
+	}
+	handle.generation = m_slots[handle.slot].generation;
+
+	m_lightHandles.push_back(handle);
+	return handle;
+}
+
+// ----------------------------------------------------------------------------
+
+bool LightData::isValid(LightHandle handle) const
+{
+	return handle.slot < m_slots.size() && m_slots[handle.slot].generation == handle.generation;
+}
+
+// ----------------------------------------------------------------------------
+
+LightHandle LightData::addPointLight(const PointLight &pointLight)
+{
+	const size_t index = m_pointLights.count();
+	LightHandle handle = allocateHandle(LightSourceType::Point, index);
+
+	appendLight(m_pointLights, pointLight, handle.slot);
+	m_pointLights.positionRange.push_back(glm::vec4(pointLight.position, 0.0f));
+	m_pointLights.attenuation.push_back(pointLight.attenuation);
+	updateRange(index);
+
+	return handle;
+}
+
+// ----------------------------------------------------------------------------
+
+LightHandle LightData::addDirectionalLight(const DirectionalLight &directionalLight)
+{
+	assert(m_directionalLights.count() < MAX_DIR_LIGHTS);
+	LightHandle handle = allocateHandle(LightSourceType::Directional, m_directionalLights.count());
+
+	appendLight(m_directionalLights, directionalLight, handle.slot);
+	m_directionalLights.direction.push_back(directionalLight.direction);
+
+	return handle;
+}
+
+// ----------------------------------------------------------------------------
+
+LightHandle LightData::addSpotLight(const SpotLight &spotLight)
+{
+	assert(m_spotLights.count() < MAX_SPOT_LIGHTS);
+	LightHandle handle = allocateHandle(LightSourceType::Spot, m_spotLights.count());
+
+	appendLight(m_spotLights, spotLight, handle.slot);
+	m_spotLights.position.push_back(spotLight.position);
+	m_spotLights.direction.push_back(spotLight.direction);
+	m_spotLights.exponent.push_back(spotLight.exponent);
+	m_spotLights.cutoff.push_back(spotLight.cutoff);
+	m_spotLights.coscutoff.push_back(spotLight.coscutoff);
+
+	return handle;
+}
+
+// ----------------------------------------------------------------------------
+
+void LightData::removeLight(LightHandle handle)
+{
+	if (isValid(handle) == false)
+	{
+		std::cout << "Invalid light handle.\n";
+		return;
+	}
+
+	LightSlot& slot = m_slots[handle.slot];
+	const size_t index = slot.index;
+	LightArrays* lights = nullptr;
+	switch (slot.type)
+	{
+		case LightSourceType::Point:
+			removeElement(m_pointLights.positionRange, index);
+			removeElement(m_pointLights.attenuation, index);
+			lights = &m_pointLights;
+			break;
+		case LightSourceType::Directional:
+			removeElement(m_directionalLights.direction, index);
+			lights = &m_directionalLights;
+			break;
+		case LightSourceType::Spot:
+			removeElement(m_spotLights.position, index);
+			removeElement(m_spotLights.direction, index);
+			removeElement(m_spotLights.exponent, index);
+			removeElement(m_spotLights.cutoff, index);
+			removeElement(m_spotLights.coscutoff, index);
+			lights = &m_spotLights;
+			break;
+		default:
+			return;
+	}
+	removeLightFields(*lights, index);
+
+	// Point the slot of the moved light to its new index
+	if (index < lights->count())
+		m_slots[lights->slot[index]].index = static_cast<GLuint>(index);
+
+	slot.generation++;
+	m_freeSlots.push_back(handle.slot);
+	m_lightHandles.erase(std::find(m_lightHandles.begin(), m_lightHandles.end(), handle));
+}
+
+// ----------------------------------------------------------------------------
+
+PointLight LightData::pointLight(LightHandle handle) const
+{
+	const size_t index = lightIndex(handle, LightSourceType::Point);
+
+	PointLight light;
+	readLight(m_pointLights, index, light);
+	light.position = glm::vec3(m_pointLights.positionRange[index]);
+	light.range = m_pointLights.positionRange[index].w;
+	light.attenuation = m_pointLights.attenuation[index];
+	return light;
+}
+
+// ----------------------------------------------------------------------------
+
+DirectionalLight LightData::directionalLight(LightHandle handle) const
+{
+	const size_t index = lightIndex(handle, LightSourceType::Directional);
+
+	DirectionalLight light;
+	readLight(m_directionalLights, index, light);
+	light.direction = m_directionalLights.direction[index];
+	return light;
+}
+
+// ----------------------------------------------------------------------------
+
+SpotLight LightData::spotLight(LightHandle handle) const
+{
+	const size_t index = lightIndex(handle, LightSourceType::Spot);
+
+	SpotLight light;
+	readLight(m_spotLights, index, light);
+	light.position = m_spotLights.position[index];
+	light.direction = m_spotLights.direction[index];
+	light.exponent = m_spotLights.exponent[index];
+	light.cutoff = m_spotLights.cutoff[index];
+	light.coscutoff = m_spotLights.coscutoff[index];
+	return light;
+}
+
+// ----------------------------------------------------------------------------
+
+void LightData::setPointLight(LightHandle handle, const PointLight &pointLight)
+{
+	const size_t index = lightIndex(handle, LightSourceType::Point);
+
+	writeLight(m_pointLights, index, pointLight);
+	m_pointLights.positionRange[index] = glm::vec4(pointLight.position, 0.0f);
+	m_pointLights.attenuation[index] = pointLight.attenuation;
+	updateRange(index);
+}
+
+// ----------------------------------------------------------------------------
+
+void LightData::setDirectionalLight(LightHandle handle, const DirectionalLight &directionalLight)
+{
+	const size_t index = lightIndex(handle, LightSourceType::Directional);
+
+	writeLight(m_directionalLights, index, directionalLight);
+	m_directionalLights.direction[index] = directionalLight.direction;
+}
+
+// ----------------------------------------------------------------------------
+
+void LightData::setSpotLight(LightHandle handle, const SpotLight &spotLight)
+{
+	const size_t index = lightIndex(handle, LightSourceType::Spot);
+
+	writeLight(m_spotLights, index, spotLight);
+	m_spotLights.position[index] = spotLight.position;
+	m_spotLights.direction[index] = spotLight.direction;
+	m_spotLights.exponent[index] = spotLight.exponent;
+	m_spotLights.cutoff[index] = spotLight.cutoff;
+	m_spotLights.coscutoff[index] = spotLight.coscutoff;
+}
+
+// ----------------------------------------------------------------------------
+
+void LightData::updateRange(size_t index)
+{
+	const glm::vec3 color = m_pointLights.pbrLight[index] ? m_pointLights.color[index] : BLACK3;
+	m_pointLights.positionRange[index].w = pointLightRange(m_pointLights.attenuation[index], color, m_lightCutoff);
+	m_pointLights.dirty[index] = 1;
+}
+
+// ----------------------------------------------------------------------------
+
+void LightData::setLightCutoff(float cutoff)
+{
+	m_lightCutoff = cutoff;
+	for (size_t index = 0; index < m_pointLights.count(); ++index)
+		updateRange(index);
+}
+
+// ----------------------------------------------------------------------------
+
+float LightData::pointLightRange(const glm::vec3& attenuation, const glm::vec3& color, float cutoff)
+{
+	float maxComponent = std::max(color.r, std::max(color.g, color.b));
+	if (maxComponent <= 0.0f)
+		return 0.0f;
+
+	// Solve quadratic * d^2 + linear * d + constant = maxComponent / cutoff
+	float constant = attenuation.z - maxComponent / cutoff;
+	if (constant >= 0.0f)
+		return 0.0f;
+
+	if (attenuation.x > 0.0f)
+		return std::min(MAX_LIGHT_RANGE, (-attenuation.y + std::sqrt(attenuation.y * attenuation.y - 4.0f * attenuation.x * constant)) / (2.0f * attenuation.x));
+	if (attenuation.y > 0.0f)
+		return std::min(MAX_LIGHT_RANGE, -constant / attenuation.y);
+
+	// No falloff
+	return MAX_LIGHT_RANGE;
+}
+
+// ----------------------------------------------------------------------------
+
+float LightData::spotLightRange(const glm::vec3& color, float cutoff)
+{
+	float maxComponent = std::max(color.r, std::max(color.g, color.b));
+	return maxComponent > 0.0f ? std::sqrt(maxComponent / cutoff) : 0.0f;
+}
+
+// ----------------------------------------------------------------------------
+
+// Write the uniforms of the flagged lights and clear the elements left by removed lights,
+// then upload the range spanning the written elements
+template<typename T, typename FillFunction>
+static size_t writeDirtyUniforms(UniformBuffer& buffer, std::vector<T>& uniformList, LightData::LightArrays& lights,
+	size_t uploadedCount, FillFunction fill)
+{
+	const size_t count = lights.count();
+	size_t first = std::max(count, uploadedCount);
+	size_t last = 0;
+
+	for (size_t index = 0; index < count; ++index)
+	{
+		if (lights.dirty[index] == 0)
+			continue;
+
+		fill(index, uniformList[index]);
+		lights.dirty[index] = 0;
+		first = std::min(first, index);
+		last = index + 1;
+	}
+
+	for (size_t index = count; index < uploadedCount; ++index)
+	{
+		uniformList[index] = T{};
+		first = std::min(first, index);
+		last = index + 1;
+	}
+
+	if (first >= last)
+		return 0;
+
+	size_t size = (last - first) * sizeof(T);
+	buffer.update(&uniformList[first], size, first * sizeof(T));
+	return size;
+}
+
+// ----------------------------------------------------------------------------
+
+void LightData::updateBuffers(const Frustum& frustum)
+{
+	// Only the PBR color is part of the blocks, lights set up for Phong shading contribute nothing
+	const DirectionalLightArrays& dirLights = m_directionalLights;
+	m_uploadedSize = writeDirtyUniforms(m_dirLightBuffer, m_dirLightUniforms, m_directionalLights, m_uploadedDirLightCount,
+		[&dirLights](size_t index, DirectionalLightUniformData& outData)
+	{
+		outData.direction = dirLights.direction[index];
+		outData.color = dirLights.pbrLight[index] ? dirLights.color[index] : BLACK3;
+		outData.enabled = dirLights.enabled[index];
+	});
+	m_uploadedDirLightCount = m_directionalLights.count();
+
+	const SpotLightArrays& spotLights = m_spotLights;
+	m_uploadedSize += writeDirtyUniforms(m_spotLightBuffer, m_spotLightUniforms, m_spotLights, m_uploadedSpotLightCount,
+		[&spotLights](size_t index, SpotLightUniformData& outData)
+	{
+		outData.position = spotLights.position[index];
+		outData.color = spotLights.pbrLight[index] ? spotLights.color[index] : BLACK3;
+		outData.direction = spotLights.direction[index];
+		outData.exponent = spotLights.exponent[index];
+		outData.cutoff = spotLights.cutoff[index];
+		outData.coscutoff = spotLights.coscutoff[index];
+		outData.enabled = spotLights.enabled[index];
+	});
+	m_uploadedSpotLightCount = m_spotLights.count();
+
+	// Only the point lights reaching into the view are uploaded, the others would cost shader
+	// iterations without contributing
+	std::swap(m_visiblePointLightList, m_uploadedPointLightList);
+	m_visiblePointLightList.clear();
+	for (size_t index = 0; index < m_pointLights.count(); ++index)
+	{
+		const glm::vec4& positionRange = m_pointLights.positionRange[index];
+		if (m_pointLights.enabled[index] && positionRange.w > 0.0f && frustum.intersectsSphere(glm::vec3(positionRange), positionRange.w))
+			m_visiblePointLightList.push_back(index);
+	}
+
+	// Three sections: position and range, color and enabled flag, attenuation. The texture is
+	// sized from the buffer, so the sections are laid out for the current count. An empty
+	// buffer can't back a texture, no visible light keeps one disabled light.
+	const size_t visibleCount = m_visiblePointLightList.size();
+	const size_t pointLightCount = std::max<size_t>(visibleCount, 1);
+	auto writeTexels = [this, pointLightCount](size_t index)
+	{
+		const size_t lightIndex = m_visiblePointLightList[index];
+		m_pointLightTexels[index] = m_pointLights.positionRange[lightIndex];
+		m_pointLightTexels[pointLightCount + index] = glm::vec4(m_pointLights.pbrLight[lightIndex] ? m_pointLights.color[lightIndex] : BLACK3, 1.0f);
+		m_pointLightTexels[pointLightCount * 2 + index] = glm::vec4(m_pointLights.attenuation[lightIndex], 0.0f);
+	};
+
+	glBindBuffer(GL_TEXTURE_BUFFER, m_pointLightBuffer);
+	if (visibleCount != m_uploadedPointLightList.size())
+	{
+		// The visible light count changed, every section moved
+		m_pointLightTexels.assign(pointLightCount * 3, glm::vec4(0.0f));
+		for (size_t index = 0; index < visibleCount; ++index)
+			writeTexels(index);
+
+		glBufferData(GL_TEXTURE_BUFFER, m_pointLightTexels.size() * sizeof(glm::vec4), m_pointLightTexels.data(), GL_DYNAMIC_DRAW);
+		m_uploadedSize += m_pointLightTexels.size() * sizeof(glm::vec4);
+		m_pointLightsChanged = true;
+	}
+	else
+	{
+		// Only the entries holding another light or a changed light are written, a light
+		// touches the same range of all three sections
+		size_t first = visibleCount;
+		size_t last = 0;
+		for (size_t index = 0; index < visibleCount; ++index)
+		{
+			const size_t lightIndex = m_visiblePointLightList[index];
+			if (m_uploadedPointLightList[index] == lightIndex && m_pointLights.dirty[lightIndex] == 0)
+				continue;
+
+			writeTexels(index);
+			first = std::min(first, index);
+			last = index + 1;
+		}
+
+		m_pointLightsChanged = first < last;
+		if (m_pointLightsChanged)
+		{
+			const size_t size = (last - first) * sizeof(glm::vec4);
+			for (size_t section = 0; section < 3; ++section)
+			{
+				const size_t offset = section * pointLightCount + first;
+				glBufferSubData(GL_TEXTURE_BUFFER, offset * sizeof(glm::vec4), size, &m_pointLightTexels[offset]);
+			}
+			m_uploadedSize += size * 3;
+		}
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	// Lights out of the view are written again when they get into an entry of the list
+	std::fill(m_pointLights.dirty.begin(), m_pointLights.dirty.end(), 0);
+}
+
+// ----------------------------------------------------------------------------
+
+void LightData::bindPointLights(const Shader& shader, GLuint textureUnit) const
+{
+	GLState::Instance().bindTexture(textureUnit, GL_TEXTURE_BUFFER, m_pointLightTexture);
+	glUniform1i(shader.uniformLocation("pointLightData"), textureUnit);
+}
+
+// ----------------------------------------------------------------------------
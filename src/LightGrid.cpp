@@ -0,0 +1,314 @@
+#include "LightGrid.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <limits>
+#include <thread>
+
+#include "GLState.h"
+#include "LightData.h"
+#include "Shader.h"
+
+// ----------------------------------------------------------------------------
+
+// Lights binned by one job, fewer lights are binned on the calling thread
+static const GLuint LIGHTS_PER_JOB = 64;
+
+// ----------------------------------------------------------------------------
+
+LightGrid::LightGrid()
+	: m_screenWidth(0), m_screenHeight(0),
+	m_clusterBuffer(0), m_clusterTexture(0), m_indexBuffer(0), m_indexTexture(0),
+	m_binnedView(1.0f), m_binnedProjection(1.0f), m_listsValid(false),
+	m_enabled(true)
+{
+}
+
+// ----------------------------------------------------------------------------
+
+LightGrid::~LightGrid()
+{
+	glDeleteTextures(1, &m_clusterTexture);
+	glDeleteTextures(1, &m_indexTexture);
+	glDeleteBuffers(1, &m_clusterBuffer);
+	glDeleteBuffers(1, &m_indexBuffer);
+}
+
+// ----------------------------------------------------------------------------
+
+bool LightGrid::initialize(GLsizei screenWidth, GLsizei screenHeight)
+{
+	m_screenWidth = screenWidth;
+	m_screenHeight = screenHeight;
+
+	glGenBuffers(1, &m_clusterBuffer);
+	glGenBuffers(1, &m_indexBuffer);
+	glGenTextures(1, &m_clusterTexture);
+	glGenTextures(1, &m_indexTexture);
+
+	// Texture views of the list buffers, the storage is replaced on every update
+	const GLuint emptyList[2] = { 0, 0 };
+	glBindBuffer(GL_TEXTURE_BUFFER, m_clusterBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(emptyList), emptyList, GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, m_indexBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(emptyList), emptyList, GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	GLState::Instance().bindTexture(GL_TEXTURE_BUFFER, m_clusterTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, m_clusterBuffer);
+	GLState::Instance().bindTexture(GL_TEXTURE_BUFFER, m_indexTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, m_indexBuffer);
+
+	return glGetError() == GL_NO_ERROR;
+}
+
+// ----------------------------------------------------------------------------
+
+GLuint LightGrid::depthSlice(float depth, float nearPlane, float farPlane)
+{
+	if (depth <= nearPlane)
+		return 0;
+
+	// Clamped before the cast, a far away or unbounded depth doesn't fit in an integer
+	float slice = std::log(depth / nearPlane) * static_cast<float>(DEPTH_SLICES) / std::log(farPlane / nearPlane);
+	slice = std::min(static_cast<float>(DEPTH_SLICES - 1), std::max(0.0f, slice));
+	return static_cast<GLuint>(slice);
+}
+
+// ----------------------------------------------------------------------------
+
+bool LightGrid::clusterBounds(const glm::vec3& viewPosition, float radius, const glm::mat4& projection, LightClusterBounds& outBounds) const
+{
+	const GLuint tileCountX = (m_screenWidth + TILE_SIZE - 1) / TILE_SIZE;
+	const GLuint tileCountY = (m_screenHeight + TILE_SIZE - 1) / TILE_SIZE;
+
+	// Near and far planes of the perspective projection
+	const float nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+	const float farPlane = projection[3][2] / (projection[2][2] + 1.0f);
+
+	// The camera looks down -z
+	const float depth = -viewPosition.z;
+	if (depth + radius < nearPlane || depth - radius > farPlane)
+		return false;
+
+	outBounds.minZ = depthSlice(depth - radius, nearPlane, farPlane);
+	outBounds.maxZ = depthSlice(depth + radius, nearPlane, farPlane);
+
+	// Crossing the near plane, the projection is unbounded
+	if (depth - radius < nearPlane)
+	{
+		outBounds.minX = 0;
+		outBounds.minY = 0;
+		outBounds.maxX = tileCountX - 1;
+		outBounds.maxY = tileCountY - 1;
+		return true;
+	}
+
+	// Screen bounds of the box around the sphere
+	glm::vec2 ndcMin(std::numeric_limits<float>::max());
+	glm::vec2 ndcMax(-std::numeric_limits<float>::max());
+	for (int corner = 0; corner < 8; ++corner)
+	{
+		glm::vec3 offset((corner & 1) ? radius : -radius, (corner & 2) ? radius : -radius, (corner & 4) ? radius : -radius);
+		glm::vec4 clip = projection * glm::vec4(viewPosition + offset, 1.0f);
+		glm::vec2 ndc = glm::vec2(clip) / clip.w;
+		ndcMin = glm::min(ndcMin, ndc);
+		ndcMax = glm::max(ndcMax, ndc);
+	}
+
+	if (ndcMax.x < -1.0f || ndcMax.y < -1.0f || ndcMin.x > 1.0f || ndcMin.y > 1.0f)
+		return false;
+
+	// NDC to tiles, clamped to the screen
+	glm::vec2 tileScale = glm::vec2(static_cast<float>(m_screenWidth), static_cast<float>(m_screenHeight)) * 0.5f / static_cast<float>(TILE_SIZE);
+	glm::vec2 tileMin = glm::clamp((ndcMin + 1.0f) * tileScale, glm::vec2(0.0f), glm::vec2(tileCountX - 1, tileCountY - 1));
+	glm::vec2 tileMax = glm::clamp((ndcMax + 1.0f) * tileScale, glm::vec2(0.0f), glm::vec2(tileCountX - 1, tileCountY - 1));
+
+	outBounds.minX = static_cast<GLuint>(tileMin.x);
+	outBounds.minY = static_cast<GLuint>(tileMin.y);
+	outBounds.maxX = static_cast<GLuint>(tileMax.x);
+	outBounds.maxY = static_cast<GLuint>(tileMax.y);
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+
+void LightGrid::binLights(const std::vector<LightClusterBounds>& boundsList, GLuint clusterCountX, GLuint clusterCountY,
+	GLuint clusterCountZ, GLuint jobCount, ClusterLightLists& outLists)
+{
+	outLists.clusterCountX = clusterCountX;
+	outLists.clusterCountY = clusterCountY;
+	outLists.clusterCountZ = clusterCountZ;
+	outLists.clusterList.assign(clusterCountX * clusterCountY * clusterCountZ * 2, 0);
+	outLists.indexList.clear();
+
+	// A row is the clusters of one tile row in one depth slice
+	const GLuint rowCount = clusterCountY * clusterCountZ;
+	if (rowCount == 0)
+		return;
+
+	// Every job owns a band of rows, so no two jobs write the same cluster
+	jobCount = std::max(1u, std::min(jobCount, rowCount));
+	const GLuint rowsPerJob = (rowCount + jobCount - 1) / jobCount;
+	std::vector<std::vector<GLuint> > bandIndexLists(jobCount);
+	std::vector<GLuint>& clusterList = outLists.clusterList;
+
+	// Call visit with the index of every cluster of the bounds in the band
+	auto forEachCluster = [&](const LightClusterBounds& bounds, GLuint firstRow, GLuint endRow, auto visit)
+	{
+		for (GLuint z = bounds.minZ; z <= bounds.maxZ; ++z)
+		{
+			GLuint rowBegin = std::max(z * clusterCountY + bounds.minY, firstRow);
+			GLuint rowEnd = std::min(z * clusterCountY + bounds.maxY + 1, endRow);
+			for (GLuint row = rowBegin; row < rowEnd; ++row)
+			{
+				for (GLuint x = bounds.minX; x <= bounds.maxX; ++x)
+					visit(row * clusterCountX + x);
+			}
+		}
+	};
+
+	auto binBand = [&](GLuint job)
+	{
+		const GLuint firstRow = job * rowsPerJob;
+		const GLuint endRow = std::min(rowCount, firstRow + rowsPerJob);
+		if (firstRow >= endRow)
+			return;
+
+		// Count the lights of every cluster
+		for (const LightClusterBounds& bounds : boundsList)
+			forEachCluster(bounds, firstRow, endRow, [&](GLuint cluster) { clusterList[cluster * 2 + 1]++; });
+
+		// Offsets in the band, the counts are rebuilt while filling
+		GLuint offset = 0;
+		for (GLuint cluster = firstRow * clusterCountX; cluster < endRow * clusterCountX; ++cluster)
+		{
+			clusterList[cluster * 2] = offset;
+			offset += clusterList[cluster * 2 + 1];
+			clusterList[cluster * 2 + 1] = 0;
+		}
+
+		std::vector<GLuint>& indexList = bandIndexLists[job];
+		indexList.resize(offset);
+		for (const LightClusterBounds& bounds : boundsList)
+		{
+			forEachCluster(bounds, firstRow, endRow, [&](GLuint cluster)
+			{
+				indexList[clusterList[cluster * 2] + clusterList[cluster * 2 + 1]++] = bounds.lightIndex;
+			});
+		}
+	};
+
+	// The calling thread takes the first band
+	std::vector<std::future<void> > jobList;
+	for (GLuint job = 1; job < jobCount; ++job)
+		jobList.push_back(std::async(std::launch::async, binBand, job));
+	binBand(0);
+	for (auto& job : jobList)
+		job.wait();
+
+	// Concatenate the bands, moving their offsets into the single list
+	size_t indexCount = 0;
+	for (const auto& bandIndexList : bandIndexLists)
+		indexCount += bandIndexList.size();
+	outLists.indexList.reserve(indexCount);
+
+	for (GLuint job = 0; job < jobCount; ++job)
+	{
+		const GLuint bandOffset = static_cast<GLuint>(outLists.indexList.size());
+		const GLuint firstRow = job * rowsPerJob;
+		const GLuint endRow = std::min(rowCount, firstRow + rowsPerJob);
+		for (GLuint cluster = firstRow * clusterCountX; cluster < endRow * clusterCountX; ++cluster)
+			clusterList[cluster * 2] += bandOffset;
+
+		outLists.indexList.insert(outLists.indexList.end(), bandIndexLists[job].begin(), bandIndexLists[job].end());
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+void LightGrid::update(const glm::mat4& view, const glm::mat4& projection)
+{
+	if (m_enabled == false)
+	{
+		m_listsValid = false;
+		return;
+	}
+
+	// The lists only change with the camera and the point light buffer
+	const LightData& lightData = LightData::getInstance();
+	if (m_listsValid && lightData.pointLightsChanged() == false && view == m_binnedView && projection == m_binnedProjection)
+		return;
+	m_binnedView = view;
+	m_binnedProjection = projection;
+	m_listsValid = true;
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	// Cluster bounds of the lights, the index is the position in the point light buffer.
+	// Only the visible lights are in the buffer, lights without PBR color have no range.
+	const glm::vec4* positionList = lightData.pointLightPositions();
+	const size_t lightCount = lightData.visiblePointLightCount();
+	m_boundsList.clear();
+	for (size_t index = 0; index < lightCount; ++index)
+	{
+		const float range = positionList[index].w;
+		if (range <= 0.0f)
+			continue;
+
+		LightClusterBounds bounds;
+		bounds.lightIndex = static_cast<GLuint>(index);
+		glm::vec3 viewPosition = glm::vec3(view * glm::vec4(glm::vec3(positionList[index]), 1.0f));
+		if (clusterBounds(viewPosition, range, projection, bounds))
+			m_boundsList.push_back(bounds);
+	}
+
+	// Threads only pay off with many lights
+	GLuint threadCount = std::max(1u, std::thread::hardware_concurrency());
+	GLuint jobCount = std::min(threadCount, 1 + static_cast<GLuint>(m_boundsList.size()) / LIGHTS_PER_JOB);
+
+	const GLuint clusterCountX = (m_screenWidth + TILE_SIZE - 1) / TILE_SIZE;
+	const GLuint clusterCountY = (m_screenHeight + TILE_SIZE - 1) / TILE_SIZE;
+	binLights(m_boundsList, clusterCountX, clusterCountY, DEPTH_SLICES, jobCount, m_lists);
+
+	// An empty buffer can't back a texture, keep one element
+	if (m_lists.indexList.empty())
+		m_lists.indexList.push_back(0);
+
+	// Orphan and refill
+	glBindBuffer(GL_TEXTURE_BUFFER, m_clusterBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, m_lists.clusterList.size() * sizeof(GLuint), m_lists.clusterList.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, m_indexBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, m_lists.indexList.size() * sizeof(GLuint), m_lists.indexList.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	m_stats.clusterCount = clusterCountX * clusterCountY * DEPTH_SLICES;
+	m_stats.binnedLightCount = static_cast<GLuint>(m_boundsList.size());
+	m_stats.indexCount = 0;
+	m_stats.maxClusterLightCount = 0;
+	for (GLuint cluster = 0; cluster < m_stats.clusterCount; ++cluster)
+	{
+		m_stats.indexCount += m_lists.clusterList[cluster * 2 + 1];
+		m_stats.maxClusterLightCount = std::max(m_stats.maxClusterLightCount, m_lists.clusterList[cluster * 2 + 1]);
+	}
+	m_stats.binTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+// ----------------------------------------------------------------------------
+
+void LightGrid::bind(const Shader& shader, GLuint firstTextureUnit) const
+{
+	GLState& state = GLState::Instance();
+
+	state.bindTexture(firstTextureUnit, GL_TEXTURE_BUFFER, m_clusterTexture);
+	glUniform1i(shader.uniformLocation("clusterLightGrid"), firstTextureUnit);
+
+	state.bindTexture(firstTextureUnit + 1, GL_TEXTURE_BUFFER, m_indexTexture);
+	glUniform1i(shader.uniformLocation("clusterLightIndices"), firstTextureUnit + 1);
+
+	glUniform3i(shader.uniformLocation("clusterCount"), m_lists.clusterCountX, m_lists.clusterCountY, m_lists.clusterCountZ);
+}
+
+// ----------------------------------------------------------------------------
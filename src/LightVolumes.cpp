@@ -0,0 +1,356 @@
+#include "LightVolumes.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Frustum.h"
+#include "GLState.h"
+#include "LightData.h"
+#include "ShaderWatcher.h"
+#include "Texture2D.h"
+
+// ----------------------------------------------------------------------------
+
+// Proxy tessellation, the volumes only have to be conservative
+static const GLuint SPHERE_RINGS = 8;
+static const GLuint SPHERE_SEGMENTS = 12;
+static const GLuint CONE_SEGMENTS = 12;
+
+// Spot lights wider than this are bounded by a sphere, the cone base would grow too large
+static const float MIN_CONE_COSCUTOFF = 0.2f;
+
+// Past the G-buffer textures, as in the deferred lighting pass
+static const GLuint POINT_LIGHT_TEXTURE_UNIT = static_cast<GLuint>(TextureType::Count);
+
+// ----------------------------------------------------------------------------
+
+LightVolumes::LightVolumes()
+	: m_enabled(false)
+{
+}
+
+// ----------------------------------------------------------------------------
+
+LightVolumes::~LightVolumes()
+{
+	deleteMesh(m_sphere);
+	deleteMesh(m_cone);
+}
+
+// ----------------------------------------------------------------------------
+
+bool LightVolumes::initialize(GLsizei width, GLsizei height, const ShaderDefines& gbufferDefines)
+{
+	// Light accumulation target, with its own copy of the G-buffer depth for the stencil tests
+	m_accumulationFramebuffer.initialize(width, height)
+		.addColorTarget("Light", GL_RGBA16F, GL_RGBA, GL_FLOAT)
+		.addDepthTarget(GL_DEPTH24_STENCIL8, 0, 0, false);
+	if (m_accumulationFramebuffer.create() == false)
+	{
+		std::cout << "Failed to initialize the light accumulation framebuffer.\n";
+		return false;
+	}
+
+	ShaderDefines pointLightDefines = gbufferDefines;
+	pointLightDefines["POINT_LIGHT"] = "1";
+	ShaderDefines spotLightDefines = gbufferDefines;
+	spotLightDefines["SPOT_LIGHT"] = "1";
+	m_pointLightShader.setDefines(pointLightDefines);
+	m_spotLightShader.setDefines(spotLightDefines);
+
+	m_stencilShader.addShader(Shader::ShaderType::VERTEX, "../Shaders/lightVolume.vert");
+	m_stencilShader.addShader(Shader::ShaderType::FRAGMENT, "../Shaders/lightVolumeStencil.frag");
+	m_pointLightShader.addShader(Shader::ShaderType::VERTEX, "../Shaders/lightVolume.vert");
+	m_pointLightShader.addShader(Shader::ShaderType::FRAGMENT, "../Shaders/deferredLightVolume.frag");
+	m_spotLightShader.addShader(Shader::ShaderType::VERTEX, "../Shaders/lightVolume.vert");
+	m_spotLightShader.addShader(Shader::ShaderType::FRAGMENT, "../Shaders/deferredLightVolume.frag");
+
+	std::vector<Shader*> shaderList = { &m_stencilShader, &m_pointLightShader, &m_spotLightShader };
+	for (Shader* shader : shaderList)
+	{
+		if (shader->submit() == false)
+			return false;
+	}
+	if (Shader::finishAll(shaderList) == false)
+		return false;
+	ShaderWatcher::Instance().watch(shaderList);
+
+	createSphere(SPHERE_RINGS, SPHERE_SEGMENTS, m_sphere);
+	createCone(CONE_SEGMENTS, m_cone);
+
+	return glGetError() == GL_NO_ERROR;
+}
+
+// ----------------------------------------------------------------------------
+
+void LightVolumes::createSphere(GLuint ringCount, GLuint segmentCount, ProxyMesh& outMesh)
+{
+	// The faces are at least cos(half the angular step) away from the center in both directions
+	const float pi = glm::pi<float>();
+	const float scale = 1.0f / (std::cos(pi / (2.0f * ringCount)) * std::cos(pi / segmentCount));
+
+	// Poles and the rings in between, from +y down
+	std::vector<glm::vec3> vertexList;
+	vertexList.push_back(glm::vec3(0.0f, scale, 0.0f));
+	for (GLuint ring = 1; ring < ringCount; ++ring)
+	{
+		float theta = pi * ring / ringCount;
+		for (GLuint segment = 0; segment < segmentCount; ++segment)
+		{
+			float phi = 2.0f * pi * segment / segmentCount;
+			vertexList.push_back(glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)) * scale);
+		}
+	}
+	vertexList.push_back(glm::vec3(0.0f, -scale, 0.0f));
+
+	const GLushort bottomPole = static_cast<GLushort>(vertexList.size() - 1);
+	auto ringVertex = [segmentCount](GLuint ring, GLuint segment)
+	{
+		return static_cast<GLushort>(1 + (ring - 1) * segmentCount + segment % segmentCount);
+	};
+
+	// Counter clockwise seen from the outside
+	std::vector<GLushort> indexList;
+	for (GLuint segment = 0; segment < segmentCount; ++segment)
+	{
+		indexList.insert(indexList.end(), { 0, ringVertex(1, segment + 1), ringVertex(1, segment) });
+
+		for (GLuint ring = 1; ring < ringCount - 1; ++ring)
+		{
+			indexList.insert(indexList.end(), { ringVertex(ring, segment), ringVertex(ring, segment + 1), ringVertex(ring + 1, segment + 1) });
+			indexList.insert(indexList.end(), { ringVertex(ring, segment), ringVertex(ring + 1, segment + 1), ringVertex(ring + 1, segment) });
+		}
+
+		indexList.insert(indexList.end(), { ringVertex(ringCount - 1, segment), ringVertex(ringCount - 1, segment + 1), bottomPole });
+	}
+
+	uploadMesh(vertexList, indexList, outMesh);
+}
+
+// ----------------------------------------------------------------------------
+
+void LightVolumes::createCone(GLuint segmentCount, ProxyMesh& outMesh)
+{
+	const float pi = glm::pi<float>();
+	const float scale = 1.0f / std::cos(pi / segmentCount);
+
+	// Apex, base center and the base circle
+	std::vector<glm::vec3> vertexList;
+	vertexList.push_back(glm::vec3(0.0f));
+	vertexList.push_back(glm::vec3(0.0f, 0.0f, 1.0f));
+	for (GLuint segment = 0; segment < segmentCount; ++segment)
+	{
+		float phi = 2.0f * pi * segment / segmentCount;
+		vertexList.push_back(glm::vec3(std::cos(phi) * scale, std::sin(phi) * scale, 1.0f));
+	}
+
+	auto baseVertex = [segmentCount](GLuint segment)
+	{
+		return static_cast<GLushort>(2 + segment % segmentCount);
+	};
+
+	// Counter clockwise seen from the outside
+	std::vector<GLushort> indexList;
+	for (GLuint segment = 0; segment < segmentCount; ++segment)
+	{
+		indexList.insert(indexList.end(), { 0, baseVertex(segment + 1), baseVertex(segment) });
+		indexList.insert(indexList.end(), { 1, baseVertex(segment), baseVertex(segment + 1) });
+	}
+
+	uploadMesh(vertexList, indexList, outMesh);
+}
+
+// ----------------------------------------------------------------------------
+
+void LightVolumes::uploadMesh(const std::vector<glm::vec3>& vertexList, const std::vector<GLushort>& indexList, ProxyMesh& outMesh)
+{
+	glGenVertexArrays(1, &outMesh.vertexArray);
+	GLState::Instance().bindVertexArray(outMesh.vertexArray);
+
+	glGenBuffers(1, &outMesh.vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, outMesh.vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertexList.size() * sizeof(glm::vec3), vertexList.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), nullptr);
+
+	glGenBuffers(1, &outMesh.indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, outMesh.indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexList.size() * sizeof(GLushort), indexList.data(), GL_STATIC_DRAW);
+	outMesh.indexCount = static_cast<GLsizei>(indexList.size());
+
+	GLState::Instance().bindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// ----------------------------------------------------------------------------
+
+void LightVolumes::deleteMesh(ProxyMesh& mesh)
+{
+	glDeleteVertexArrays(1, &mesh.vertexArray);
+	glDeleteBuffers(1, &mesh.vertexBuffer);
+	glDeleteBuffers(1, &mesh.indexBuffer);
+	mesh = ProxyMesh();
+}
+
+// ----------------------------------------------------------------------------
+
+void LightVolumes::bindInputs(Shader& lightShader, const Framebuffer& gbuffer) const
+{
+	lightShader.useShader();
+
+	GLuint textureUnit = 0;
+	if (gbuffer.colorTexture("Position") < 0)
+		Texture2D::bind(lightShader.uniformLocation("gDepth"), gbuffer.depthTexture(), textureUnit++);
+	else
+		Texture2D::bind(lightShader.uniformLocation("gPosition"), gbuffer.colorTexture("Position"), textureUnit++);
+	Texture2D::bind(lightShader.uniformLocation("gNormal"), gbuffer.colorTexture("Normal"), textureUnit++);
+	Texture2D::bind(lightShader.uniformLocation("gAlbedo"), gbuffer.colorTexture("Albedo"), textureUnit++);
+	Texture2D::bind(lightShader.uniformLocation("gPBR"), gbuffer.colorTexture("PBR"), textureUnit++);
+
+	LightData::getInstance().bindPointLights(lightShader, POINT_LIGHT_TEXTURE_UNIT);
+}
+
+// ----------------------------------------------------------------------------
+
+void LightVolumes::drawVolume(const ProxyMesh& mesh, const glm::mat4& model, Shader& lightShader, GLint lightIndex)
+{
+	GLState& state = GLState::Instance();
+	state.bindVertexArray(mesh.vertexArray);
+
+	// Stencil pass. A pixel is inside the volume if its depth is behind the front faces and in
+	// front of the back faces, the increment and decrement cancel out everywhere else.
+	m_stencilShader.useShader();
+	glUniformMatrix4fv(m_stencilShader.uniformLocation("volumeModel"), 1, GL_FALSE, &model[0][0]);
+
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	state.enable(GL_DEPTH_TEST);
+	state.disable(GL_CULL_FACE);
+	state.disable(GL_BLEND);
+	glStencilFunc(GL_ALWAYS, 0, 0);
+	glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+	glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+	glDrawElements(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_SHORT, nullptr);
+
+	// Light pass through the back faces, so the volume still covers the pixels with the camera
+	// inside it. Shaded pixels reset their stencil value for the next light.
+	lightShader.useShader();
+	glUniformMatrix4fv(lightShader.uniformLocation("volumeModel"), 1, GL_FALSE, &model[0][0]);
+	glUniform1i(lightShader.uniformLocation("lightIndex"), lightIndex);
+
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	state.disable(GL_DEPTH_TEST);
+	state.enable(GL_CULL_FACE);
+	glCullFace(GL_FRONT);
+	state.enable(GL_BLEND);
+	glStencilFunc(GL_NOTEQUAL, 0, 0xFF);
+	glStencilOp(GL_KEEP, GL_ZERO, GL_ZERO);
+	glDrawElements(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_SHORT, nullptr);
+}
+
+// ----------------------------------------------------------------------------
+
+void LightVolumes::render(const Framebuffer& gbuffer, const glm::mat4& view, const glm::mat4& projection)
+{
+	m_stats = LightVolumeStats();
+	if (m_enabled == false)
+		return;
+
+	GLState& state = GLState::Instance();
+
+	// Scene depth, no light and a cleared stencil
+	state.bindFramebuffer(GL_READ_FRAMEBUFFER, gbuffer.handle());
+	state.bindFramebuffer(GL_DRAW_FRAMEBUFFER, m_accumulationFramebuffer.handle());
+	glBlitFramebuffer(0, 0, gbuffer.width(), gbuffer.height(),
+		0, 0, m_accumulationFramebuffer.width(), m_accumulationFramebuffer.height(),
+		GL_DEPTH_BUFFER_BIT,
+		GL_NEAREST);
+
+	m_accumulationFramebuffer.renderToTexture(Framebuffer::RenderTargetType::COLOR_TARGET, false);
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glStencilMask(0xFF);
+	glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+	bindInputs(m_pointLightShader, gbuffer);
+	bindInputs(m_spotLightShader, gbuffer);
+
+	// Depth is only tested. Clamping keeps the volumes crossing the near or far plane closed.
+	state.depthFunc(GL_LESS);
+	state.depthMask(GL_FALSE);
+	state.enable(GL_STENCIL_TEST);
+	state.enable(GL_DEPTH_CLAMP);
+	glBlendFunc(GL_ONE, GL_ONE);
+
+	const Frustum frustum(projection * view);
+	const LightData& lightData = LightData::getInstance();
+
+	// Point lights, the buffer only holds the enabled ones in the frustum
+	const glm::vec4* positionList = lightData.pointLightPositions();
+	for (size_t index = 0; index < lightData.visiblePointLightCount(); ++index)
+	{
+		const glm::vec3 position = glm::vec3(positionList[index]);
+		const float range = positionList[index].w;
+		if (range <= 0.0f || frustum.intersectsSphere(position, range) == false)
+			continue;
+
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+		model = glm::scale(model, glm::vec3(range));
+		drawVolume(m_sphere, model, m_pointLightShader, static_cast<GLint>(index));
+		m_stats.pointLightCount++;
+	}
+
+	// Spot lights
+	const LightData::SpotLightArrays& spotLights = lightData.spotLights();
+	for (size_t index = 0; index < spotLights.count(); ++index)
+	{
+		const glm::vec3& position = spotLights.position[index];
+		const glm::vec3& direction = spotLights.direction[index];
+		if (spotLights.enabled[index] == 0 || spotLights.pbrLight[index] == 0 || glm::length(direction) == 0.0f)
+			continue;
+
+		const float range = LightData::spotLightRange(spotLights.color[index], lightData.lightCutoff());
+		if (range <= 0.0f || frustum.intersectsSphere(position, range) == false)
+			continue;
+
+		glm::mat4 model;
+		const ProxyMesh* mesh;
+		if (spotLights.coscutoff[index] >= MIN_CONE_COSCUTOFF)
+		{
+			// Cone basis with z along the light direction, x and y scaled to the cutoff
+			glm::vec3 axisZ = glm::normalize(direction);
+			glm::vec3 up = std::abs(axisZ.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+			glm::vec3 axisX = glm::normalize(glm::cross(up, axisZ));
+			glm::vec3 axisY = glm::cross(axisZ, axisX);
+
+			float cosCutoff = std::min(spotLights.coscutoff[index], 1.0f);
+			float baseRadius = range * std::sqrt(1.0f - cosCutoff * cosCutoff) / cosCutoff;
+
+			model = glm::mat4(glm::vec4(axisX * baseRadius, 0.0f), glm::vec4(axisY * baseRadius, 0.0f),
+				glm::vec4(axisZ * range, 0.0f), glm::vec4(position, 1.0f));
+			mesh = &m_cone;
+		}
+		else
+		{
+			model = glm::translate(glm::mat4(1.0f), position);
+			model = glm::scale(model, glm::vec3(range));
+			mesh = &m_sphere;
+		}
+
+		drawVolume(*mesh, model, m_spotLightShader, static_cast<GLint>(index));
+		m_stats.spotLightCount++;
+	}
+
+	// Back to the defaults of the other passes
+	glCullFace(GL_BACK);
+	state.disable(GL_CULL_FACE);
+	state.disable(GL_BLEND);
+	state.disable(GL_STENCIL_TEST);
+	state.disable(GL_DEPTH_CLAMP);
+	state.enable(GL_DEPTH_TEST);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+// ----------------------------------------------------------------------------
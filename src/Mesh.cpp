@@ -14,7 +14,7 @@ void Mesh<VertexP>::setupVertexInput()
 	glGenBuffers(1, &vertexBuffer);
 	glGenBuffers(1, &indexBuffer);
 
-	glBindVertexArray(m_vertexArrayObject);
+	GLState::Instance().bindVertexArray(m_vertexArrayObject);
 
 	// Vertex buffer
 	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
@@ -30,7 +30,7 @@ void Mesh<VertexP>::setupVertexInput()
 																								   
 	// -----------------------------------------------------------------------------------------------
  
-	glBindVertexArray(0);
+	GLState::Instance().bindVertexArray(0);
 }
 
 // ----------------------------------------------------------------------------
@@ -45,7 +45,7 @@ void Mesh<VertexPN>::setupVertexInput()
 	glGenBuffers(1, &vertexBuffer);
 	glGenBuffers(1, &indexBuffer);
 
-	glBindVertexArray(m_vertexArrayObject);
+	GLState::Instance().bindVertexArray(m_vertexArrayObject);
 
 	// Vertex buffer
 	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
@@ -63,7 +63,7 @@ void Mesh<VertexPN>::setupVertexInput()
 	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(VertexPN), (GLvoid*)(sizeof(float) * 3)); // Normal
 
 	// -----------------------------------------------------------------------------------------------
-	glBindVertexArray(0);
+	GLState::Instance().bindVertexArray(0);
 }
 
 // ----------------------------------------------------------------------------
@@ -78,7 +78,7 @@ void Mesh<VertexPC>::setupVertexInput()
 	glGenBuffers(1, &vertexBuffer);
 	glGenBuffers(1, &indexBuffer);
 
-	glBindVertexArray(m_vertexArrayObject);
+	GLState::Instance().bindVertexArray(m_vertexArrayObject);
 
 	// Vertex buffer
 	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
@@ -96,7 +96,7 @@ void Mesh<VertexPC>::setupVertexInput()
 	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(VertexPC), (GLvoid*)(sizeof(float) * 3)); // Color
 
 	// -----------------------------------------------------------------------------------------------
-	glBindVertexArray(0);
+	GLState::Instance().bindVertexArray(0);
 }
 
 // ----------------------------------------------------------------------------
@@ -111,7 +111,7 @@ void Mesh<VertexPTNT>::setupVertexInput()
 	glGenBuffers(1, &vertexBuffer);
 	glGenBuffers(1, &indexBuffer);
 
-	glBindVertexArray(m_vertexArrayObject);
+	GLState::Instance().bindVertexArray(m_vertexArrayObject);
 
 	// Vertex buffer
 	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
@@ -138,7 +138,7 @@ void Mesh<VertexPTNT>::setupVertexInput()
 	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(VertexPTNT), (GLvoid*)(sizeof(float) * 11)); // Bitangent
 
 	// -----------------------------------------------------------------------------------------------
-	glBindVertexArray(0);
+	GLState::Instance().bindVertexArray(0);
 }
 
 // ----------------------------------------------------------------------------
@@ -153,7 +153,7 @@ void Mesh<VertexPNTT>::setupVertexInput()
 	glGenBuffers(1, &vertexBuffer);
 	glGenBuffers(1, &indexBuffer);
 
-	glBindVertexArray(m_vertexArrayObject);
+	GLState::Instance().bindVertexArray(m_vertexArrayObject);
 
 	// Vertex buffer
 	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
@@ -177,7 +177,7 @@ void Mesh<VertexPNTT>::setupVertexInput()
 	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(VertexPNTT), (GLvoid*)(sizeof(float) * 8)); // Tangent
 	
 	// -----------------------------------------------------------------------------------------------
-	glBindVertexArray(0);
+	GLState::Instance().bindVertexArray(0);
 }
 
 
@@ -193,7 +193,7 @@ void Mesh<VertexPTT>::setupVertexInput()
 	glGenBuffers(1, &vertexBuffer);
 	glGenBuffers(1, &indexBuffer);
 
-	glBindVertexArray(m_vertexArrayObject);
+	GLState::Instance().bindVertexArray(m_vertexArrayObject);
 
 	// Vertex buffer
 	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
@@ -214,7 +214,7 @@ void Mesh<VertexPTT>::setupVertexInput()
 	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(VertexPTT), (GLvoid*)(sizeof(float) * 5)); // Tangent
 
 	// -----------------------------------------------------------------------------------------------
-	glBindVertexArray(0);
+	GLState::Instance().bindVertexArray(0);
 }
 
 // ----------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include "MeshCluster.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+
+// ----------------------------------------------------------------------------
+
+std::vector<MeshCluster> MeshClusterBuilder::build(const std::vector<GLushort>& indexList,
+	const std::vector<glm::vec3>& positions,
+	unsigned int maxVertices,
+	unsigned int maxTriangles)
+{
+	std::vector<MeshCluster> clusters;
+
+	size_t triangleCount = indexList.size() / 3;
+	if (triangleCount == 0)
+		return clusters;
+
+	// Cluster id + 1 of the last cluster that referenced the vertex
+	std::vector<GLuint> vertexCluster(positions.size(), 0);
+	GLuint clusterId = 1;
+
+	MeshCluster cluster;
+	unsigned int clusterVertexCount = 0;
+
+	for (size_t triangleIndex = 0; triangleIndex < triangleCount; ++triangleIndex)
+	{
+		const GLushort* triangle = &indexList[triangleIndex * 3];
+
+		unsigned int newVertexCount = 0;
+		for (unsigned int corner = 0; corner < 3; ++corner)
+		{
+			if (vertexCluster[triangle[corner]] != clusterId)
+				newVertexCount++;
+		}
+
+		// Close the current cluster if the triangle doesn't fit
+		if (cluster.indexCount > 0 &&
+			(clusterVertexCount + newVertexCount > maxVertices || cluster.indexCount / 3 >= maxTriangles))
+		{
+			computeBounds(cluster, indexList, positions);
+			clusters.push_back(cluster);
+
+			cluster = MeshCluster();
+			cluster.indexOffset = static_cast<GLuint>(triangleIndex * 3);
+			clusterVertexCount = 0;
+			clusterId++;
+		}
+
+		for (unsigned int corner = 0; corner < 3; ++corner)
+		{
+			if (vertexCluster[triangle[corner]] != clusterId)
+			{
+				vertexCluster[triangle[corner]] = clusterId;
+				clusterVertexCount++;
+			}
+		}
+		cluster.indexCount += 3;
+	}
+
+	computeBounds(cluster, indexList, positions);
+	clusters.push_back(cluster);
+
+	return clusters;
+}
+
+// ----------------------------------------------------------------------------
+
+void MeshClusterBuilder::computeBounds(MeshCluster& cluster, const std::vector<GLushort>& indexList, const std::vector<glm::vec3>& positions)
+{
+	GLuint indexEnd = cluster.indexOffset + cluster.indexCount;
+
+	// Bounding sphere around the box center
+	glm::vec3 minBound = positions[indexList[cluster.indexOffset]];
+	glm::vec3 maxBound = minBound;
+	for (GLuint index = cluster.indexOffset; index < indexEnd; ++index)
+	{
+		minBound = glm::min(minBound, positions[indexList[index]]);
+		maxBound = glm::max(maxBound, positions[indexList[index]]);
+	}
+
+	cluster.center = (minBound + maxBound) * 0.5f;
+	cluster.radius = 0.0f;
+	for (GLuint index = cluster.indexOffset; index < indexEnd; ++index)
+		cluster.radius = std::max(cluster.radius, glm::length(positions[indexList[index]] - cluster.center));
+
+	// Normal cone around the average face normal
+	std::vector<glm::vec3> faceNormals;
+	faceNormals.reserve(cluster.indexCount / 3);
+
+	glm::vec3 averageNormal(0.0f);
+	for (GLuint index = cluster.indexOffset; index < indexEnd; index += 3)
+	{
+		const glm::vec3& p0 = positions[indexList[index + 0]];
+		const glm::vec3& p1 = positions[indexList[index + 1]];
+		const glm::vec3& p2 = positions[indexList[index + 2]];
+
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float area = glm::length(normal);
+
+		// Degenerate triangles don't affect visibility
+		if (area == 0.0f)
+			continue;
+
+		normal /= area;
+		faceNormals.push_back(normal);
+		averageNormal += normal;
+	}
+
+	cluster.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+	cluster.coneCutoff = 1.0f;
+
+	float averageLength = glm::length(averageNormal);
+	if (averageLength == 0.0f)
+		return;
+
+	cluster.coneAxis = averageNormal / averageLength;
+
+	float minDot = 1.0f;
+	for (const glm::vec3& normal : faceNormals)
+		minDot = std::min(minDot, glm::dot(normal, cluster.coneAxis));
+
+	// Cone wider than a half space can never be back facing
+	if (minDot <= 0.0f)
+		return;
+
+	// sin of the cone half angle
+	cluster.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+// ----------------------------------------------------------------------------
+
+ClusterCuller::ClusterCuller()
+	: m_enabled(true),
+	m_coneCullingEnabled(false)
+{
+}
+
+// ----------------------------------------------------------------------------
+
+ClusterCuller::~ClusterCuller()
+{
+}
+
+// ----------------------------------------------------------------------------
+
+void ClusterCuller::cull(const std::vector<MeshCluster>& clusters,
+	const Frustum& frustum,
+	const glm::vec3& viewPos,
+	ClusterDrawList& drawList)
+{
+	drawList.clear();
+
+	// End of the last emitted range
+	GLuint rangeEnd = ~0u;
+
+	for (const MeshCluster& cluster : clusters)
+	{
+		m_stats.clusterCount++;
+		m_stats.triangleCount += cluster.indexCount / 3;
+
+		if (frustum.intersectsSphere(cluster.center, cluster.radius) == false)
+			continue;
+
+		if (m_coneCullingEnabled)
+		{
+			glm::vec3 toCluster = cluster.center - viewPos;
+			if (glm::dot(toCluster, cluster.coneAxis) >= cluster.coneCutoff * glm::length(toCluster) + cluster.radius)
+				continue;
+		}
+
+		m_stats.visibleClusterCount++;
+		m_stats.visibleTriangleCount += cluster.indexCount / 3;
+
+		// Extend the previous range if the clusters are adjacent in the index buffer
+		if (cluster.indexOffset == rangeEnd)
+		{
+			drawList.counts.back() += cluster.indexCount;
+		}
+		else
+		{
+			drawList.counts.push_back(cluster.indexCount);
+			drawList.offsets.push_back(reinterpret_cast<const void*>(cluster.indexOffset * sizeof(GLushort)));
+		}
+		rangeEnd = cluster.indexOffset + cluster.indexCount;
+	}
+
+	m_stats.drawRangeCount += static_cast<unsigned int>(drawList.counts.size());
+}
+
+// ----------------------------------------------------------------------------
@@ -0,0 +1,414 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+
+// ----------------------------------------------------------------------------
+
+namespace
+{
+	// Forsyth vertex cache optimization parameters
+	const unsigned int FORSYTH_CACHE_SIZE = 32;
+	const unsigned int FORSYTH_MAX_VALENCE = 32;
+	const float CACHE_DECAY_POWER = 1.5f;
+	const float LAST_TRIANGLE_SCORE = 0.75f;
+	const float VALENCE_BOOST_SCALE = 2.0f;
+	const float VALENCE_BOOST_POWER = 0.5f;
+
+	// ------------------------------------------------------------------------
+
+	// Precomputed vertex scores indexed by cache position and remaining valence
+	struct VertexScoreTable
+	{
+		float cacheScore[FORSYTH_CACHE_SIZE + 1];
+		float valenceScore[FORSYTH_MAX_VALENCE + 1];
+
+		VertexScoreTable()
+		{
+			for (unsigned int cachePosition = 0; cachePosition < FORSYTH_CACHE_SIZE; ++cachePosition)
+			{
+				if (cachePosition < 3)
+				{
+					// The vertices of the last triangle get a fixed score so it is not reused immediately
+					cacheScore[cachePosition] = LAST_TRIANGLE_SCORE;
+				}
+				else
+				{
+					float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+					cacheScore[cachePosition] = std::pow(1.0f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+				}
+			}
+			// Not in cache
+			cacheScore[FORSYTH_CACHE_SIZE] = 0.0f;
+
+			valenceScore[0] = 0.0f;
+			for (unsigned int valence = 1; valence <= FORSYTH_MAX_VALENCE; ++valence)
+				valenceScore[valence] = VALENCE_BOOST_SCALE * std::pow(static_cast<float>(valence), -VALENCE_BOOST_POWER);
+		}
+
+		inline float score(int cachePosition, unsigned int remainingValence) const
+		{
+			// Vertices without remaining triangles don't contribute
+			if (remainingValence == 0)
+				return -1.0f;
+
+			unsigned int cacheIndex = cachePosition < 0 ? FORSYTH_CACHE_SIZE : static_cast<unsigned int>(cachePosition);
+			return cacheScore[cacheIndex] + valenceScore[std::min(remainingValence, FORSYTH_MAX_VALENCE)];
+		}
+	};
+
+	// ------------------------------------------------------------------------
+
+	// FIFO post-transform cache simulation based on timestamps
+	class FifoCache
+	{
+	public:
+		FifoCache(size_t vertexCount, unsigned int cacheSize)
+			: m_timestamps(vertexCount, 0), m_cacheSize(cacheSize), m_timestamp(cacheSize + 1) {}
+
+		// Returns true if the vertex had to be transformed
+		inline bool access(GLushort vertex)
+		{
+			if (m_timestamp - m_timestamps[vertex] > m_cacheSize)
+			{
+				m_timestamps[vertex] = m_timestamp++;
+				return true;
+			}
+			return false;
+		}
+
+		inline unsigned int accessTriangle(const GLushort* triangle)
+		{
+			return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+		}
+
+		// Invalidate all the entries
+		inline void flush() { m_timestamp += m_cacheSize + 1; }
+
+	private:
+		std::vector<unsigned int> m_timestamps;
+		unsigned int m_cacheSize;
+		unsigned int m_timestamp;
+	};
+}
+
+// ----------------------------------------------------------------------------
+
+VertexCacheStats MeshOptimizer::analyzeVertexCache(const std::vector<GLushort>& indexList, size_t vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStats stats;
+
+	size_t triangleCount = indexList.size() / 3;
+	if (triangleCount == 0)
+		return stats;
+
+	FifoCache cache(vertexCount, cacheSize);
+	std::vector<bool> referenced(vertexCount, false);
+	size_t referencedCount = 0;
+	size_t transformedCount = 0;
+
+	for (size_t triangleIndex = 0; triangleIndex < triangleCount; ++triangleIndex)
+	{
+		const GLushort* triangle = &indexList[triangleIndex * 3];
+		transformedCount += cache.accessTriangle(triangle);
+
+		for (unsigned int corner = 0; corner < 3; ++corner)
+		{
+			if (referenced[triangle[corner]] == false)
+			{
+				referenced[triangle[corner]] = true;
+				referencedCount++;
+			}
+		}
+	}
+
+	stats.acmr = static_cast<float>(transformedCount) / triangleCount;
+	stats.atvr = static_cast<float>(transformedCount) / referencedCount;
+
+	return stats;
+}
+
+// ----------------------------------------------------------------------------
+
+void MeshOptimizer::optimizeVertexCache(std::vector<GLushort>& indexList, size_t vertexCount)
+{
+	static const VertexScoreTable scoreTable;
+
+	size_t triangleCount = indexList.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Build the vertex -> triangle adjacency (compressed rows)
+	std::vector<unsigned int> remainingValence(vertexCount, 0);
+	for (GLushort index : indexList)
+		remainingValence[index]++;
+
+	std::vector<unsigned int> adjacencyOffset(vertexCount + 1, 0);
+	for (size_t vertexIndex = 0; vertexIndex < vertexCount; ++vertexIndex)
+		adjacencyOffset[vertexIndex + 1] = adjacencyOffset[vertexIndex] + remainingValence[vertexIndex];
+
+	std::vector<unsigned int> adjacency(indexList.size());
+	std::vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+	for (size_t triangleIndex = 0; triangleIndex < triangleCount; ++triangleIndex)
+	{
+		for (unsigned int corner = 0; corner < 3; ++corner)
+			adjacency[fill[indexList[triangleIndex * 3 + corner]]++] = static_cast<unsigned int>(triangleIndex);
+	}
+
+	// Initial scores
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t vertexIndex = 0; vertexIndex < vertexCount; ++vertexIndex)
+		vertexScore[vertexIndex] = scoreTable.score(-1, remainingValence[vertexIndex]);
+
+	std::vector<float> triangleScore(triangleCount);
+	for (size_t triangleIndex = 0; triangleIndex < triangleCount; ++triangleIndex)
+	{
+		const GLushort* triangle = &indexList[triangleIndex * 3];
+		triangleScore[triangleIndex] = vertexScore[triangle[0]] + vertexScore[triangle[1]] + vertexScore[triangle[2]];
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<GLushort> outputIndexList;
+	outputIndexList.reserve(indexList.size());
+
+	// The cache holds 3 extra entries so the vertices pushed out by the last triangle can be updated
+	std::vector<GLushort> cache, newCache;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+	size_t inputCursor = 0;
+	long long bestTriangle = -1;
+
+	// Start with the highest scoring triangle
+	float bestScore = -1.0f;
+	for (size_t triangleIndex = 0; triangleIndex < triangleCount; ++triangleIndex)
+	{
+		if (triangleScore[triangleIndex] > bestScore)
+		{
+			bestScore = triangleScore[triangleIndex];
+			bestTriangle = static_cast<long long>(triangleIndex);
+		}
+	}
+
+	for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+	{
+		// Nothing useful in the cache - continue with the next triangle in input order
+		if (bestTriangle < 0)
+		{
+			while (emitted[inputCursor])
+				inputCursor++;
+			bestTriangle = static_cast<long long>(inputCursor);
+		}
+
+		const GLushort* triangle = &indexList[bestTriangle * 3];
+		outputIndexList.insert(outputIndexList.end(), triangle, triangle + 3);
+		emitted[bestTriangle] = true;
+
+		// Remove the triangle from the adjacency of its vertices
+		for (unsigned int corner = 0; corner < 3; ++corner)
+		{
+			GLushort vertex = triangle[corner];
+			unsigned int* begin = &adjacency[adjacencyOffset[vertex]];
+			unsigned int* end = begin + remainingValence[vertex];
+			unsigned int* found = std::find(begin, end, static_cast<unsigned int>(bestTriangle));
+			if (found != end)
+			{
+				std::swap(*found, *(end - 1));
+				remainingValence[vertex]--;
+			}
+		}
+
+		// Move the triangle vertices to the front of the cache
+		newCache.clear();
+		newCache.insert(newCache.end(), triangle, triangle + 3);
+		for (GLushort vertex : cache)
+		{
+			if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+				newCache.push_back(vertex);
+		}
+
+		// Update vertex scores and propagate the difference to the triangles still to be emitted
+		for (size_t position = 0; position < newCache.size(); ++position)
+		{
+			GLushort vertex = newCache[position];
+			int newPosition = position < FORSYTH_CACHE_SIZE ? static_cast<int>(position) : -1;
+			cachePosition[vertex] = newPosition;
+
+			float score = scoreTable.score(newPosition, remainingValence[vertex]);
+			float delta = score - vertexScore[vertex];
+			vertexScore[vertex] = score;
+
+			const unsigned int* begin = &adjacency[adjacencyOffset[vertex]];
+			for (unsigned int adjacent = 0; adjacent < remainingValence[vertex]; ++adjacent)
+				triangleScore[begin[adjacent]] += delta;
+		}
+
+		// Find the best triangle among the ones touching the cache
+		bestTriangle = -1;
+		bestScore = -1.0f;
+		size_t cacheEntries = std::min<size_t>(newCache.size(), FORSYTH_CACHE_SIZE);
+		for (size_t position = 0; position < cacheEntries; ++position)
+		{
+			GLushort vertex = newCache[position];
+			const unsigned int* begin = &adjacency[adjacencyOffset[vertex]];
+			for (unsigned int adjacent = 0; adjacent < remainingValence[vertex]; ++adjacent)
+			{
+				unsigned int candidate = begin[adjacent];
+				if (triangleScore[candidate] > bestScore)
+				{
+					bestScore = triangleScore[candidate];
+					bestTriangle = candidate;
+				}
+			}
+		}
+
+		// Drop the entries pushed out of the cache
+		if (newCache.size() > FORSYTH_CACHE_SIZE)
+			newCache.resize(FORSYTH_CACHE_SIZE);
+		cache.swap(newCache);
+	}
+
+	indexList.swap(outputIndexList);
+}
+
+// ----------------------------------------------------------------------------
+
+unsigned int MeshOptimizer::optimizeOverdraw(std::vector<GLushort>& indexList, const std::vector<glm::vec3>& positions, float threshold)
+{
+	size_t triangleCount = indexList.size() / 3;
+	if (triangleCount == 0)
+		return 0;
+
+	size_t vertexCount = positions.size();
+
+	// Hard boundaries - a triangle that misses on all its vertices restarts the cache anyway.
+	// The first cluster always starts at 0, a degenerate first triangle misses less than 3 times.
+	std::vector<size_t> hardClusters;
+	hardClusters.push_back(0);
+	{
+		FifoCache cache(vertexCount, VERTEX_CACHE_SIZE);
+		for (size_t triangleIndex = 0; triangleIndex < triangleCount; ++triangleIndex)
+		{
+			if (cache.accessTriangle(&indexList[triangleIndex * 3]) == 3 && triangleIndex > 0)
+				hardClusters.push_back(triangleIndex);
+		}
+	}
+	hardClusters.push_back(triangleCount);
+
+	// Soft boundaries - split a hard cluster once its running ACMR is within the threshold of the whole cluster
+	std::vector<size_t> clusters;
+	{
+		FifoCache cache(vertexCount, VERTEX_CACHE_SIZE);
+		for (size_t hardIndex = 0; hardIndex + 1 < hardClusters.size(); ++hardIndex)
+		{
+			size_t start = hardClusters[hardIndex];
+			size_t end = hardClusters[hardIndex + 1];
+
+			// ACMR of the hard cluster
+			cache.flush();
+			unsigned int clusterMisses = 0;
+			for (size_t triangleIndex = start; triangleIndex < end; ++triangleIndex)
+				clusterMisses += cache.accessTriangle(&indexList[triangleIndex * 3]);
+			float clusterThreshold = threshold * static_cast<float>(clusterMisses) / (end - start);
+
+			// Split
+			cache.flush();
+			clusters.push_back(start);
+			size_t softStart = start;
+			unsigned int runningMisses = 0;
+			for (size_t triangleIndex = start; triangleIndex < end; ++triangleIndex)
+			{
+				runningMisses += cache.accessTriangle(&indexList[triangleIndex * 3]);
+
+				if (triangleIndex + 1 < end && runningMisses <= clusterThreshold * (triangleIndex + 1 - softStart))
+				{
+					clusters.push_back(triangleIndex + 1);
+					softStart = triangleIndex + 1;
+					runningMisses = 0;
+					cache.flush();
+				}
+			}
+		}
+	}
+	clusters.push_back(triangleCount);
+
+	unsigned int clusterCount = static_cast<unsigned int>(clusters.size() - 1);
+
+	// Mesh centroid
+	glm::vec3 meshCentroid(0.0f);
+	for (GLushort index : indexList)
+		meshCentroid += positions[index];
+	meshCentroid /= static_cast<float>(indexList.size());
+
+	// Sort key - how much the cluster faces away from the mesh center
+	struct ClusterSortData
+	{
+		size_t start;
+		size_t end;
+		float key;
+	};
+	std::vector<ClusterSortData> sortData(clusterCount);
+
+	for (unsigned int clusterIndex = 0; clusterIndex < clusterCount; ++clusterIndex)
+	{
+		size_t start = clusters[clusterIndex];
+		size_t end = clusters[clusterIndex + 1];
+
+		glm::vec3 centroid(0.0f);
+		glm::vec3 normal(0.0f);
+		for (size_t triangleIndex = start; triangleIndex < end; ++triangleIndex)
+		{
+			const glm::vec3& p0 = positions[indexList[triangleIndex * 3 + 0]];
+			const glm::vec3& p1 = positions[indexList[triangleIndex * 3 + 1]];
+			const glm::vec3& p2 = positions[indexList[triangleIndex * 3 + 2]];
+
+			centroid += p0 + p1 + p2;
+			// Area weighted face normal
+			normal += glm::cross(p1 - p0, p2 - p0);
+		}
+		centroid /= static_cast<float>((end - start) * 3);
+
+		float normalLength = glm::length(normal);
+		if (normalLength > 0.0f)
+			normal /= normalLength;
+
+		sortData[clusterIndex] = { start, end, glm::dot(centroid - meshCentroid, normal) };
+	}
+
+	// Outward facing clusters first
+	std::stable_sort(sortData.begin(), sortData.end(), [](const ClusterSortData& a, const ClusterSortData& b)
+	{
+		return a.key > b.key;
+	});
+
+	std::vector<GLushort> outputIndexList;
+	outputIndexList.reserve(indexList.size());
+	for (const ClusterSortData& cluster : sortData)
+		outputIndexList.insert(outputIndexList.end(), indexList.begin() + cluster.start * 3, indexList.begin() + cluster.end * 3);
+
+	indexList.swap(outputIndexList);
+
+	return clusterCount;
+}
+
+// ----------------------------------------------------------------------------
+
+size_t MeshOptimizer::optimizeVertexFetchRemap(std::vector<GLushort>& indexList, size_t vertexCount, std::vector<GLuint>& outRemap)
+{
+	outRemap.assign(vertexCount, INVALID_INDEX);
+
+	// Number the vertices in the order they are first used
+	GLuint nextVertex = 0;
+	for (GLushort& index : indexList)
+	{
+		if (outRemap[index] == INVALID_INDEX)
+			outRemap[index] = nextVertex++;
+		index = static_cast<GLushort>(outRemap[index]);
+	}
+
+	return nextVertex;
+}
+
+// ----------------------------------------------------------------------------
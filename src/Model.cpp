@@ -80,7 +80,7 @@ Mesh<VertexP> Model<VertexP>::processMesh(aiMesh* pModel)
 		vertexList.push_back(vertex);
 	}
 
-	return Mesh<VertexP>(vertexList, processIndices(pModel));
+	return createMesh(vertexList, processIndices(pModel));
 }
 
 // ----------------------------------------------------------------------------
@@ -118,7 +118,7 @@ Mesh<VertexPN> Model<VertexPN>::processMesh(aiMesh* pModel)
 		vertexList.push_back(vertex);
 	}
 
-	return Mesh<VertexPN>(vertexList, processIndices(pModel));
+	return createMesh(vertexList, processIndices(pModel));
 }
 
 // ----------------------------------------------------------------------------
@@ -158,7 +158,7 @@ Mesh<VertexPC> Model<VertexPC>::processMesh(aiMesh* pModel)
 		vertexList.push_back(vertex);
 	}
 
-	return Mesh<VertexPC>(vertexList, processIndices(pModel));
+	return createMesh(vertexList, processIndices(pModel));
 }
 
 // ----------------------------------------------------------------------------
@@ -229,7 +229,7 @@ Mesh<VertexPTNT> Model<VertexPTNT>::processMesh(aiMesh* pModel)
 		vertexList.push_back(vertex);
 	}
 
-	return Mesh<VertexPTNT>(vertexList, processIndices(pModel));
+	return createMesh(vertexList, processIndices(pModel));
 }
 
 // ----------------------------------------------------------------------------
@@ -283,7 +283,7 @@ Mesh<VertexPTT> Model<VertexPTT>::processMesh(aiMesh* pModel)
 		vertexList.push_back(vertex);
 	}
 
-	return Mesh<VertexPTT>(vertexList, processIndices(pModel));
+	return createMesh(vertexList, processIndices(pModel));
 }
 
 // ----------------------------------------------------------------------------
@@ -348,8 +348,99 @@ Mesh<VertexPNTT> Model<VertexPNTT>::processMesh(aiMesh* pModel)
 		vertexList.push_back(vertex);
 	}
 
-	return Mesh<VertexPNTT>(vertexList, processIndices(pModel));
+	return createMesh(vertexList, processIndices(pModel));
 }
 
 
+// ----------------------------------------------------------------------------
+
+template <>
+Mesh<VertexP> Model<VertexP>::processMesh(ObjMesh& objMesh)
+{
+	std::vector<VertexP> vertexList;
+	vertexList.reserve(objMesh.positions.size());
+
+	for (size_t i = 0; i < objMesh.positions.size(); i++)
+		vertexList.push_back(VertexP(objMesh.positions[i]));
+
+	return createMesh(vertexList, objMesh.indices);
+}
+
+// ----------------------------------------------------------------------------
+
+template <>
+Mesh<VertexPN> Model<VertexPN>::processMesh(ObjMesh& objMesh)
+{
+	std::vector<VertexPN> vertexList;
+	vertexList.reserve(objMesh.positions.size());
+
+	for (size_t i = 0; i < objMesh.positions.size(); i++)
+		vertexList.push_back(VertexPN(objMesh.positions[i], objMesh.normals[i]));
+
+	return createMesh(vertexList, objMesh.indices);
+}
+
+// ----------------------------------------------------------------------------
+
+template <>
+Mesh<VertexPC> Model<VertexPC>::processMesh(ObjMesh& objMesh)
+{
+	std::vector<VertexPC> vertexList;
+	vertexList.reserve(objMesh.positions.size());
+
+	// OBJ has no vertex colors
+	for (size_t i = 0; i < objMesh.positions.size(); i++)
+		vertexList.push_back(VertexPC(objMesh.positions[i], glm::vec4(0.0f)));
+
+	return createMesh(vertexList, objMesh.indices);
+}
+
+// ----------------------------------------------------------------------------
+
+template <>
+Mesh<VertexPTNT> Model<VertexPTNT>::processMesh(ObjMesh& objMesh)
+{
+	std::vector<VertexPTNT> vertexList;
+	vertexList.reserve(objMesh.positions.size());
+
+	for (size_t i = 0; i < objMesh.positions.size(); i++)
+	{
+		vertexList.push_back(VertexPTNT(objMesh.positions[i],
+			objMesh.textureCoords[i],
+			objMesh.normals[i],
+			objMesh.tangents[i],
+			objMesh.bitangents[i]));
+	}
+
+	return createMesh(vertexList, objMesh.indices);
+}
+
+// ----------------------------------------------------------------------------
+
+template <>
+Mesh<VertexPTT> Model<VertexPTT>::processMesh(ObjMesh& objMesh)
+{
+	std::vector<VertexPTT> vertexList;
+	vertexList.reserve(objMesh.positions.size());
+
+	for (size_t i = 0; i < objMesh.positions.size(); i++)
+		vertexList.push_back(VertexPTT(objMesh.positions[i], objMesh.textureCoords[i], objMesh.tangents[i]));
+
+	return createMesh(vertexList, objMesh.indices);
+}
+
+// ----------------------------------------------------------------------------
+
+template <>
+Mesh<VertexPNTT> Model<VertexPNTT>::processMesh(ObjMesh& objMesh)
+{
+	std::vector<VertexPNTT> vertexList;
+	vertexList.reserve(objMesh.positions.size());
+
+	for (size_t i = 0; i < objMesh.positions.size(); i++)
+		vertexList.push_back(VertexPNTT(objMesh.positions[i], objMesh.normals[i], objMesh.textureCoords[i], objMesh.tangents[i]));
+
+	return createMesh(vertexList, objMesh.indices);
+}
+
 // ----------------------------------------------------------------------------
\ No newline at end of file
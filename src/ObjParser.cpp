@@ -0,0 +1,808 @@
+#include "ObjParser.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+// ----------------------------------------------------------------------------
+
+namespace
+{
+	// Read only view of a whole file
+	class MappedFile
+	{
+	public:
+		MappedFile() {}
+		~MappedFile() { close(); }
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool open(const std::string& filePath)
+		{
+#ifdef _WIN32
+			m_file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (m_file == INVALID_HANDLE_VALUE)
+				return false;
+
+			LARGE_INTEGER fileSize;
+			if (GetFileSizeEx(m_file, &fileSize) == FALSE || fileSize.QuadPart == 0)
+				return false;
+			m_size = static_cast<size_t>(fileSize.QuadPart);
+
+			m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (m_mapping == nullptr)
+				return false;
+
+			m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+			return m_data != nullptr;
+#else
+			m_file = ::open(filePath.c_str(), O_RDONLY);
+			if (m_file < 0)
+				return false;
+
+			struct stat fileStat;
+			if (fstat(m_file, &fileStat) != 0 || fileStat.st_size == 0)
+				return false;
+			m_size = static_cast<size_t>(fileStat.st_size);
+
+			void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+			if (data == MAP_FAILED)
+				return false;
+
+			madvise(data, m_size, MADV_SEQUENTIAL);
+			m_data = static_cast<const char*>(data);
+			return true;
+#endif // _WIN32
+		}
+
+		void close()
+		{
+#ifdef _WIN32
+			if (m_data != nullptr)
+				UnmapViewOfFile(m_data);
+			if (m_mapping != nullptr)
+				CloseHandle(m_mapping);
+			if (m_file != INVALID_HANDLE_VALUE)
+				CloseHandle(m_file);
+			m_mapping = nullptr;
+			m_file = INVALID_HANDLE_VALUE;
+#else
+			if (m_data != nullptr)
+				munmap(const_cast<char*>(m_data), m_size);
+			if (m_file >= 0)
+				::close(m_file);
+			m_file = -1;
+#endif // _WIN32
+			m_data = nullptr;
+			m_size = 0;
+		}
+
+		inline const char* data() const { return m_data; }
+		inline size_t size() const { return m_size; }
+
+	private:
+		const char* m_data = nullptr;
+		size_t m_size = 0;
+#ifdef _WIN32
+		HANDLE m_file = INVALID_HANDLE_VALUE;
+		HANDLE m_mapping = nullptr;
+#else
+		int m_file = -1;
+#endif // _WIN32
+	};
+
+	// ------------------------------------------------------------------------
+
+	// Smallest chunk worth a separate thread
+	const size_t MIN_CHUNK_SIZE = 256 * 1024;
+	// Vertices addressable with GLushort indices
+	const size_t MAX_MESH_VERTICES = 65535;
+
+	enum CornerFlags : unsigned char
+	{
+		PositionRelative = 1 << 0,
+		TextureCoordRelative = 1 << 1,
+		NormalRelative = 1 << 2,
+		HasTextureCoord = 1 << 3,
+		HasNormal = 1 << 4,
+	};
+
+	// Face corner as written in the file. Absolute indices are 0 based, relative (negative) indices are
+	// stored relative to the start of the chunk because the global offsets are only known after parsing.
+	struct FaceCorner
+	{
+		int position;
+		int textureCoord;
+		int normal;
+		unsigned char flags;
+	};
+
+	// Object/group/material change - starts a new mesh at the given corner
+	struct GroupStart
+	{
+		size_t cornerOffset;
+		// Empty for material changes which keep the current name
+		std::string name;
+	};
+
+	struct ChunkData
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec2> textureCoords;
+		std::vector<glm::vec3> normals;
+
+		std::vector<FaceCorner> corners;
+		std::vector<GroupStart> groups;
+
+		bool valid = true;
+	};
+
+	// ------------------------------------------------------------------------
+
+	inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+	inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+	inline const char* skipSpaces(const char* p, const char* end)
+	{
+		while (p < end && isSpace(*p))
+			p++;
+		return p;
+	}
+
+	inline const char* skipLine(const char* p, const char* end)
+	{
+		while (p < end && *p != '\n')
+			p++;
+		return p < end ? p + 1 : end;
+	}
+
+	// ------------------------------------------------------------------------
+
+	// Locale independent float parser for the formats written by DCC tools (no inf/nan, no hex)
+	inline const char* parseFloat(const char* p, const char* end, float& out)
+	{
+		static const double powersOf10[] =
+		{
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+			1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+
+		p = skipSpaces(p, end);
+
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negative = *p == '-';
+			p++;
+		}
+
+		unsigned long long mantissa = 0;
+		int exponent = 0;
+		int digits = 0;
+
+		for (; p < end && isDigit(*p); ++p)
+		{
+			// Ignore digits that don't fit the mantissa - they only affect precision below float
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				digits += mantissa != 0;
+			}
+			else
+				exponent++;
+		}
+
+		if (p < end && *p == '.')
+		{
+			for (++p; p < end && isDigit(*p); ++p)
+			{
+				if (digits < 19)
+				{
+					mantissa = mantissa * 10 + (*p - '0');
+					digits += mantissa != 0;
+					exponent--;
+				}
+			}
+		}
+
+		if (p < end && (*p == 'e' || *p == 'E'))
+		{
+			const char* exponentStart = p++;
+			bool negativeExponent = false;
+			if (p < end && (*p == '-' || *p == '+'))
+			{
+				negativeExponent = *p == '-';
+				p++;
+			}
+
+			if (p < end && isDigit(*p))
+			{
+				int value = 0;
+				for (; p < end && isDigit(*p); ++p)
+					value = std::min(value * 10 + (*p - '0'), 1000);
+				exponent += negativeExponent ? -value : value;
+			}
+			else
+				p = exponentStart;
+		}
+
+		double value = static_cast<double>(mantissa);
+		if (exponent < 0)
+			value = exponent >= -22 ? value / powersOf10[-exponent] : value * std::pow(10.0, exponent);
+		else if (exponent > 0)
+			value = exponent <= 22 ? value * powersOf10[exponent] : value * std::pow(10.0, exponent);
+
+		out = static_cast<float>(negative ? -value : value);
+		return p;
+	}
+
+	// ------------------------------------------------------------------------
+
+	inline const char* parseInt(const char* p, const char* end, int& out, bool& valid)
+	{
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negative = *p == '-';
+			p++;
+		}
+
+		valid = p < end && isDigit(*p);
+
+		int value = 0;
+		for (; p < end && isDigit(*p); ++p)
+			value = value * 10 + (*p - '0');
+
+		out = negative ? -value : value;
+		return p;
+	}
+
+	// ------------------------------------------------------------------------
+
+	// Convert a file index (1 based, or negative relative to the current count) to the corner encoding
+	inline bool encodeIndex(int fileIndex, size_t chunkCount, unsigned char relativeFlag, int& outIndex, unsigned char& outFlags)
+	{
+		if (fileIndex > 0)
+		{
+			outIndex = fileIndex - 1;
+			return true;
+		}
+		if (fileIndex < 0)
+		{
+			// May point before the chunk start - resolved with the chunk offset later
+			outIndex = static_cast<int>(chunkCount) + fileIndex;
+			outFlags |= relativeFlag;
+			return true;
+		}
+		return false;
+	}
+
+	// ------------------------------------------------------------------------
+
+	const char* parseFace(const char* p, const char* end, ChunkData& chunk)
+	{
+		FaceCorner first, previous;
+		unsigned int cornerCount = 0;
+
+		while (true)
+		{
+			p = skipSpaces(p, end);
+			if (p >= end || *p == '\n' || *p == '#')
+				break;
+
+			FaceCorner corner = { 0, 0, 0, 0 };
+			int index;
+			bool valid;
+
+			// Position
+			p = parseInt(p, end, index, valid);
+			if (valid == false || encodeIndex(index, chunk.positions.size(), PositionRelative, corner.position, corner.flags) == false)
+			{
+				chunk.valid = false;
+				return skipLine(p, end);
+			}
+
+			if (p < end && *p == '/')
+			{
+				p++;
+
+				// Texture coordinate (optional for v//vn)
+				if (p < end && *p != '/')
+				{
+					p = parseInt(p, end, index, valid);
+					if (valid && encodeIndex(index, chunk.textureCoords.size(), TextureCoordRelative, corner.textureCoord, corner.flags))
+						corner.flags |= HasTextureCoord;
+				}
+
+				// Normal
+				if (p < end && *p == '/')
+				{
+					p = parseInt(p + 1, end, index, valid);
+					if (valid && encodeIndex(index, chunk.normals.size(), NormalRelative, corner.normal, corner.flags))
+						corner.flags |= HasNormal;
+				}
+			}
+
+			// Triangle fan
+			if (cornerCount == 0)
+				first = corner;
+			else if (cornerCount >= 2)
+			{
+				chunk.corners.push_back(first);
+				chunk.corners.push_back(previous);
+				chunk.corners.push_back(corner);
+			}
+
+			previous = corner;
+			cornerCount++;
+		}
+
+		return skipLine(p, end);
+	}
+
+	// ------------------------------------------------------------------------
+
+	const char* parseName(const char* p, const char* end, std::string& outName)
+	{
+		p = skipSpaces(p, end);
+
+		const char* nameStart = p;
+		while (p < end && *p != '\n')
+			p++;
+
+		const char* nameEnd = p;
+		while (nameEnd > nameStart && isSpace(*(nameEnd - 1)))
+			nameEnd--;
+
+		outName.assign(nameStart, nameEnd);
+		return p < end ? p + 1 : end;
+	}
+
+	// ------------------------------------------------------------------------
+
+	void parseChunk(const char* p, const char* end, ChunkData& chunk)
+	{
+		// Rough reservation - about 30 bytes per line
+		size_t estimatedLines = (end - p) / 30;
+		chunk.positions.reserve(estimatedLines / 2);
+		chunk.corners.reserve(estimatedLines);
+
+		while (p < end)
+		{
+			p = skipSpaces(p, end);
+			if (p >= end)
+				break;
+
+			if (p[0] == 'v')
+			{
+				if (p + 1 < end && isSpace(p[1]))
+				{
+					glm::vec3 position;
+					p = parseFloat(p + 1, end, position.x);
+					p = parseFloat(p, end, position.y);
+					p = parseFloat(p, end, position.z);
+					chunk.positions.push_back(position);
+				}
+				else if (p + 1 < end && p[1] == 't')
+				{
+					glm::vec2 textureCoord;
+					p = parseFloat(p + 2, end, textureCoord.x);
+					p = parseFloat(p, end, textureCoord.y);
+					chunk.textureCoords.push_back(textureCoord);
+				}
+				else if (p + 1 < end && p[1] == 'n')
+				{
+					glm::vec3 normal;
+					p = parseFloat(p + 2, end, normal.x);
+					p = parseFloat(p, end, normal.y);
+					p = parseFloat(p, end, normal.z);
+					chunk.normals.push_back(normal);
+				}
+				p = skipLine(p, end);
+			}
+			else if (p[0] == 'f' && p + 1 < end && isSpace(p[1]))
+			{
+				p = parseFace(p + 1, end, chunk);
+			}
+			else if ((p[0] == 'o' || p[0] == 'g') && p + 1 < end && isSpace(p[1]))
+			{
+				GroupStart group;
+				group.cornerOffset = chunk.corners.size();
+				p = parseName(p + 1, end, group.name);
+				chunk.groups.push_back(group);
+			}
+			else if (end - p > 7 && std::equal(p, p + 6, "usemtl") && isSpace(p[6]))
+			{
+				GroupStart group;
+				group.cornerOffset = chunk.corners.size();
+				p = skipLine(p, end);
+				chunk.groups.push_back(group);
+			}
+			else
+			{
+				// Comments, smoothing groups, material libraries...
+				p = skipLine(p, end);
+			}
+		}
+	}
+
+	// ------------------------------------------------------------------------
+
+	// Unique vertex key - global attribute indices, -1 when missing
+	struct VertexKey
+	{
+		int position;
+		int textureCoord;
+		int normal;
+
+		inline bool operator==(const VertexKey& other) const
+		{
+			return position == other.position && textureCoord == other.textureCoord && normal == other.normal;
+		}
+	};
+
+	struct VertexKeyHash
+	{
+		inline size_t operator()(const VertexKey& key) const
+		{
+			size_t hash = static_cast<size_t>(key.position) * 73856093u;
+			hash ^= static_cast<size_t>(key.textureCoord) * 19349663u;
+			hash ^= static_cast<size_t>(key.normal) * 83492791u;
+			return hash;
+		}
+	};
+
+	// ------------------------------------------------------------------------
+
+	// Accumulates triangles into a mesh, merging corners with the same attribute indices
+	class MeshBuilder
+	{
+	public:
+		MeshBuilder(const std::vector<glm::vec3>& positions,
+			const std::vector<glm::vec2>& textureCoords,
+			const std::vector<glm::vec3>& normals,
+			std::vector<ObjMesh>& outMeshList)
+			: m_positions(positions), m_textureCoords(textureCoords), m_normals(normals), m_meshList(outMeshList) {}
+
+		void beginMesh(const std::string& name)
+		{
+			flush();
+			if (name.empty() == false)
+				m_name = name;
+		}
+
+		bool addTriangle(const VertexKey* triangle)
+		{
+			for (unsigned int corner = 0; corner < 3; ++corner)
+			{
+				const VertexKey& key = triangle[corner];
+				if (key.position < 0 || key.position >= static_cast<int>(m_positions.size()) ||
+					key.textureCoord >= static_cast<int>(m_textureCoords.size()) ||
+					key.normal >= static_cast<int>(m_normals.size()))
+					return false;
+			}
+
+			// Split the mesh before it runs out of 16 bit indices
+			if (m_mesh.positions.size() + 3 > MAX_MESH_VERTICES)
+				flush();
+
+			for (unsigned int corner = 0; corner < 3; ++corner)
+			{
+				const VertexKey& key = triangle[corner];
+
+				auto insertResult = m_vertexMap.emplace(key, static_cast<GLushort>(m_mesh.positions.size()));
+				if (insertResult.second)
+				{
+					m_mesh.positions.push_back(m_positions[key.position]);
+					m_vertexPositionIndex.push_back(key.position);
+
+					// Flip V like aiProcess_FlipUVs
+					glm::vec2 textureCoord(0.0f);
+					if (key.textureCoord >= 0)
+					{
+						textureCoord = m_textureCoords[key.textureCoord];
+						textureCoord.y = 1.0f - textureCoord.y;
+						m_mesh.hasTextureCoords = true;
+					}
+					m_mesh.textureCoords.push_back(textureCoord);
+
+					m_mesh.normals.push_back(key.normal >= 0 ? m_normals[key.normal] : glm::vec3(0.0f));
+					if (key.normal < 0)
+						m_missingNormals = true;
+				}
+
+				m_mesh.indices.push_back(insertResult.first->second);
+			}
+
+			return true;
+		}
+
+		void flush()
+		{
+			if (m_mesh.indices.size() > 0)
+			{
+				m_mesh.name = m_name;
+
+				if (m_missingNormals)
+					generateNormals();
+				if (m_mesh.hasTextureCoords)
+					generateTangents();
+				else
+				{
+					m_mesh.tangents.assign(m_mesh.positions.size(), glm::vec3(0.0f));
+					m_mesh.bitangents.assign(m_mesh.positions.size(), glm::vec3(0.0f));
+				}
+
+				m_meshList.push_back(std::move(m_mesh));
+			}
+
+			m_mesh = ObjMesh();
+			m_vertexMap.clear();
+			m_vertexPositionIndex.clear();
+			m_missingNormals = false;
+		}
+
+	private:
+
+		// Smooth normals for the vertices without one, shared by all vertices with the same position
+		void generateNormals()
+		{
+			std::unordered_map<int, glm::vec3> positionNormals;
+
+			for (size_t index = 0; index < m_mesh.indices.size(); index += 3)
+			{
+				GLushort i0 = m_mesh.indices[index + 0];
+				GLushort i1 = m_mesh.indices[index + 1];
+				GLushort i2 = m_mesh.indices[index + 2];
+
+				// Area weighted face normal
+				glm::vec3 faceNormal = glm::cross(m_mesh.positions[i1] - m_mesh.positions[i0], m_mesh.positions[i2] - m_mesh.positions[i0]);
+
+				positionNormals[m_vertexPositionIndex[i0]] += faceNormal;
+				positionNormals[m_vertexPositionIndex[i1]] += faceNormal;
+				positionNormals[m_vertexPositionIndex[i2]] += faceNormal;
+			}
+
+			for (size_t vertexIndex = 0; vertexIndex < m_mesh.positions.size(); ++vertexIndex)
+			{
+				glm::vec3& normal = m_mesh.normals[vertexIndex];
+				if (normal.x != 0.0f || normal.y != 0.0f || normal.z != 0.0f)
+					continue;
+
+				glm::vec3 positionNormal = positionNormals[m_vertexPositionIndex[vertexIndex]];
+				float length = glm::length(positionNormal);
+				if (length > 0.0f)
+					normal = positionNormal / length;
+			}
+		}
+
+		// Per vertex tangent frame from the texture coordinate gradients, like aiProcess_CalcTangentSpace
+		void generateTangents()
+		{
+			m_mesh.tangents.assign(m_mesh.positions.size(), glm::vec3(0.0f));
+			m_mesh.bitangents.assign(m_mesh.positions.size(), glm::vec3(0.0f));
+
+			for (size_t index = 0; index < m_mesh.indices.size(); index += 3)
+			{
+				GLushort i0 = m_mesh.indices[index + 0];
+				GLushort i1 = m_mesh.indices[index + 1];
+				GLushort i2 = m_mesh.indices[index + 2];
+
+				glm::vec3 edge1 = m_mesh.positions[i1] - m_mesh.positions[i0];
+				glm::vec3 edge2 = m_mesh.positions[i2] - m_mesh.positions[i0];
+				glm::vec2 deltaUV1 = m_mesh.textureCoords[i1] - m_mesh.textureCoords[i0];
+				glm::vec2 deltaUV2 = m_mesh.textureCoords[i2] - m_mesh.textureCoords[i0];
+
+				float determinant = deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y;
+				if (determinant == 0.0f)
+					continue;
+
+				float inverseDeterminant = 1.0f / determinant;
+				glm::vec3 tangent = (edge1 * deltaUV2.y - edge2 * deltaUV1.y) * inverseDeterminant;
+				glm::vec3 bitangent = (edge2 * deltaUV1.x - edge1 * deltaUV2.x) * inverseDeterminant;
+
+				for (GLushort vertexIndex : { i0, i1, i2 })
+				{
+					m_mesh.tangents[vertexIndex] += tangent;
+					m_mesh.bitangents[vertexIndex] += bitangent;
+				}
+			}
+
+			// Orthonormalize against the normal
+			for (size_t vertexIndex = 0; vertexIndex < m_mesh.positions.size(); ++vertexIndex)
+			{
+				const glm::vec3& normal = m_mesh.normals[vertexIndex];
+				glm::vec3& tangent = m_mesh.tangents[vertexIndex];
+				glm::vec3& bitangent = m_mesh.bitangents[vertexIndex];
+
+				tangent = tangent - normal * glm::dot(normal, tangent);
+				float tangentLength = glm::length(tangent);
+				tangent = tangentLength > 0.0f ? tangent / tangentLength : glm::vec3(0.0f);
+
+				bitangent = bitangent - normal * glm::dot(normal, bitangent);
+				float bitangentLength = glm::length(bitangent);
+				bitangent = bitangentLength > 0.0f ? bitangent / bitangentLength : glm::vec3(0.0f);
+			}
+		}
+
+		const std::vector<glm::vec3>& m_positions;
+		const std::vector<glm::vec2>& m_textureCoords;
+		const std::vector<glm::vec3>& m_normals;
+		std::vector<ObjMesh>& m_meshList;
+
+		std::string m_name;
+		ObjMesh m_mesh;
+		std::unordered_map<VertexKey, GLushort, VertexKeyHash> m_vertexMap;
+		std::vector<int> m_vertexPositionIndex;
+		bool m_missingNormals = false;
+	};
+
+	// ------------------------------------------------------------------------
+
+	inline int resolveIndex(int index, unsigned char flags, unsigned char relativeFlag, size_t chunkOffset)
+	{
+		return (flags & relativeFlag) ? static_cast<int>(chunkOffset) + index : index;
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+bool ObjParser::load(const std::string& filePath, std::vector<ObjMesh>& outMeshList)
+{
+	MappedFile file;
+	if (file.open(filePath) == false)
+	{
+		std::cout << "Failed to map OBJ file: " << filePath << std::endl;
+		return false;
+	}
+
+	const char* begin = file.data();
+	const char* end = begin + file.size();
+
+	// Split the file into line aligned chunks
+	size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+	size_t chunkCount = std::max<size_t>(1, std::min(threadCount, file.size() / MIN_CHUNK_SIZE));
+
+	std::vector<const char*> chunkStart(chunkCount + 1);
+	chunkStart[0] = begin;
+	chunkStart[chunkCount] = end;
+	for (size_t chunkIndex = 1; chunkIndex < chunkCount; ++chunkIndex)
+	{
+		const char* split = begin + file.size() * chunkIndex / chunkCount;
+		split = std::max(split, chunkStart[chunkIndex - 1]);
+		chunkStart[chunkIndex] = skipLine(split, end);
+	}
+
+	// Parse the chunks in parallel
+	std::vector<ChunkData> chunks(chunkCount);
+	{
+		std::vector<std::thread> workers;
+		for (size_t chunkIndex = 1; chunkIndex < chunkCount; ++chunkIndex)
+			workers.emplace_back(parseChunk, chunkStart[chunkIndex], chunkStart[chunkIndex + 1], std::ref(chunks[chunkIndex]));
+
+		parseChunk(chunkStart[0], chunkStart[1], chunks[0]);
+
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	// Concatenate the attributes
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec2> textureCoords;
+	std::vector<glm::vec3> normals;
+	std::vector<size_t> positionOffset(chunkCount), textureCoordOffset(chunkCount), normalOffset(chunkCount);
+	{
+		size_t positionCount = 0, textureCoordCount = 0, normalCount = 0;
+		for (size_t chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex)
+		{
+			if (chunks[chunkIndex].valid == false)
+			{
+				std::cout << "Malformed face in OBJ file: " << filePath << std::endl;
+				return false;
+			}
+
+			positionOffset[chunkIndex] = positionCount;
+			textureCoordOffset[chunkIndex] = textureCoordCount;
+			normalOffset[chunkIndex] = normalCount;
+
+			positionCount += chunks[chunkIndex].positions.size();
+			textureCoordCount += chunks[chunkIndex].textureCoords.size();
+			normalCount += chunks[chunkIndex].normals.size();
+		}
+
+		positions.reserve(positionCount);
+		textureCoords.reserve(textureCoordCount);
+		normals.reserve(normalCount);
+		for (ChunkData& chunk : chunks)
+		{
+			positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+			textureCoords.insert(textureCoords.end(), chunk.textureCoords.begin(), chunk.textureCoords.end());
+			normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+
+			chunk.positions = std::vector<glm::vec3>();
+			chunk.textureCoords = std::vector<glm::vec2>();
+			chunk.normals = std::vector<glm::vec3>();
+		}
+	}
+
+	// Merge the faces in file order
+	std::vector<ObjMesh> meshList;
+	MeshBuilder meshBuilder(positions, textureCoords, normals, meshList);
+
+	for (size_t chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex)
+	{
+		const ChunkData& chunk = chunks[chunkIndex];
+		size_t groupIndex = 0;
+
+		for (size_t cornerIndex = 0; cornerIndex < chunk.corners.size(); cornerIndex += 3)
+		{
+			while (groupIndex < chunk.groups.size() && chunk.groups[groupIndex].cornerOffset <= cornerIndex)
+				meshBuilder.beginMesh(chunk.groups[groupIndex++].name);
+
+			VertexKey triangle[3];
+			for (unsigned int corner = 0; corner < 3; ++corner)
+			{
+				const FaceCorner& faceCorner = chunk.corners[cornerIndex + corner];
+
+				triangle[corner].position = resolveIndex(faceCorner.position, faceCorner.flags, PositionRelative, positionOffset[chunkIndex]);
+				triangle[corner].textureCoord = (faceCorner.flags & HasTextureCoord) ?
+					resolveIndex(faceCorner.textureCoord, faceCorner.flags, TextureCoordRelative, textureCoordOffset[chunkIndex]) : -1;
+				triangle[corner].normal = (faceCorner.flags & HasNormal) ?
+					resolveIndex(faceCorner.normal, faceCorner.flags, NormalRelative, normalOffset[chunkIndex]) : -1;
+			}
+
+			if (meshBuilder.addTriangle(triangle) == false)
+			{
+				std::cout << "Face index out of range in OBJ file: " << filePath << std::endl;
+				return false;
+			}
+		}
+
+		// Trailing group changes only affect the next chunk's faces
+		while (groupIndex < chunk.groups.size())
+			meshBuilder.beginMesh(chunk.groups[groupIndex++].name);
+	}
+	meshBuilder.flush();
+
+	if (meshList.size() == 0)
+	{
+		std::cout << "No faces found in OBJ file: " << filePath << std::endl;
+		return false;
+	}
+
+	outMeshList.insert(outMeshList.end(), std::make_move_iterator(meshList.begin()), std::make_move_iterator(meshList.end()));
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool ObjParser::isObjFile(const std::string& filePath)
+{
+	size_t extensionStart = filePath.find_last_of('.');
+	if (extensionStart == std::string::npos)
+		return false;
+
+	std::string extension = filePath.substr(extensionStart);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+	return extension == ".obj";
+}
+
+// ----------------------------------------------------------------------------
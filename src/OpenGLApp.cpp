@@ -3,6 +3,8 @@
 #include <vector>
 #include <assert.h>
 
+#include "GLState.h"
+
 // ----------------------------------------------------------------------------
 
 static void error_callback(int error, const char* description)
@@ -189,9 +191,9 @@ bool OpenGLApp::setOpenGLState() const
 	//glCullFace(GL_BACK);
 
 	// Enable depth test and set depth function
-	glEnable(GL_DEPTH_TEST);
-	glDepthFunc(GL_LESS);
-	glDepthMask(GL_TRUE);
+	GLState::Instance().enable(GL_DEPTH_TEST);
+	GLState::Instance().depthFunc(GL_LESS);
+	GLState::Instance().depthMask(GL_TRUE);
 
 	// Success
 	return true;
@@ -0,0 +1,266 @@
+#include "ProgramCache.h"
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+
+// ----------------------------------------------------------------------------
+
+const char* ProgramCache::FILE_PATH = "../Shaders/programs.cache";
+
+// ----------------------------------------------------------------------------
+
+ProgramCache::ProgramCache()
+	: m_opened(false), m_supported(false), m_modified(false)
+{
+}
+
+// ----------------------------------------------------------------------------
+
+ProgramCache::~ProgramCache()
+{
+	// Binaries of edited shaders and of removed programs would pile up in the file
+	for (auto entry = m_entryList.begin(); entry != m_entryList.end();)
+	{
+		if (entry->second.used)
+		{
+			++entry;
+			continue;
+		}
+
+		entry = m_entryList.erase(entry);
+		m_modified = true;
+	}
+
+	save();
+}
+
+// ----------------------------------------------------------------------------
+
+std::uint64_t ProgramCache::hash(const std::string& data, std::uint64_t hash)
+{
+	for (unsigned char character : data)
+	{
+		hash ^= character;
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+// ----------------------------------------------------------------------------
+
+bool ProgramCache::supported()
+{
+	open();
+	return m_supported;
+}
+
+// ----------------------------------------------------------------------------
+
+void ProgramCache::open()
+{
+	if (m_opened)
+		return;
+	m_opened = true;
+
+	GLint formatCount = 0;
+	if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	m_supported = formatCount > 0;
+	if (m_supported == false)
+	{
+		std::cout << "Program binaries not supported, the program cache is disabled.\n";
+		return;
+	}
+
+	m_driverVersion = std::string((const char*)glGetString(GL_VENDOR)) + " " +
+		(const char*)glGetString(GL_RENDERER) + " " + (const char*)glGetString(GL_VERSION);
+
+	if (readFile() == false)
+		m_entryList.clear();
+}
+
+// ----------------------------------------------------------------------------
+
+bool ProgramCache::readFile()
+{
+	std::ifstream file(FILE_PATH, std::ios::in | std::ios::binary);
+	if (file.is_open() == false)
+		return false;
+
+	// The lengths read from the file are checked against the bytes left before allocating
+	file.seekg(0, std::ios::end);
+	const std::streamoff fileLength = file.tellg();
+	file.seekg(0, std::ios::beg);
+	auto remainingLength = [&file, fileLength]() { return static_cast<std::uint64_t>(fileLength - file.tellg()); };
+
+	char magic[4] = {};
+	std::uint32_t version = 0;
+	file.read(magic, sizeof(magic));
+	file.read((char*)&version, sizeof(version));
+	if (file.good() == false || std::string(magic, sizeof(magic)) != "GLPC" || version != FILE_VERSION)
+	{
+		std::cout << "Program cache " << FILE_PATH << " has an unknown format, ignored.\n";
+		return false;
+	}
+
+	// Binaries are only valid for the driver which produced them
+	std::uint32_t driverLength = 0;
+	file.read((char*)&driverLength, sizeof(driverLength));
+	if (file.good() == false || driverLength > remainingLength())
+	{
+		std::cout << "Program cache " << FILE_PATH << " is truncated, ignored.\n";
+		return false;
+	}
+	std::string driverVersion(driverLength, '\0');
+	file.read(&driverVersion[0], driverLength);
+	if (file.good() == false || driverVersion != m_driverVersion)
+	{
+		std::cout << "Program cache built by a different driver, ignored.\n";
+		return false;
+	}
+
+	std::uint32_t entryCount = 0;
+	file.read((char*)&entryCount, sizeof(entryCount));
+	for (std::uint32_t entryIndex = 0; entryIndex < entryCount && file.good(); ++entryIndex)
+	{
+		std::uint64_t sourceHash = 0;
+		std::uint32_t format = 0;
+		std::uint32_t size = 0;
+		Entry entry;
+
+		file.read((char*)&sourceHash, sizeof(sourceHash));
+		file.read((char*)&format, sizeof(format));
+		file.read((char*)&entry.buildTime, sizeof(entry.buildTime));
+		file.read((char*)&size, sizeof(size));
+		if (file.good() == false || size > remainingLength())
+		{
+			file.setstate(std::ios::failbit);
+			break;
+		}
+		entry.format = format;
+		entry.binary.resize(size);
+		file.read(entry.binary.data(), size);
+
+		if (file.good())
+			m_entryList[sourceHash] = std::move(entry);
+	}
+
+	if (file.good() == false)
+	{
+		std::cout << "Program cache " << FILE_PATH << " is truncated, ignored.\n";
+		return false;
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool ProgramCache::writeFile() const
+{
+	std::ofstream file(FILE_PATH, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (file.is_open() == false)
+	{
+		std::cout << "Failed to write the program cache " << FILE_PATH << "\n";
+		return false;
+	}
+
+	std::uint32_t version = FILE_VERSION;
+	std::uint32_t driverLength = (std::uint32_t)m_driverVersion.size();
+	std::uint32_t entryCount = (std::uint32_t)m_entryList.size();
+
+	file.write("GLPC", 4);
+	file.write((const char*)&version, sizeof(version));
+	file.write((const char*)&driverLength, sizeof(driverLength));
+	file.write(m_driverVersion.data(), driverLength);
+	file.write((const char*)&entryCount, sizeof(entryCount));
+
+	for (auto& entry : m_entryList)
+	{
+		std::uint32_t format = entry.second.format;
+		std::uint32_t size = (std::uint32_t)entry.second.binary.size();
+
+		file.write((const char*)&entry.first, sizeof(entry.first));
+		file.write((const char*)&format, sizeof(format));
+		file.write((const char*)&entry.second.buildTime, sizeof(entry.second.buildTime));
+		file.write((const char*)&size, sizeof(size));
+		file.write(entry.second.binary.data(), size);
+	}
+
+	return file.good();
+}
+
+// ----------------------------------------------------------------------------
+
+bool ProgramCache::load(GLuint program, std::uint64_t sourceHash)
+{
+	if (supported() == false)
+		return false;
+
+	auto entry = m_entryList.find(sourceHash);
+	if (entry == m_entryList.end())
+	{
+		m_stats.missCount++;
+		return false;
+	}
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	Entry& cached = entry->second;
+	cached.used = true;
+	glProgramBinary(program, cached.format, cached.binary.data(), (GLsizei)cached.binary.size());
+
+	// The driver can reject a binary it produced, after an update keeping the same version string
+	GLint linkStatus = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+	if (linkStatus != GL_TRUE)
+	{
+		m_entryList.erase(entry);
+		m_modified = true;
+		m_stats.missCount++;
+		return false;
+	}
+
+	m_stats.hitCount++;
+	m_stats.loadTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	m_stats.buildTime += cached.buildTime;
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+
+void ProgramCache::store(GLuint program, std::uint64_t sourceHash, double buildTime)
+{
+	if (supported() == false)
+		return;
+
+	GLint binaryLength = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+	if (binaryLength <= 0)
+		return;
+
+	Entry entry;
+	entry.buildTime = (float)buildTime;
+	entry.used = true;
+	entry.binary.resize(binaryLength);
+	glGetProgramBinary(program, binaryLength, nullptr, &entry.format, entry.binary.data());
+
+	m_entryList[sourceHash] = std::move(entry);
+	m_modified = true;
+}
+
+// ----------------------------------------------------------------------------
+
+void ProgramCache::save()
+{
+	if (m_modified == false)
+		return;
+
+	if (writeFile())
+		m_modified = false;
+}
+
+// ----------------------------------------------------------------------------
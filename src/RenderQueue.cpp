@@ -0,0 +1,427 @@
+#include "RenderQueue.h"
+
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#include "GLState.h"
+
+// ----------------------------------------------------------------------------
+
+RenderQueue::RenderQueue()
+	: m_instanceBuffer(0), m_instanceCapacity(0)
+{
+}
+
+// ----------------------------------------------------------------------------
+
+RenderQueue::~RenderQueue()
+{
+	if (m_instanceBuffer != 0)
+		glDeleteBuffers(1, &m_instanceBuffer);
+}
+
+// ----------------------------------------------------------------------------
+
+bool RenderQueue::initialize()
+{
+	if (m_objectUniforms.create(UniformBlock::Object, sizeof(ObjectUniformData), OBJECT_RING_SIZE) == false)
+	{
+		std::cout << "Failed to initialize the render queue object uniforms.\n";
+		return false;
+	}
+
+	glGenBuffers(1, &m_instanceBuffer);
+	if (m_instanceBuffer == 0)
+	{
+		std::cout << "Failed to initialize the render queue instance buffer.\n";
+		return false;
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+
+void RenderQueue::setInstancedShader(const Shader& shader, Shader& instancedShader)
+{
+	m_instancedShaders[&shader] = &instancedShader;
+}
+
+// ----------------------------------------------------------------------------
+
+void RenderQueue::bindObjectData(const glm::mat4& modelMat, const glm::mat4& normalMat)
+{
+	ObjectUniformData objectData;
+	objectData.model = modelMat;
+	objectData.normalMat = normalMat;
+
+	m_objectUniforms.bind(m_objectUniforms.write(objectData));
+}
+
+// ----------------------------------------------------------------------------
+
+GLuint RenderQueue::shaderId(GLuint program)
+{
+	auto it = m_shaderIds.find(program);
+	if (it != m_shaderIds.end())
+		return it->second;
+
+	GLuint id = static_cast<GLuint>(m_shaderIds.size()) & 0xFFF;
+	m_shaderIds[program] = id;
+	return id;
+}
+
+// ----------------------------------------------------------------------------
+
+GLuint RenderQueue::materialId(const MaterialTexturePBR* material)
+{
+	// No material sorts first
+	if (material == nullptr)
+		return 0;
+
+	auto it = m_materialIds.find(material);
+	if (it != m_materialIds.end())
+		return it->second;
+
+	GLuint id = static_cast<GLuint>(m_materialIds.size() + 1) & 0xFFFF;
+	m_materialIds[material] = id;
+	return id;
+}
+
+// ----------------------------------------------------------------------------
+
+GLuint RenderQueue::meshId(GLuint vertexArrayObject)
+{
+	auto it = m_meshIds.find(vertexArrayObject);
+	if (it != m_meshIds.end())
+		return it->second;
+
+	GLuint id = static_cast<GLuint>(m_meshIds.size()) & 0xFFFF;
+	m_meshIds[vertexArrayObject] = id;
+	return id;
+}
+
+// ----------------------------------------------------------------------------
+
+void RenderQueue::add(RenderPass pass, Shader& shader, MaterialTexturePBR* material, GLuint vertexArrayObject,
+	GLsizei indexCount, const glm::mat4& modelMat, const glm::mat4& normalMat, float viewDepth)
+{
+	size_t firstRange = m_rangeCounts.size();
+	m_rangeCounts.push_back(indexCount);
+	m_rangeOffsets.push_back(nullptr);
+
+	addItem(pass, shader, material, vertexArrayObject, firstRange, 1, modelMat, normalMat, viewDepth);
+}
+
+// ----------------------------------------------------------------------------
+
+void RenderQueue::add(RenderPass pass, Shader& shader, MaterialTexturePBR* material, GLuint vertexArrayObject,
+	const ClusterDrawList& drawList, const glm::mat4& modelMat, const glm::mat4& normalMat, float viewDepth)
+{
+	// Everything culled
+	if (drawList.counts.size() == 0)
+		return;
+
+	// Copy the ranges, the draw list is reused by the next cull of the mesh
+	size_t firstRange = m_rangeCounts.size();
+	m_rangeCounts.insert(m_rangeCounts.end(), drawList.counts.begin(), drawList.counts.end());
+	m_rangeOffsets.insert(m_rangeOffsets.end(), drawList.offsets.begin(), drawList.offsets.end());
+
+	addItem(pass, shader, material, vertexArrayObject, firstRange, drawList.counts.size(), modelMat, normalMat, viewDepth);
+}
+
+// ----------------------------------------------------------------------------
+
+void RenderQueue::addItem(RenderPass pass, Shader& shader, MaterialTexturePBR* material, GLuint vertexArrayObject,
+	size_t firstRange, size_t rangeCount, const glm::mat4& modelMat, const glm::mat4& normalMat, float viewDepth)
+{
+	RenderItem item;
+	item.shader = &shader;
+	item.material = material;
+	item.vertexArrayObject = vertexArrayObject;
+	item.firstRange = firstRange;
+	item.rangeCount = rangeCount;
+	item.modelMat = modelMat;
+	item.normalMat = normalMat;
+	m_itemList.push_back(item);
+
+	// The bits of a positive float grow with its value, the top 16 are a coarse depth
+	float depth = viewDepth > 0.0f ? viewDepth : 0.0f;
+	std::uint32_t depthBits;
+	memcpy(&depthBits, &depth, sizeof(depthBits));
+
+	std::uint64_t key =
+		(static_cast<std::uint64_t>(pass) << 60) |
+		(static_cast<std::uint64_t>(shaderId(shader.program())) << 48) |
+		(static_cast<std::uint64_t>(materialId(material)) << 32) |
+		(static_cast<std::uint64_t>(meshId(vertexArrayObject)) << 16) |
+		static_cast<std::uint64_t>(depthBits >> 16);
+	m_keyList.push_back(key);
+
+	m_stats.itemCount++;
+}
+
+// ----------------------------------------------------------------------------
+
+void RenderQueue::sortItems()
+{
+	const size_t itemCount = m_itemList.size();
+
+	m_sortedList.resize(itemCount);
+	m_sortScratch.resize(itemCount);
+	for (size_t index = 0; index < itemCount; ++index)
+		m_sortedList[index] = static_cast<GLuint>(index);
+
+	// 8 passes of 8 bits, least significant digit first
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		size_t histogram[257] = {};
+		for (GLuint item : m_sortedList)
+			histogram[((m_keyList[item] >> shift) & 0xFF) + 1]++;
+
+		// All the keys share the digit, the order doesn't change
+		if (histogram[((m_keyList[m_sortedList[0]] >> shift) & 0xFF) + 1] == itemCount)
+			continue;
+
+		for (int digit = 0; digit < 256; ++digit)
+			histogram[digit + 1] += histogram[digit];
+
+		for (GLuint item : m_sortedList)
+			m_sortScratch[histogram[(m_keyList[item] >> shift) & 0xFF]++] = item;
+
+		m_sortedList.swap(m_sortScratch);
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+void RenderQueue::bindMaterial(const MaterialTexturePBR& material, GLuint program, bool changed)
+{
+	const Texture2D* textureList[] = { material.albedo, material.normal, material.displacement,
+		material.metallic, material.roughness, material.ao };
+
+	for (const Texture2D* texture : textureList)
+	{
+		if (texture == nullptr)
+			continue;
+
+		// Same program and material as the previous draw, nothing to do
+		if (changed == false)
+		{
+			m_stats.textureBindsSkipped++;
+			continue;
+		}
+
+		// Sampler uniforms are program state
+		texture->setSamplerUniform(program);
+
+		GLuint unit = texture->textureUnit();
+		if (GLState::Instance().boundTexture(unit, GL_TEXTURE_2D) == texture->handle())
+		{
+			m_stats.textureBindsSkipped++;
+			continue;
+		}
+
+		GLState::Instance().bindTexture(unit, GL_TEXTURE_2D, texture->handle());
+		m_stats.textureBinds++;
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+bool RenderQueue::canInstance(const RenderItem& first, const RenderItem& item) const
+{
+	if (item.shader != first.shader ||
+		item.material != first.material ||
+		item.vertexArrayObject != first.vertexArrayObject ||
+		item.rangeCount != first.rangeCount)
+		return false;
+
+	// Objects left with different clusters after the culling can't share a draw
+	for (size_t range = 0; range < item.rangeCount; ++range)
+	{
+		if (m_rangeCounts[item.firstRange + range] != m_rangeCounts[first.firstRange + range] ||
+			m_rangeOffsets[item.firstRange + range] != m_rangeOffsets[first.firstRange + range])
+			return false;
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+
+void RenderQueue::buildDrawGroups()
+{
+	m_drawGroupList.clear();
+	m_instanceDataList.clear();
+	m_objectDataList.clear();
+
+	const GLuint itemCount = static_cast<GLuint>(m_sortedList.size());
+	GLuint position = 0;
+	while (position < itemCount)
+	{
+		const RenderItem& first = m_itemList[m_sortedList[position]];
+
+		// The matching items are adjacent, only the depth differs in their keys
+		GLuint end = position + 1;
+		if (m_instancedShaders.count(first.shader) != 0)
+		{
+			while (end < itemCount && canInstance(first, m_itemList[m_sortedList[end]]))
+				end++;
+		}
+
+		DrawGroup group;
+		group.position = position;
+		group.instanceCount = 0;
+		group.firstInstance = 0;
+
+		if (end - position > 1)
+		{
+			group.instanceCount = end - position;
+			group.firstInstance = static_cast<GLuint>(m_instanceDataList.size());
+			for (GLuint instance = position; instance < end; ++instance)
+			{
+				const RenderItem& item = m_itemList[m_sortedList[instance]];
+				InstanceData instanceData;
+				instanceData.modelMat = item.modelMat;
+				instanceData.normalMat = item.normalMat;
+				m_instanceDataList.push_back(instanceData);
+			}
+		}
+		else
+		{
+			// Per draw matrices in draw order
+			ObjectUniformData objectData;
+			objectData.model = first.modelMat;
+			objectData.normalMat = first.normalMat;
+			m_objectDataList.push_back(objectData);
+		}
+
+		m_drawGroupList.push_back(group);
+		position = end;
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+void RenderQueue::uploadInstances()
+{
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+
+	if (m_instanceDataList.size() > m_instanceCapacity)
+	{
+		// Grow the storage
+		m_instanceCapacity = m_instanceDataList.size();
+		glBufferData(GL_ARRAY_BUFFER, sizeof(InstanceData) * m_instanceCapacity, (const void*)m_instanceDataList.data(), GL_STREAM_DRAW);
+	}
+	else
+	{
+		// Orphan the previous storage so the update doesn't wait for the draws of the last flush
+		glBufferData(GL_ARRAY_BUFFER, sizeof(InstanceData) * m_instanceCapacity, nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(InstanceData) * m_instanceDataList.size(), (const void*)m_instanceDataList.data());
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// ----------------------------------------------------------------------------
+
+void RenderQueue::flush()
+{
+	if (m_itemList.empty())
+		return;
+
+	sortItems();
+	buildDrawGroups();
+
+	if (m_instanceDataList.empty() == false)
+		uploadInstances();
+
+	// Elements of the ring holding the object data of the current batch of draws
+	GLuint batchElement = 0;
+	GLuint batchStart = 0;
+	GLuint batchEnd = 0;
+
+	// Start from the state left by the code outside the queue
+	GLuint currentProgram = GLState::Instance().program();
+	GLuint currentVertexArray = GLState::Instance().vertexArray();
+	const MaterialTexturePBR* currentMaterial = nullptr;
+
+	// Next element of m_objectDataList
+	GLuint objectIndex = 0;
+
+	for (const DrawGroup& group : m_drawGroupList)
+	{
+		RenderItem& item = m_itemList[m_sortedList[group.position]];
+		Shader* shader = group.instanceCount != 0 ? m_instancedShaders[item.shader] : item.shader;
+
+		// Program
+		bool programChanged = shader->program() != currentProgram;
+		if (programChanged)
+		{
+			shader->useShader();
+			currentProgram = shader->program();
+			m_stats.programBinds++;
+		}
+		else
+			m_stats.programBindsSkipped++;
+
+		// Material textures
+		if (item.material != nullptr)
+			bindMaterial(*item.material, currentProgram, programChanged || item.material != currentMaterial);
+		currentMaterial = item.material;
+
+		// Vertex array
+		if (item.vertexArrayObject != currentVertexArray)
+		{
+			GLState::Instance().bindVertexArray(item.vertexArrayObject);
+			currentVertexArray = item.vertexArrayObject;
+			m_stats.vertexArrayBinds++;
+		}
+		else
+			m_stats.vertexArrayBindsSkipped++;
+
+		if (group.instanceCount != 0)
+		{
+			// Point the vertex array at the instances of the run
+			glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+			InstanceData::setupVertexInput(group.firstInstance * sizeof(InstanceData));
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+			for (size_t range = item.firstRange; range < item.firstRange + item.rangeCount; ++range)
+				glDrawElementsInstanced(GL_TRIANGLES, m_rangeCounts[range], GL_UNSIGNED_SHORT, m_rangeOffsets[range], (GLsizei)group.instanceCount);
+
+			m_stats.instancedDraws++;
+			m_stats.instancedItems += group.instanceCount;
+			continue;
+		}
+
+		// Per draw uniforms, written as many draws at a time as the ring holds
+		if (objectIndex == batchEnd)
+		{
+			GLuint count = std::min((GLuint)m_objectDataList.size() - objectIndex, m_objectUniforms.capacity());
+			batchElement = m_objectUniforms.write(&m_objectDataList[objectIndex], count);
+			batchStart = objectIndex;
+			batchEnd = objectIndex + count;
+		}
+		m_objectUniforms.bind(batchElement + objectIndex - batchStart);
+		objectIndex++;
+
+		// Draw
+		if (item.rangeCount == 1)
+			glDrawElements(GL_TRIANGLES, m_rangeCounts[item.firstRange], GL_UNSIGNED_SHORT, m_rangeOffsets[item.firstRange]);
+		else
+			glMultiDrawElements(GL_TRIANGLES, &m_rangeCounts[item.firstRange], GL_UNSIGNED_SHORT,
+				&m_rangeOffsets[item.firstRange], (GLsizei)item.rangeCount);
+	}
+
+	GLState::Instance().bindVertexArray(0);
+
+	m_itemList.clear();
+	m_keyList.clear();
+	m_rangeCounts.clear();
+	m_rangeOffsets.clear();
+}
+
+// ----------------------------------------------------------------------------
@@ -0,0 +1,249 @@
+#include "SceneBVH.h"
+
+#include <assert.h>
+
+// ----------------------------------------------------------------------------
+
+SceneBVH::SceneBVH()
+	: m_root(NULL_NODE), m_leafCount(0), m_testCount(0)
+{
+}
+
+// ----------------------------------------------------------------------------
+
+SceneBVH::~SceneBVH()
+{
+}
+
+// ----------------------------------------------------------------------------
+
+GLuint SceneBVH::allocateNode()
+{
+	if (m_freeNodeList.empty() == false)
+	{
+		GLuint node = m_freeNodeList.back();
+		m_freeNodeList.pop_back();
+		m_nodeList[node] = Node();
+		return node;
+	}
+
+	m_nodeList.push_back(Node());
+	return static_cast<GLuint>(m_nodeList.size() - 1);
+}
+
+// ----------------------------------------------------------------------------
+
+void SceneBVH::freeNode(GLuint node)
+{
+	m_freeNodeList.push_back(node);
+}
+
+// ----------------------------------------------------------------------------
+
+GLuint SceneBVH::insert(const BoundingBox& bounds, GLuint userData)
+{
+	GLuint leaf = allocateNode();
+	m_nodeList[leaf].bounds = bounds;
+	m_nodeList[leaf].userData = userData;
+
+	insertLeaf(leaf);
+	m_leafCount++;
+
+	return leaf;
+}
+
+// ----------------------------------------------------------------------------
+
+void SceneBVH::remove(GLuint leaf)
+{
+	assert(m_nodeList[leaf].isLeaf() && "Only leaves can be removed.");
+
+	removeLeaf(leaf);
+	freeNode(leaf);
+	m_leafCount--;
+}
+
+// ----------------------------------------------------------------------------
+
+void SceneBVH::refit(GLuint leaf, const BoundingBox& bounds)
+{
+	assert(m_nodeList[leaf].isLeaf() && "Only leaves can be refitted.");
+
+	if (m_nodeList[leaf].bounds == bounds)
+		return;
+
+	// Leaving the parent box would only grow the ancestors, place the leaf again instead
+	GLuint parent = m_nodeList[leaf].parent;
+	if (parent != NULL_NODE && m_nodeList[parent].bounds.contains(bounds) == false)
+	{
+		removeLeaf(leaf);
+		m_nodeList[leaf].bounds = bounds;
+		insertLeaf(leaf);
+		return;
+	}
+
+	m_nodeList[leaf].bounds = bounds;
+	refitAncestors(parent);
+}
+
+// ----------------------------------------------------------------------------
+
+void SceneBVH::insertLeaf(GLuint leaf)
+{
+	if (m_root == NULL_NODE)
+	{
+		m_root = leaf;
+		m_nodeList[leaf].parent = NULL_NODE;
+		return;
+	}
+
+	// Descend towards the cheapest sibling (surface area heuristic)
+	const BoundingBox leafBounds = m_nodeList[leaf].bounds;
+	GLuint sibling = m_root;
+	while (m_nodeList[sibling].isLeaf() == false)
+	{
+		const Node& node = m_nodeList[sibling];
+
+		float area = node.bounds.surfaceArea();
+		float combinedArea = BoundingBox::merge(node.bounds, leafBounds).surfaceArea();
+
+		// Cost of making a new parent for this node and the leaf
+		float cost = 2.0f * combinedArea;
+		// Minimum cost of pushing the leaf further down the tree
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		float childCost[2];
+		for (int index = 0; index < 2; ++index)
+		{
+			const Node& child = m_nodeList[node.children[index]];
+			float mergedArea = BoundingBox::merge(child.bounds, leafBounds).surfaceArea();
+			childCost[index] = child.isLeaf() ? mergedArea + inheritanceCost : mergedArea - child.bounds.surfaceArea() + inheritanceCost;
+		}
+
+		if (cost < childCost[0] && cost < childCost[1])
+			break;
+
+		sibling = childCost[0] < childCost[1] ? node.children[0] : node.children[1];
+	}
+
+	// New parent for the sibling and the leaf
+	GLuint oldParent = m_nodeList[sibling].parent;
+	GLuint newParent = allocateNode();
+	m_nodeList[newParent].parent = oldParent;
+	m_nodeList[newParent].bounds = BoundingBox::merge(leafBounds, m_nodeList[sibling].bounds);
+	m_nodeList[newParent].children[0] = sibling;
+	m_nodeList[newParent].children[1] = leaf;
+	m_nodeList[sibling].parent = newParent;
+	m_nodeList[leaf].parent = newParent;
+
+	if (oldParent == NULL_NODE)
+	{
+		m_root = newParent;
+		return;
+	}
+
+	Node& parent = m_nodeList[oldParent];
+	parent.children[parent.children[0] == sibling ? 0 : 1] = newParent;
+
+	refitAncestors(oldParent);
+}
+
+// ----------------------------------------------------------------------------
+
+void SceneBVH::removeLeaf(GLuint leaf)
+{
+	if (leaf == m_root)
+	{
+		m_root = NULL_NODE;
+		return;
+	}
+
+	// The sibling takes the place of the parent
+	GLuint parent = m_nodeList[leaf].parent;
+	GLuint grandParent = m_nodeList[parent].parent;
+	GLuint sibling = m_nodeList[parent].children[0] == leaf ? m_nodeList[parent].children[1] : m_nodeList[parent].children[0];
+
+	m_nodeList[sibling].parent = grandParent;
+	freeNode(parent);
+
+	if (grandParent == NULL_NODE)
+	{
+		m_root = sibling;
+		return;
+	}
+
+	Node& node = m_nodeList[grandParent];
+	node.children[node.children[0] == parent ? 0 : 1] = sibling;
+
+	refitAncestors(grandParent);
+}
+
+// ----------------------------------------------------------------------------
+
+void SceneBVH::refitAncestors(GLuint node)
+{
+	while (node != NULL_NODE)
+	{
+		Node& current = m_nodeList[node];
+		BoundingBox bounds = BoundingBox::merge(m_nodeList[current.children[0]].bounds, m_nodeList[current.children[1]].bounds);
+
+		// The boxes above are already correct
+		if (bounds == current.bounds)
+			break;
+
+		current.bounds = bounds;
+		node = current.parent;
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+void SceneBVH::collectLeaves(GLuint node, std::vector<GLuint>& visibleList) const
+{
+	const Node& current = m_nodeList[node];
+	if (current.isLeaf())
+	{
+		visibleList.push_back(current.userData);
+		return;
+	}
+
+	collectLeaves(current.children[0], visibleList);
+	collectLeaves(current.children[1], visibleList);
+}
+
+// ----------------------------------------------------------------------------
+
+void SceneBVH::cull(const Frustum& frustum, std::vector<GLuint>& visibleList)
+{
+	m_testCount = 0;
+
+	if (m_root == NULL_NODE)
+		return;
+
+	m_stack.clear();
+	m_stack.push_back(m_root);
+
+	while (m_stack.empty() == false)
+	{
+		GLuint node = m_stack.back();
+		m_stack.pop_back();
+
+		const Node& current = m_nodeList[node];
+
+		m_testCount++;
+		Frustum::Intersection intersection = frustum.testBox(current.bounds);
+		if (intersection == Frustum::Intersection::Outside)
+			continue;
+
+		if (intersection == Frustum::Intersection::Inside || current.isLeaf())
+		{
+			collectLeaves(node, visibleList);
+			continue;
+		}
+
+		m_stack.push_back(current.children[0]);
+		m_stack.push_back(current.children[1]);
+	}
+}
+
+// ----------------------------------------------------------------------------
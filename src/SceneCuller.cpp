@@ -0,0 +1,124 @@
+#include "SceneCuller.h"
+
+#include <assert.h>
+
+#include "DepthPyramid.h"
+
+// ----------------------------------------------------------------------------
+
+SceneCuller::SceneCuller()
+	: m_enabled(true), m_occlusionEnabled(true)
+{
+}
+
+// ----------------------------------------------------------------------------
+
+SceneCuller::~SceneCuller()
+{
+}
+
+// ----------------------------------------------------------------------------
+
+GLuint SceneCuller::add(TransformHandle transform, const BoundingBox& localBounds)
+{
+	GLuint proxy;
+	if (m_freeProxyList.empty() == false)
+	{
+		proxy = m_freeProxyList.back();
+		m_freeProxyList.pop_back();
+	}
+	else
+	{
+		proxy = static_cast<GLuint>(m_proxyList.size());
+		m_proxyList.push_back(Proxy());
+		m_visibleFlags.push_back(0);
+	}
+
+	Proxy& entry = m_proxyList[proxy];
+	entry.transform = transform;
+	entry.localBounds = localBounds;
+
+	// The world box is refit once the transform gets its first update
+	entry.leaf = m_bvh.insert(localBounds.transformed(TransformSystem::Instance().worldMat(transform)), proxy);
+
+	// Visible until the next cull
+	m_visibleFlags[proxy] = 1;
+
+	return proxy;
+}
+
+// ----------------------------------------------------------------------------
+
+void SceneCuller::remove(GLuint proxy)
+{
+	Proxy& entry = m_proxyList[proxy];
+	assert(entry.leaf != SceneBVH::NULL_NODE && "Culling proxy already removed.");
+
+	m_bvh.remove(entry.leaf);
+	entry = Proxy();
+	m_visibleFlags[proxy] = 0;
+
+	m_freeProxyList.push_back(proxy);
+}
+
+// ----------------------------------------------------------------------------
+
+void SceneCuller::update()
+{
+	const TransformSystem& transformSystem = TransformSystem::Instance();
+
+	for (const Proxy& entry : m_proxyList)
+	{
+		if (entry.leaf == SceneBVH::NULL_NODE || transformSystem.updated(entry.transform) == false)
+			continue;
+
+		m_bvh.refit(entry.leaf, entry.localBounds.transformed(transformSystem.worldMat(entry.transform)));
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+void SceneCuller::cull(const Frustum& frustum)
+{
+	// Clear the flags of the last frame
+	for (GLuint proxy : m_visibleList)
+		m_visibleFlags[proxy] = 0;
+	m_visibleList.clear();
+
+	m_bvh.cull(frustum, m_visibleList);
+
+	for (GLuint proxy : m_visibleList)
+		m_visibleFlags[proxy] = 1;
+
+	m_stats.objectCount = static_cast<GLuint>(m_bvh.leafCount());
+	m_stats.visibleObjectCount = static_cast<GLuint>(m_visibleList.size());
+	m_stats.testCount = static_cast<GLuint>(m_bvh.testCount());
+	m_stats.occludedObjectCount = 0;
+}
+
+// ----------------------------------------------------------------------------
+
+void SceneCuller::cullOccluded(const DepthPyramid& depthPyramid)
+{
+	if (depthPyramid.valid() == false)
+		return;
+
+	// Compact the visible list in place
+	size_t visibleCount = 0;
+	for (GLuint proxy : m_visibleList)
+	{
+		if (depthPyramid.isOccluded(m_bvh.bounds(m_proxyList[proxy].leaf)))
+		{
+			m_visibleFlags[proxy] = 0;
+			continue;
+		}
+
+		m_visibleList[visibleCount++] = proxy;
+	}
+
+	m_stats.occludedObjectCount = static_cast<GLuint>(m_visibleList.size() - visibleCount);
+	m_stats.visibleObjectCount = static_cast<GLuint>(visibleCount);
+	m_visibleList.resize(visibleCount);
+}
+
+// ----------------------------------------------------------------------------
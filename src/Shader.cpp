@@ -2,14 +2,34 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <assert.h>
 #include <vector>
+#include <chrono>
+#include <algorithm>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #include "GUI.h"
+#include "ProgramCache.h"
+
+// ----------------------------------------------------------------------------
+
+std::unordered_map<GLuint, Shader::UniformTable> Shader::s_uniformTables;
+std::unordered_map<std::string, Shader::SourceFile> Shader::s_sourceFiles;
+std::mutex Shader::s_sourceFileMutex;
 
 // ----------------------------------------------------------------------------
 
 Shader::Shader()
+	: m_program(0), m_pendingProgram(0), m_sourceHash(0), m_buildTime(0.0), m_linkPending(false)
+{
+}
+
+// ----------------------------------------------------------------------------
+
+Shader::Shader(const ShaderDefines& defines)
+	: m_defines(defines), m_program(0), m_pendingProgram(0), m_sourceHash(0), m_buildTime(0.0), m_linkPending(false)
 {
 }
 
@@ -21,30 +41,214 @@ Shader::~Shader()
 
 // ----------------------------------------------------------------------------
 
+bool Shader::parallelCompileSupported()
+{
+	static bool supported = false;
+	static bool initialized = false;
+
+	if (initialized == false)
+	{
+		initialized = true;
+
+		// Let the driver pick the number of compiler threads
+#ifdef GL_KHR_parallel_shader_compile
+		if (GLEW_KHR_parallel_shader_compile)
+		{
+			glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+			supported = true;
+		}
+		else
+#endif // GL_KHR_parallel_shader_compile
+		if (GLEW_ARB_parallel_shader_compile)
+		{
+			glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+			supported = true;
+		}
+	}
+
+	return supported;
+}
+
+// ----------------------------------------------------------------------------
+
 bool Shader::initialize()
 {
-	assert(m_shaderObjects.size() != 0 && "Failed to initialize shader. Use add shader to set shader stages.");
+	return submit() && finish();
+}
 
-	// Create shader program
-	m_program = glCreateProgram();
+// ----------------------------------------------------------------------------
 
-	// Attach shader objects
-	for (auto shaderObject : m_shaderObjects)
+bool Shader::addShader(ShaderType type, const std::string &path)
+{
+	// Read the shader code on a worker thread, the stages are compiled by submit
+	ShaderSource shaderSource;
+	shaderSource.type = type;
+	shaderSource.path = path;
+	shaderSource.pendingCode = readShaderAsync(path, m_defines);
+
+	m_shaderSources.push_back(std::move(shaderSource));
+
+	// Success
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool Shader::submit()
+{
+	assert(m_shaderSources.size() != 0 && "Failed to initialize shader. Use add shader to set shader stages.");
+
+	// A reload can restart a build that hasn't been finished
+	if (m_pendingProgram != 0)
+		discardPendingProgram();
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	// Wait for the files and build the key of the program in the binary cache
+	m_sourceHash = ProgramCache::hash("");
+	for (auto& shaderSource : m_shaderSources)
+	{
+		if (shaderSource.pendingCode.valid())
+		{
+			ShaderCode shaderCode = shaderSource.pendingCode.get();
+			shaderSource.code = std::move(shaderCode.code);
+			shaderSource.fileList = std::move(shaderCode.fileList);
+			shaderSource.modifiedTimeList = std::move(shaderCode.modifiedTimeList);
+		}
+		if (shaderSource.code.empty())
+		{
+			std::cout << "Shader " << shaderSource.path << " has no code.\n";
+			return false;
+		}
+
+		m_sourceHash = ProgramCache::hash(std::to_string(static_cast<int>(shaderSource.type)), m_sourceHash);
+		m_sourceHash = ProgramCache::hash(shaderSource.code, m_sourceHash);
+	}
+
+	// Create shader program, the current one stays in use until finish succeeds
+	m_pendingProgram = glCreateProgram();
+
+	ProgramCache& programCache = ProgramCache::Instance();
+	if (programCache.load(m_pendingProgram, m_sourceHash))
+		return true;
+
+	// Build from source in a new program, a rejected binary leaves the program unlinked
+	glDeleteProgram(m_pendingProgram);
+	m_pendingProgram = glCreateProgram();
+
+	for (auto& shaderSource : m_shaderSources)
 	{
+		// Create shader object
+		GLuint shaderObject = 0;
+		switch (shaderSource.type)
+		{
+			case ShaderType::VERTEX:
+				shaderObject = glCreateShader(GL_VERTEX_SHADER);
+				break;
+			case ShaderType::FRAGMENT:
+				shaderObject = glCreateShader(GL_FRAGMENT_SHADER);
+				break;
+			default:
+				std::cout << "Invalid shader type.";
+				discardPendingProgram();
+				return false;
+		}
+		m_shaderObjects.push_back(shaderObject);
+
+		// Start the compilation, the status is only read by finish
+		const char* shaderCode = shaderSource.code.c_str();
+		glShaderSource(shaderObject, 1, &shaderCode, nullptr);
+		glCompileShader(shaderObject);
+
 		// Attach shader to shader program
-		glAttachShader(m_program, shaderObject);
+		glAttachShader(m_pendingProgram, shaderObject);
 	}
 
-	// Link program
-	if (linkProgram() == false)
+	// Start the link, keeping the binary available for the program cache
+	if (programCache.supported())
+		glProgramParameteri(m_pendingProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(m_pendingProgram);
+	m_linkPending = true;
+
+	m_buildTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool Shader::isReady() const
+{
+	if (m_linkPending == false || parallelCompileSupported() == false)
+		return true;
+
+	// Without the extension any status query waits for the link
+	GLint completionStatus = GL_FALSE;
+	glGetProgramiv(m_pendingProgram, GL_COMPLETION_STATUS_ARB, &completionStatus);
+	return completionStatus == GL_TRUE;
+}
+
+// ----------------------------------------------------------------------------
+
+bool Shader::finish()
+{
+	// Nothing submitted or the submit failed
+	if (m_pendingProgram == 0)
 		return false;
 
+	if (m_linkPending)
+	{
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		m_linkPending = false;
+
+		// Report the compile errors of every stage before the link error
+		bool success = true;
+		for (size_t index = 0; index < m_shaderObjects.size(); ++index)
+		{
+			if (compileStatus(m_shaderObjects[index]) == false)
+			{
+				// The log refers to the included files by source string number
+				const ShaderSource& shaderSource = m_shaderSources[index];
+				std::cout << "Shader " << shaderSource.path << " failed to compile.\n";
+				for (size_t fileIndex = 1; fileIndex < shaderSource.fileList.size(); ++fileIndex)
+					std::cout << "  Source " << fileIndex << ": " << shaderSource.fileList[fileIndex] << "\n";
+				success = false;
+			}
+		}
+		success = success && linkStatus(m_pendingProgram);
+
+		// Delete shader objects
+		for (auto shaderObject : m_shaderObjects)
+			glDeleteShader(shaderObject);
+		m_shaderObjects.clear();
+
+		// Keep the previous program
+		if (success == false)
+		{
+			discardPendingProgram();
+			return false;
+		}
+
+		m_buildTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+		ProgramCache::Instance().store(m_pendingProgram, m_sourceHash, m_buildTime);
+	}
+
+	// Replace the previous program, if this is a reload
+	if (m_program != 0)
+	{
+		s_uniformTables.erase(m_program);
+		if (GLState::Instance().program() == m_program)
+			GLState::Instance().useProgram(0);
+		glDeleteProgram(m_program);
+	}
+	m_program = m_pendingProgram;
+	m_pendingProgram = 0;
+
 	// Initialize uniforms
+	reflectUniforms();
 	initializeUniforms();
-
-	// Delete shader objects
-	for (auto shaderObject : m_shaderObjects)
-		glDeleteShader(shaderObject);
+	initializeUniformBlocks();
 
 	// Sucess
 	return true;
@@ -52,34 +256,187 @@ bool Shader::initialize()
 
 // ----------------------------------------------------------------------------
 
-bool Shader::addShader(ShaderType type, const std::string &path)
+bool Shader::finishAll(const std::vector<Shader*>& shaderList)
 {
-	// Read shader code
-	std::string shaderCode;
-	bool res = readShaderFromFile(path, shaderCode);
-	if (res == false) return false;
-
-	// Create shader object
-	GLuint shaderObject;
-	switch (type)
+	std::vector<Shader*> pendingList = shaderList;
+	bool success = true;
+
+	while (pendingList.empty() == false)
+	{
+		// Finish the programs the driver is done with, in any order
+		auto ready = std::find_if(pendingList.begin(), pendingList.end(), [](const Shader* shader) { return shader->isReady(); });
+
+		// None done yet - wait on the oldest one
+		if (ready == pendingList.end())
+			ready = pendingList.begin();
+
+		success = (*ready)->finish() && success;
+		pendingList.erase(ready);
+	}
+
+	return success;
+}
+
+// ----------------------------------------------------------------------------
+
+bool Shader::sourcesModified() const
+{
+	// The included files count as well
+	for (const auto& shaderSource : m_shaderSources)
+	{
+		for (size_t fileIndex = 0; fileIndex < shaderSource.fileList.size(); ++fileIndex)
+		{
+			if (modifiedTime(shaderSource.fileList[fileIndex]) != shaderSource.modifiedTimeList[fileIndex])
+				return true;
+		}
+	}
+
+	return false;
+}
+
+// ----------------------------------------------------------------------------
+
+void Shader::reloadSources()
+{
+	for (auto& shaderSource : m_shaderSources)
+		shaderSource.pendingCode = readShaderAsync(shaderSource.path, m_defines);
+}
+
+// ----------------------------------------------------------------------------
+
+bool Shader::sourcesReady() const
+{
+	for (const auto& shaderSource : m_shaderSources)
 	{
-		case ShaderType::VERTEX:
-			shaderObject = glCreateShader(GL_VERTEX_SHADER);
-			break;
-		case ShaderType::FRAGMENT:
-			shaderObject = glCreateShader(GL_FRAGMENT_SHADER);
-			break;
-		default:
-			std::cout << "Invalid shader type.";
-			break;
+		if (shaderSource.pendingCode.valid() &&
+			shaderSource.pendingCode.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			return false;
 	}
-	m_shaderObjects.push_back(shaderObject);
 
-	// Compile shader
-	if (compileShader(shaderObject, shaderCode) == false)
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+
+void Shader::discardPendingProgram()
+{
+	for (auto shaderObject : m_shaderObjects)
+		glDeleteShader(shaderObject);
+	m_shaderObjects.clear();
+
+	glDeleteProgram(m_pendingProgram);
+	m_pendingProgram = 0;
+	m_linkPending = false;
+}
+
+// ----------------------------------------------------------------------------
+
+std::time_t Shader::modifiedTime(const std::string& path)
+{
+	struct stat fileStatus;
+	if (stat(path.c_str(), &fileStatus) != 0)
+		return 0;
+
+	return fileStatus.st_mtime;
+}
+
+// ----------------------------------------------------------------------------
+
+std::future<Shader::ShaderCode> Shader::readShaderAsync(const std::string& path, const ShaderDefines& defines)
+{
+	return std::async(std::launch::async, [path, defines]()
 	{
-		std::cout << "Shader " << path << " failed to compile.\n";
+		ShaderCode shaderCode;
+		if (readShaderFromFile(path, defines, shaderCode) == false)
+			shaderCode.code.clear();
+		return shaderCode;
+	});
+}
+
+// ----------------------------------------------------------------------------
+
+bool Shader::readShaderFromFile(const std::string& shaderFilePath, const ShaderDefines& defines, ShaderCode& outShaderCode)
+{
+	assert(shaderFilePath.length() && "Error. Empty shader path.");
+
+	// Init shader code
+	outShaderCode = ShaderCode();
+
+	return appendShaderFile(shaderFilePath, &defines, outShaderCode);
+}
+
+// ----------------------------------------------------------------------------
+
+bool Shader::appendShaderFile(const std::string& shaderFilePath, const ShaderDefines* defines, ShaderCode& outShaderCode)
+{
+	// Include guard - a file is only pasted once per stage
+	if (std::find(outShaderCode.fileList.begin(), outShaderCode.fileList.end(), shaderFilePath) != outShaderCode.fileList.end())
+		return true;
+
+	std::string fileCode;
+	std::time_t fileModifiedTime;
+	if (loadSourceFile(shaderFilePath, fileCode, fileModifiedTime) == false)
 		return false;
+
+	// The position in the file list is the GLSL source string number of the file
+	const int fileIndex = static_cast<int>(outShaderCode.fileList.size());
+	outShaderCode.fileList.push_back(shaderFilePath);
+	outShaderCode.modifiedTimeList.push_back(fileModifiedTime);
+
+	// Included paths are relative to the including file
+	size_t directoryEnd = shaderFilePath.find_last_of("/\\");
+	std::string directory = directoryEnd != std::string::npos ? shaderFilePath.substr(0, directoryEnd + 1) : "";
+
+	if (fileIndex != 0)
+		outShaderCode.code += "#line 1 " + std::to_string(fileIndex) + "\n";
+
+	std::istringstream fileStream(fileCode);
+	std::string line = "";
+	int lineNumber = 0;
+	// Only the main file gets the defines
+	bool definesInjected = defines == nullptr || defines->empty();
+	while (getline(fileStream, line))
+	{
+		lineNumber++;
+
+		// The defines have to follow the version directive
+		if (definesInjected == false && line.compare(0, 8, "#version") != 0)
+		{
+			outShaderCode.code += injectDefines(*defines, lineNumber, fileIndex);
+			definesInjected = true;
+		}
+
+		size_t directiveStart = line.find_first_not_of(" \t");
+		if (directiveStart != std::string::npos && line.compare(directiveStart, 8, "#include") == 0)
+		{
+			size_t nameStart = line.find('"', directiveStart);
+			size_t nameEnd = nameStart != std::string::npos ? line.find('"', nameStart + 1) : std::string::npos;
+			if (nameEnd == std::string::npos)
+			{
+				std::cout << "Invalid include in " << shaderFilePath << "(" << lineNumber << ")\n";
+				return false;
+			}
+
+			std::string includePath = directory + line.substr(nameStart + 1, nameEnd - nameStart - 1);
+			if (appendShaderFile(includePath, nullptr, outShaderCode) == false)
+			{
+				std::cout << "Included from " << shaderFilePath << "(" << lineNumber << ")\n";
+				return false;
+			}
+
+			// Back to the numbering of this file
+			outShaderCode.code += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+		}
+		else
+		{
+			outShaderCode.code += (line + "\n");
+		}
+
+		if (definesInjected == false)
+		{
+			outShaderCode.code += injectDefines(*defines, lineNumber + 1, fileIndex);
+			definesInjected = true;
+		}
 	}
 
 	// Success
@@ -88,13 +445,25 @@ bool Shader::addShader(ShaderType type, const std::string &path)
 
 // ----------------------------------------------------------------------------
 
-bool Shader::readShaderFromFile(const std::string& shaderFilePath, std::string& outShaderCode)
+bool Shader::loadSourceFile(const std::string& shaderFilePath, std::string& outFileCode, std::time_t& outModifiedTime)
 {
-	assert(shaderFilePath.length() && "Error. Empty shader path.");
+	// Taken before reading, so an edit made during the read is picked up by the next reload
+	outModifiedTime = modifiedTime(shaderFilePath);
+
+	// Shared files are read once for all the stages and variants including them
+	{
+		std::lock_guard<std::mutex> lock(s_sourceFileMutex);
+		auto sourceFile = s_sourceFiles.find(shaderFilePath);
+		if (sourceFile != s_sourceFiles.end() && sourceFile->second.modifiedTime == outModifiedTime)
+		{
+			outFileCode = sourceFile->second.code;
+			return true;
+		}
+	}
 
 	// Init shader code
-	outShaderCode = "";
-	// Open shader file and read content into outShaderCode
+	outFileCode = "";
+	// Open shader file and read content into outFileCode
 	std::ifstream shaderStream;
 	shaderStream.exceptions(std::ifstream::badbit);
 	try 
@@ -105,12 +474,12 @@ bool Shader::readShaderFromFile(const std::string& shaderFilePath, std::string&
 		{
 			std::string line = "";
 			while (getline(shaderStream, line))
-				outShaderCode += (line + "\n");
+				outFileCode += (line + "\n");
 			shaderStream.close();
 		}
 		else
 		{
-			std::cout << "Failed to open " << shaderFilePath;
+			std::cout << "Failed to open " << shaderFilePath << "\n";
 			return false;
 		}
 	}
@@ -120,19 +489,31 @@ bool Shader::readShaderFromFile(const std::string& shaderFilePath, std::string&
 		return false;
 	}
 
+	std::lock_guard<std::mutex> lock(s_sourceFileMutex);
+	s_sourceFiles[shaderFilePath] = { outModifiedTime, outFileCode };
+
 	// Success
 	return true;
 }
 
 // ----------------------------------------------------------------------------
 
-bool Shader::compileShader(GLuint shaderObject, const std::string& shaderCode)
+std::string Shader::injectDefines(const ShaderDefines& defines, int nextLineNumber, int fileIndex)
 {
-	// Set shader source and compile
-	const char* shaderSource = shaderCode.c_str();
-	glShaderSource(shaderObject, 1, &shaderSource, nullptr);
-	glCompileShader(shaderObject);
+	std::string defineCode;
+	for (const auto& define : defines)
+		defineCode += "#define " + define.first + " " + define.second + "\n";
+
+	// Keep the line numbers of the compile errors matching the file
+	defineCode += "#line " + std::to_string(nextLineNumber) + " " + std::to_string(fileIndex) + "\n";
+
+	return defineCode;
+}
+
+// ----------------------------------------------------------------------------
 
+bool Shader::compileStatus(GLuint shaderObject)
+{
 	// Error check
 	GLint compileStatus;
 	glGetShaderiv(shaderObject, GL_COMPILE_STATUS, &compileStatus);
@@ -151,19 +532,16 @@ bool Shader::compileShader(GLuint shaderObject, const std::string& shaderCode)
 
 // ----------------------------------------------------------------------------
 
-bool Shader::linkProgram()
+bool Shader::linkStatus(GLuint program)
 {
-	// Link program
-	glLinkProgram(m_program);
-
 	// Error check
 	GLint linkStatus;
-	glGetProgramiv(m_program, GL_LINK_STATUS, &linkStatus);
+	glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
 	if (linkStatus != GL_TRUE)
 	{
 		// Error
 		GLchar message[1024];
-		glGetProgramInfoLog(m_program, 1024, nullptr, message);
+		glGetProgramInfoLog(program, 1024, nullptr, message);
 		std::cout << "Shader link failed: " << message << "\n";
 		return false;
 	}
@@ -173,236 +551,131 @@ bool Shader::linkProgram()
 
 // ----------------------------------------------------------------------------
 
-void Shader::initializeUniforms()
+void Shader::initializeUniformBlocks()
 {
-	// Default values for shader uniforms
-	unsigned int shaderUniformCount = static_cast<int>(ShaderUniform::Count);
-	for (unsigned int index = 0; index < shaderUniformCount; ++index)
-		m_shaderUniforms[index] = -1;
-
-	// Initialize shader uniform locations
-	m_shaderUniforms[static_cast<int>(ShaderUniform::ModelMat)] = glGetUniformLocation(m_program, "model");
-	m_shaderUniforms[static_cast<int>(ShaderUniform::NormalMat)] = glGetUniformLocation(m_program, "normalMat");
-	m_shaderUniforms[static_cast<int>(ShaderUniform::ViewMat)] = glGetUniformLocation(m_program, "view");
-	m_shaderUniforms[static_cast<int>(ShaderUniform::ProjMat)] = glGetUniformLocation(m_program, "projection");
-	m_shaderUniforms[static_cast<int>(ShaderUniform::LightMat)] = glGetUniformLocation(m_program, "lightVP");
-	m_shaderUniforms[static_cast<int>(ShaderUniform::LightDir)] = glGetUniformLocation(m_program, "lightDir");
-	m_shaderUniforms[static_cast<int>(ShaderUniform::LightColor)] = glGetUniformLocation(m_program, "lightColor");
-	m_shaderUniforms[static_cast<int>(ShaderUniform::ViewPos)] = glGetUniformLocation(m_program, "viewPos");
-	m_shaderUniforms[static_cast<int>(ShaderUniform::Shininess)] = glGetUniformLocation(m_program, "shininess");
-	m_shaderUniforms[static_cast<int>(ShaderUniform::SpecularStrength)] = glGetUniformLocation(m_program, "specularStrength");
-	m_shaderUniforms[static_cast<int>(ShaderUniform::RenderedTexture)] = glGetUniformLocation(m_program, "renderedTexture");
-	m_shaderUniforms[static_cast<int>(ShaderUniform::DisplacementMapScale)] = glGetUniformLocation(m_program, "dispMapScale");
-	m_shaderUniforms[static_cast<int>(ShaderUniform::NormalMapScale)] = glGetUniformLocation(m_program, "normalMapScale");
-	m_shaderUniforms[static_cast<int>(ShaderUniform::Gamma)] = glGetUniformLocation(m_program, "gamma");
-	m_shaderUniforms[static_cast<int>(ShaderUniform::DisplayMode)] = glGetUniformLocation(m_program, "displayMode");
-	m_shaderUniforms[static_cast<int>(ShaderUniform::DebugVisualisationLightColor)] = glGetUniformLocation(m_program, "lightColor");
-	m_shaderUniforms[static_cast<int>(ShaderUniform::DebugVisualisationLightDirection)] = glGetUniformLocation(m_program, "lightDir");
-	m_shaderUniforms[static_cast<int>(ShaderUniform::DebugVisualisationObjectColor)] = glGetUniformLocation(m_program, "objectColor");
-	m_shaderUniforms[static_cast<int>(ShaderUniform::ToneMapper)] = glGetUniformLocation(m_program, "toneMapper");
-	m_shaderUniforms[static_cast<int>(ShaderUniform::Exposure)] = glGetUniformLocation(m_program, "exposure");
-	m_shaderUniforms[static_cast<int>(ShaderUniform::GammaHDR)] = glGetUniformLocation(m_program, "gammaHDR");
-	m_shaderUniforms[static_cast<int>(ShaderUniform::ExposureBias)] = glGetUniformLocation(m_program, "exposureBias");
-
-	m_shaderUniforms[static_cast<int>(ShaderUniform::DiffuseTexture)] = glGetUniformLocation(m_program, "diffuseTexture");
-	m_shaderUniforms[static_cast<int>(ShaderUniform::NormalTexture)] = glGetUniformLocation(m_program, "normalTexture");
-	m_shaderUniforms[static_cast<int>(ShaderUniform::SpecularTexture)] = glGetUniformLocation(m_program, "specularTexture");
-	m_shaderUniforms[static_cast<int>(ShaderUniform::DisplacementTexture)] = glGetUniformLocation(m_program, "displacementTexture");
-	m_shaderUniforms[static_cast<int>(ShaderUniform::DepthTexture)] = glGetUniformLocation(m_program, "depthTexture");
-
-	m_shaderUniforms[static_cast<int>(ShaderUniform::TextureOffset)] = glGetUniformLocation(m_program, "textureOffset");
-	m_shaderUniforms[static_cast<int>(ShaderUniform::TextureTile)] = glGetUniformLocation(m_program, "textureTile");
-
-	// Initialize dir lights uniform locations
-	for (unsigned int dirLightIndex = 0; dirLightIndex < MAX_DIR_LIGHTS; ++dirLightIndex)
+	// Connect the shared blocks used by the program to their binding points
+	unsigned int uniformBlockCount = static_cast<int>(UniformBlock::Count);
+	for (unsigned int index = 0; index < uniformBlockCount; ++index)
 	{
-		// Get the location for the current light uniform
-		std::string sLightIndex = std::to_string(dirLightIndex);
-		std::string sTemp = "dirLight[" + sLightIndex + "].";
-		std::string sShaderLocation;
-
-		sShaderLocation = sTemp + "direction";
-		m_dirLightsUniforms[dirLightIndex][static_cast<int>(DirLightUniform::Direction)] = glGetUniformLocation(m_program, sShaderLocation.c_str());
-		sShaderLocation = sTemp + "color";
-		m_dirLightsUniforms[dirLightIndex][static_cast<int>(DirLightUniform::Color)] = glGetUniformLocation(m_program, sShaderLocation.c_str());
-		sShaderLocation = sTemp + "ambientComp";
-		m_dirLightsUniforms[dirLightIndex][static_cast<int>(DirLightUniform::ColorAmbientComp)] = glGetUniformLocation(m_program, sShaderLocation.c_str());
-		sShaderLocation = sTemp + "diffuseComp";
-		m_dirLightsUniforms[dirLightIndex][static_cast<int>(DirLightUniform::ColorDiffuseComp)] = glGetUniformLocation(m_program, sShaderLocation.c_str());
-		sShaderLocation = sTemp + "specularComp";
-		m_dirLightsUniforms[dirLightIndex][static_cast<int>(DirLightUniform::ColorSpecularComp)] = glGetUniformLocation(m_program, sShaderLocation.c_str());
-		sShaderLocation = sTemp + "enabled";
-		m_dirLightsUniforms[dirLightIndex][static_cast<int>(DirLightUniform::Enabled)] = glGetUniformLocation(m_program, sShaderLocation.c_str());
+		GLuint blockIndex = glGetUniformBlockIndex(m_program, UniformBuffer::blockName(static_cast<UniformBlock>(index)));
+		if (blockIndex != GL_INVALID_INDEX)
+			glUniformBlockBinding(m_program, blockIndex, index);
 	}
+}
 
-	// Initialize point lights uniform locations
-	for (unsigned int pointLightIndex = 0; pointLightIndex < MAX_POINT_LIGHTS; ++pointLightIndex)
-	{
-		// Get the location for the current light uniform
-		std::string sLightIndex = std::to_string(pointLightIndex);
-		std::string sTemp = "pointLight[" + sLightIndex + "].";
-		std::string sShaderLocation;
-
-		sShaderLocation = sTemp + "position";
-		m_pointLightsUniforms[pointLightIndex][static_cast<int>(PointLightUniform::Position)] = glGetUniformLocation(m_program, sShaderLocation.c_str());
-		sShaderLocation = sTemp + "attenuation";
-		m_pointLightsUniforms[pointLightIndex][static_cast<int>(PointLightUniform::Attenuation)] = glGetUniformLocation(m_program, sShaderLocation.c_str());
-		sShaderLocation = sTemp + "color";
-		m_pointLightsUniforms[pointLightIndex][static_cast<int>(PointLightUniform::Color)] = glGetUniformLocation(m_program, sShaderLocation.c_str());
-		sShaderLocation = sTemp + "ambientComp";
-		m_pointLightsUniforms[pointLightIndex][static_cast<int>(PointLightUniform::ColorAmbientComp)] = glGetUniformLocation(m_program, sShaderLocation.c_str());
-		sShaderLocation = sTemp + "diffuseComp";
-		m_pointLightsUniforms[pointLightIndex][static_cast<int>(PointLightUniform::ColorDiffuseComp)] = glGetUniformLocation(m_program, sShaderLocation.c_str());
-		sShaderLocation = sTemp + "specularComp";
-		m_pointLightsUniforms[pointLightIndex][static_cast<int>(PointLightUniform::ColorSpecularComp)] = glGetUniformLocation(m_program, sShaderLocation.c_str());
-		sShaderLocation = sTemp + "enabled";
-		m_pointLightsUniforms[pointLightIndex][static_cast<int>(PointLightUniform::Enabled)] = glGetUniformLocation(m_program, sShaderLocation.c_str());
-	}
-// ---------------------------------------------------------------------------// ---------------------------------------------------------------------------
-	// Initialize spot lights uniform locations
-	for (unsigned spotLightIndex = 0; spotLightIndex < MAX_SPOT_LIGHTS; ++spotLightIndex)
-	{
-		// Get the location for the current light uniform
-		std::string sLightIndex = std::to_string(spotLightIndex);
-		std::string sTemp = "spotLight[" + sLightIndex + "].";
-		std::string sShaderLocation;
-
-		sShaderLocation = sTemp + "position";
-		m_spotLightsUniforms[spotLightIndex][static_cast<int>(SpotLightUniform::Position)] = glGetUniformLocation(m_program, sShaderLocation.c_str());
-		sShaderLocation = sTemp + "color";
-		m_spotLightsUniforms[spotLightIndex][static_cast<int>(SpotLightUniform::Color)] = glGetUniformLocation(m_program, sShaderLocation.c_str());
-		sShaderLocation = sTemp + "ambientComp";
-		m_spotLightsUniforms[spotLightIndex][static_cast<int>(SpotLightUniform::ColorAmbientComp)] = glGetUniformLocation(m_program, sShaderLocation.c_str());
-		sShaderLocation = sTemp + "diffuseComp";
-		m_spotLightsUniforms[spotLightIndex][static_cast<int>(SpotLightUniform::ColorDiffuseComp)] = glGetUniformLocation(m_program, sShaderLocation.c_str());
-		sShaderLocation = sTemp + "specularComp";
-		m_spotLightsUniforms[spotLightIndex][static_cast<int>(SpotLightUniform::ColorSpecularComp)] = glGetUniformLocation(m_program, sShaderLocation.c_str());
-		sShaderLocation = sTemp + "dirrection";
-		m_spotLightsUniforms[spotLightIndex][static_cast<int>(SpotLightUniform::Direction)] = glGetUniformLocation(m_program, sShaderLocation.c_str());
-		sShaderLocation = sTemp + "exponent";
-		m_spotLightsUniforms[spotLightIndex][static_cast<int>(SpotLightUniform::Exponent)] = glGetUniformLocation(m_program, sShaderLocation.c_str());
-		sShaderLocation = sTemp + "cutoff";
-		m_spotLightsUniforms[spotLightIndex][static_cast<int>(SpotLightUniform::Cutoff)] = glGetUniformLocation(m_program, sShaderLocation.c_str());
-		sShaderLocation = sTemp + "cosCutoff";
-		m_spotLightsUniforms[spotLightIndex][static_cast<int>(SpotLightUniform::CosCutoff)] = glGetUniformLocation(m_program, sShaderLocation.c_str());
-		sShaderLocation = sTemp + "enabled";
-		m_spotLightsUniforms[spotLightIndex][static_cast<int>(SpotLightUniform::Enabled)] = glGetUniformLocation(m_program, sShaderLocation.c_str());
-	}
+// ----------------------------------------------------------------------------
 
-	// Initialize material uniform locations
-	m_materialUniforms[static_cast<int>(MaterialUniform::AmbientComp)] = glGetUniformLocation(m_program, "material.ambientComp");
-	m_materialUniforms[static_cast<int>(MaterialUniform::DiffuseComp)] = glGetUniformLocation(m_program, "material.diffuseComp");
-	m_materialUniforms[static_cast<int>(MaterialUniform::SpecularComp)] = glGetUniformLocation(m_program, "material.specularComp");
-	m_materialUniforms[static_cast<int>(MaterialUniform::Shineness)] = glGetUniformLocation(m_program, "material.shineness");
+GLint Shader::uniformLocation(GLuint program, const std::string& name)
+{
+	auto table = s_uniformTables.find(program);
+	assert(table != s_uniformTables.end() && "Uniforms of the program not reflected.");
 
-	// Initialize PBR color material uniform locations
-	m_materialPBRUniforms[static_cast<int>(MaterialPBRUniform::Color)] = glGetUniformLocation(m_program, "material.color");
-	m_materialPBRUniforms[static_cast<int>(MaterialPBRUniform::Metallic)] = glGetUniformLocation(m_program, "material.metallic");
-	m_materialPBRUniforms[static_cast<int>(MaterialPBRUniform::Roughness)] = glGetUniformLocation(m_program, "material.roughness");
-	m_materialPBRUniforms[static_cast<int>(MaterialPBRUniform::AmbientOcclusion)] = glGetUniformLocation(m_program, "material.ao");
+	auto uniform = table->second.find(name);
+	return uniform != table->second.end() ? uniform->second : -1;
 }
 
 // ----------------------------------------------------------------------------
 
-// Update lights
-void Shader::updatePointLights()
+void Shader::reflectUniforms()
 {
-	auto& lightData = LightData::getInstance();
-	auto pointLightCount = lightData.pointLightCount();
+	UniformTable& table = s_uniformTables[m_program];
+	table.clear();
 
-	for (auto pointLightIndex = 0; pointLightIndex < pointLightCount; ++pointLightIndex)
-	{
-		auto &currentPointLight = lightData.pointLight(pointLightIndex);
-		setPointLightScalar<float>(PointLightUniform::Enabled, pointLightIndex, currentPointLight.enabled);
+	GLint uniformCount = 0;
+	GLint maxNameLength = 0;
+	glGetProgramiv(m_program, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(m_program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
 
-		// Skip if not enabled
-		if (currentPointLight.enabled == false)
-			continue;
-			
-		// Set color
-		if (currentPointLight.pbrLight)
-		{
-			setPointLight<glm::vec3>(PointLightUniform::Color, pointLightIndex, currentPointLight.color);
-		}
-		else
-		{
-			setPointLight<glm::vec3>(PointLightUniform::ColorAmbientComp, pointLightIndex, currentPointLight.ambientComp);
-			setPointLight<glm::vec3>(PointLightUniform::ColorSpecularComp, pointLightIndex, currentPointLight.specularComp);
-			setPointLight<glm::vec3>(PointLightUniform::ColorDiffuseComp, pointLightIndex, currentPointLight.diffuseComp);
-		}
+	std::vector<GLchar> nameBuffer(maxNameLength + 1);
+	for (GLint uniformIndex = 0; uniformIndex < uniformCount; ++uniformIndex)
+	{
+		GLsizei nameLength = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(m_program, uniformIndex, (GLsizei)nameBuffer.size(), &nameLength, &size, &type, nameBuffer.data());
 
-		// Set properties
-		setPointLight<glm::vec3>(PointLightUniform::Position, pointLightIndex, currentPointLight.position);
-		setPointLight<glm::vec3>(PointLightUniform::Attenuation, pointLightIndex, currentPointLight.attenuation);
-	}
-}
+		std::string name(nameBuffer.data(), nameLength);
 
-void Shader::updateDirectionalLights()
-{
-	auto& lightData = LightData::getInstance();
-	auto dirLightCount = lightData.directionalLightCount();
+		// Uniform block members have no location
+		GLint location = glGetUniformLocation(m_program, name.c_str());
+		if (location == -1)
+			continue;
 
-	for (auto dirLightIndex = 0; dirLightIndex < dirLightCount; ++dirLightIndex)
-	{
-		auto &currentDirLight = lightData.directionalLight(dirLightIndex);
-		setDirLightScalar<float>(DirLightUniform::Enabled, dirLightIndex, currentDirLight.enabled);
+		table[name] = location;
 
-		// Skip if not enabled
-		if (currentDirLight.enabled == false)
-			continue;
-		
-		// Set color
-		if (currentDirLight.pbrLight)
-		{
-			setDirLight<glm::vec3>(DirLightUniform::Color, dirLightIndex, currentDirLight.color);
-		}
-		else
+		// Arrays are reported once as name[0], add the plain name and the other elements
+		const std::string arraySuffix = "[0]";
+		if (name.size() > arraySuffix.size() && name.compare(name.size() - arraySuffix.size(), arraySuffix.size(), arraySuffix) == 0)
 		{
-			setDirLight<glm::vec3>(DirLightUniform::ColorAmbientComp, dirLightIndex, currentDirLight.ambientComp);
-			setDirLight<glm::vec3>(DirLightUniform::ColorSpecularComp, dirLightIndex, currentDirLight.specularComp);
-			setDirLight<glm::vec3>(DirLightUniform::ColorDiffuseComp, dirLightIndex, currentDirLight.diffuseComp);
+			std::string arrayName = name.substr(0, name.size() - arraySuffix.size());
+			table[arrayName] = location;
+
+			for (GLint element = 1; element < size; ++element)
+			{
+				std::string elementName = arrayName + "[" + std::to_string(element) + "]";
+				table[elementName] = glGetUniformLocation(m_program, elementName.c_str());
+			}
 		}
-
-		// Set properties
-		setDirLight<glm::vec3>(DirLightUniform::Direction, dirLightIndex, currentDirLight.direction);
 	}
 }
 
-void Shader::updateSpotLights()
+// ----------------------------------------------------------------------------
+
+void Shader::initializeUniforms()
 {
-	auto& lightData = LightData::getInstance();
-	auto spotLightCount = lightData.spotLightCount();
+	// Default values for shader uniforms
+	unsigned int shaderUniformCount = static_cast<int>(ShaderUniform::Count);
+	for (unsigned int index = 0; index < shaderUniformCount; ++index)
+		m_shaderUniforms[index] = -1;
 
-	for (auto spotLightIndex = 0; spotLightIndex < spotLightCount; ++spotLightIndex)
-	{
-		auto &currentSpotLight = lightData.spotLight(spotLightIndex);
-		setSpotLightScalar<float>(SpotLightUniform::Enabled, spotLightIndex, currentSpotLight.enabled);
+	// Initialize shader uniform locations
+	m_shaderUniforms[static_cast<int>(ShaderUniform::ModelMat)] = uniformLocation("model");
+	m_shaderUniforms[static_cast<int>(ShaderUniform::NormalMat)] = uniformLocation("normalMat");
+	m_shaderUniforms[static_cast<int>(ShaderUniform::ViewMat)] = uniformLocation("view");
+	m_shaderUniforms[static_cast<int>(ShaderUniform::ProjMat)] = uniformLocation("projection");
+	m_shaderUniforms[static_cast<int>(ShaderUniform::LightMat)] = uniformLocation("lightVP");
+	m_shaderUniforms[static_cast<int>(ShaderUniform::LightDir)] = uniformLocation("lightDir");
+	m_shaderUniforms[static_cast<int>(ShaderUniform::LightColor)] = uniformLocation("lightColor");
+	m_shaderUniforms[static_cast<int>(ShaderUniform::ViewPos)] = uniformLocation("viewPos");
+	m_shaderUniforms[static_cast<int>(ShaderUniform::Shininess)] = uniformLocation("shininess");
+	m_shaderUniforms[static_cast<int>(ShaderUniform::SpecularStrength)] = uniformLocation("specularStrength");
+	m_shaderUniforms[static_cast<int>(ShaderUniform::RenderedTexture)] = uniformLocation("renderedTexture");
+	m_shaderUniforms[static_cast<int>(ShaderUniform::DisplacementMapScale)] = uniformLocation("dispMapScale");
+	m_shaderUniforms[static_cast<int>(ShaderUniform::NormalMapScale)] = uniformLocation("normalMapScale");
+	m_shaderUniforms[static_cast<int>(ShaderUniform::Gamma)] = uniformLocation("gamma");
+	m_shaderUniforms[static_cast<int>(ShaderUniform::DisplayMode)] = uniformLocation("displayMode");
+	m_shaderUniforms[static_cast<int>(ShaderUniform::DebugVisualisationLightColor)] = uniformLocation("lightColor");
+	m_shaderUniforms[static_cast<int>(ShaderUniform::DebugVisualisationLightDirection)] = uniformLocation("lightDir");
+	m_shaderUniforms[static_cast<int>(ShaderUniform::DebugVisualisationObjectColor)] = uniformLocation("objectColor");
+	m_shaderUniforms[static_cast<int>(ShaderUniform::ToneMapper)] = uniformLocation("toneMapper");
+	m_shaderUniforms[static_cast<int>(ShaderUniform::Exposure)] = uniformLocation("exposure");
+	m_shaderUniforms[static_cast<int>(ShaderUniform::GammaHDR)] = uniformLocation("gammaHDR");
+	m_shaderUniforms[static_cast<int>(ShaderUniform::ExposureBias)] = uniformLocation("exposureBias");
+
+	m_shaderUniforms[static_cast<int>(ShaderUniform::DiffuseTexture)] = uniformLocation("diffuseTexture");
+	m_shaderUniforms[static_cast<int>(ShaderUniform::NormalTexture)] = uniformLocation("normalTexture");
+	m_shaderUniforms[static_cast<int>(ShaderUniform::SpecularTexture)] = uniformLocation("specularTexture");
+	m_shaderUniforms[static_cast<int>(ShaderUniform::DisplacementTexture)] = uniformLocation("displacementTexture");
+	m_shaderUniforms[static_cast<int>(ShaderUniform::DepthTexture)] = uniformLocation("depthTexture");
+
+	m_shaderUniforms[static_cast<int>(ShaderUniform::TextureOffset)] = uniformLocation("textureOffset");
+	m_shaderUniforms[static_cast<int>(ShaderUniform::TextureTile)] = uniformLocation("textureTile");
 
-		// Skip if not enabled
-		if (currentSpotLight.enabled == false)
-			continue;
+	// Initialize material uniform locations
+	m_materialUniforms[static_cast<int>(MaterialUniform::AmbientComp)] = uniformLocation("material.ambientComp");
+	m_materialUniforms[static_cast<int>(MaterialUniform::DiffuseComp)] = uniformLocation("material.diffuseComp");
+	m_materialUniforms[static_cast<int>(MaterialUniform::SpecularComp)] = uniformLocation("material.specularComp");
+	m_materialUniforms[static_cast<int>(MaterialUniform::Shineness)] = uniformLocation("material.shineness");
 
-		// Set color
-		if (currentSpotLight.pbrLight)
-		{
-			setSpotLight<glm::vec3>(SpotLightUniform::Color, spotLightIndex, currentSpotLight.color);
-		}
-		else
-		{
-			setSpotLight<glm::vec3>(SpotLightUniform::ColorAmbientComp, spotLightIndex, currentSpotLight.ambientComp);
-			setSpotLight<glm::vec3>(SpotLightUniform::ColorDiffuseComp, spotLightIndex, currentSpotLight.diffuseComp);
-			setSpotLight<glm::vec3>(SpotLightUniform::ColorSpecularComp, spotLightIndex, currentSpotLight.specularComp);
-		}
-		
-		// Set properties
-		setSpotLight<glm::vec3>(SpotLightUniform::Position, spotLightIndex, currentSpotLight.position);
-		setSpotLight<glm::vec3>(SpotLightUniform::Direction, spotLightIndex, currentSpotLight.direction);
-		setSpotLightScalar<float>(SpotLightUniform::CosCutoff, spotLightIndex, currentSpotLight.coscutoff);
-		setSpotLightScalar<float>(SpotLightUniform::Cutoff, spotLightIndex, currentSpotLight.cutoff);
-		setSpotLightScalar<float>(SpotLightUniform::Exponent, spotLightIndex, currentSpotLight.exponent);
-	}
+	// Initialize PBR color material uniform locations
+	m_materialPBRUniforms[static_cast<int>(MaterialPBRUniform::Color)] = uniformLocation("material.color");
+	m_materialPBRUniforms[static_cast<int>(MaterialPBRUniform::Metallic)] = uniformLocation("material.metallic");
+	m_materialPBRUniforms[static_cast<int>(MaterialPBRUniform::Roughness)] = uniformLocation("material.roughness");
+	m_materialPBRUniforms[static_cast<int>(MaterialPBRUniform::AmbientOcclusion)] = uniformLocation("material.ao");
 }
 
+// ----------------------------------------------------------------------------
+
 void Shader::updateDebugLight()
 {
 	auto& lightData = LightData::getInstance();
@@ -0,0 +1,87 @@
+#include "ShaderVariants.h"
+
+#include <iostream>
+#include <assert.h>
+
+#include "ShaderWatcher.h"
+
+// ----------------------------------------------------------------------------
+
+ShaderVariants::ShaderVariants()
+	: m_lastVariant(nullptr)
+{
+}
+
+// ----------------------------------------------------------------------------
+
+ShaderVariants::~ShaderVariants()
+{
+}
+
+// ----------------------------------------------------------------------------
+
+void ShaderVariants::addShader(Shader::ShaderType type, const std::string& path)
+{
+	m_stageList.push_back({ type, path });
+}
+
+// ----------------------------------------------------------------------------
+
+std::string ShaderVariants::variantKey(const ShaderDefines& defines)
+{
+	// The definitions are ordered, equal sets give equal keys
+	std::string key;
+	for (const auto& define : defines)
+		key += define.first + "=" + define.second + ";";
+
+	return key;
+}
+
+// ----------------------------------------------------------------------------
+
+Shader* ShaderVariants::prepare(const ShaderDefines& defines)
+{
+	assert(m_stageList.size() != 0 && "Shader variant without stages.");
+
+	std::unique_ptr<Shader>& shader = m_variants[variantKey(defines)];
+	if (shader != nullptr)
+		return shader.get();
+
+	shader = std::make_unique<Shader>(defines);
+	for (const Stage& stage : m_stageList)
+		shader->addShader(stage.type, stage.path);
+
+	if (shader->submit() == false)
+		std::cout << "Failed to submit shader variant " << variantKey(defines) << "\n";
+
+	// Variants follow the edits of the shared files
+	ShaderWatcher::Instance().watch(shader.get());
+
+	return shader.get();
+}
+
+// ----------------------------------------------------------------------------
+
+Shader& ShaderVariants::variant(const ShaderDefines& defines)
+{
+	Shader& shader = *prepare(defines);
+
+	// First build of the variant in flight
+	if (shader.program() == 0 && shader.pending())
+	{
+		if (m_lastVariant != nullptr && shader.isReady() == false)
+			return *m_lastVariant;
+
+		if (shader.finish() == false)
+			std::cout << "Failed to build shader variant " << variantKey(defines) << "\n";
+	}
+
+	// Keep drawing with the previous variant if this one didn't build
+	if (shader.program() == 0 && m_lastVariant != nullptr)
+		return *m_lastVariant;
+
+	m_lastVariant = &shader;
+	return shader;
+}
+
+// ----------------------------------------------------------------------------
@@ -0,0 +1,95 @@
+#include "ShaderWatcher.h"
+
+#include <iostream>
+
+#include "Shader.h"
+
+// ----------------------------------------------------------------------------
+
+ShaderWatcher::ShaderWatcher()
+	: m_lastPollTime(std::chrono::steady_clock::now())
+{
+}
+
+// ----------------------------------------------------------------------------
+
+ShaderWatcher::~ShaderWatcher()
+{
+}
+
+// ----------------------------------------------------------------------------
+
+void ShaderWatcher::watch(Shader* shader)
+{
+	m_shaderList.push_back({ shader, ReloadState::Idle });
+}
+
+// ----------------------------------------------------------------------------
+
+void ShaderWatcher::watch(const std::vector<Shader*>& shaderList)
+{
+	for (Shader* shader : shaderList)
+		watch(shader);
+}
+
+// ----------------------------------------------------------------------------
+
+void ShaderWatcher::update()
+{
+	// Only check the files every few frames
+	auto currentTime = std::chrono::steady_clock::now();
+	bool poll = currentTime - m_lastPollTime >= std::chrono::milliseconds(POLL_INTERVAL_MS);
+	if (poll)
+		m_lastPollTime = currentTime;
+
+	// Each step only runs once it won't block the frame
+	for (WatchedShader& watchedShader : m_shaderList)
+	{
+		Shader* shader = watchedShader.shader;
+
+		switch (watchedShader.state)
+		{
+			case ReloadState::Idle:
+				if (poll && shader->sourcesModified())
+				{
+					shader->reloadSources();
+					watchedShader.state = ReloadState::Reading;
+				}
+				break;
+			case ReloadState::Reading:
+				if (shader->sourcesReady())
+				{
+					if (shader->submit())
+					{
+						watchedShader.state = ReloadState::Linking;
+					}
+					else
+					{
+						m_stats.failedCount++;
+						watchedShader.state = ReloadState::Idle;
+					}
+				}
+				break;
+			case ReloadState::Linking:
+				if (shader->isReady())
+				{
+					if (shader->finish())
+					{
+						std::cout << "Shader program reloaded.\n";
+						m_stats.reloadCount++;
+					}
+					else
+					{
+						std::cout << "Shader reload failed, keeping the previous program.\n";
+						m_stats.failedCount++;
+					}
+					watchedShader.state = ReloadState::Idle;
+				}
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------
@@ -4,6 +4,9 @@
 #include <cassert>
 #include <SOIL/SOIL.h>
 
+#include "GLState.h"
+#include "Shader.h"
+
 // ----------------------------------------------------------------------------
 
 Texture2D::Texture2D(GLuint textureHandler, TextureType textureType)
@@ -31,20 +34,26 @@ void Texture2D::init()
 // ----------------------------------------------------------------------------
 
 void Texture2D::bind(GLuint program)
+{
+	// Set the texture unit
+	GLState::Instance().bindTexture(textureUnit(), GL_TEXTURE_2D, m_uiTexture);
+
+	setSamplerUniform(program);
+}
+
+// ----------------------------------------------------------------------------
+
+void Texture2D::setSamplerUniform(GLuint program) const
 {
 	unsigned int textureType = static_cast<int>(m_textureType);
 	unsigned int textureTypeCount = static_cast<int>(TextureType::Count);
 	assert( textureType >= 0 && textureType <= textureTypeCount && textureType <= 32 &&
 			"Invalid texture type specified.");
 
-	// Set the texture unit
-	glActiveTexture( GLenum(GL_TEXTURE0 + textureType) );
-	glBindTexture( GL_TEXTURE_2D, m_uiTexture );
-
 #define SETUNIFORM(locationName, textureChoise) \
 	case textureChoise: \
 	{ \
-		int location = glGetUniformLocation(program, locationName); \
+		int location = Shader::uniformLocation(program, locationName); \
 		glUniform1i(location, textureType); \
 		break; \
 	}
@@ -73,8 +82,7 @@ void Texture2D::bind(GLint location, GLuint textureHandle, GLuint textureUnit)
 {
 	assert(location != -1 && "Invalid uniform location.");
 
-	glActiveTexture(GLenum(GL_TEXTURE0 + textureUnit));
-	glBindTexture(GL_TEXTURE_2D, textureHandle);
+	GLState::Instance().bindTexture(textureUnit, GL_TEXTURE_2D, textureHandle);
 	glUniform1i(location, textureUnit);
 }
 
@@ -104,7 +112,7 @@ void Texture2D::initOpenGLTexture(unsigned char *imageData)
 	// Create the texture handle
 	glGenTextures(1, &m_uiTexture);
 	// Bind the current texture to the texture2D target
-	glBindTexture(GL_TEXTURE_2D, m_uiTexture);
+	GLState::Instance().bindTexture(GL_TEXTURE_2D, m_uiTexture);
 
 	// Set texture parameters
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -154,7 +162,7 @@ void Texture2D::initOpenGLTexture(unsigned char *imageData)
 	// --------------------------------------------------------------------------
 
 	// Unbind the current texture
-	glBindTexture(GL_TEXTURE_2D, 0);
+	GLState::Instance().bindTexture(GL_TEXTURE_2D, 0);
 
 	glCheckError();
 }
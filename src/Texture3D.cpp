@@ -2,6 +2,9 @@
 
 #include <SOIL/SOIL.h>
 
+#include "GLState.h"
+#include "Shader.h"
+
 // ----------------------------------------------------------------------------
 // Constructor/Destructor
 
@@ -22,7 +25,7 @@ void Texture3D::init()
 
 	// Create cube map and bind it
 	glGenTextures(1, &m_uiTexture);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, m_uiTexture);
+	GLState::Instance().bindTexture(GL_TEXTURE_CUBE_MAP, m_uiTexture);
 
 	int faceIndex = 0;
 	for (auto& facePath : m_facePaths)
@@ -40,7 +43,7 @@ void Texture3D::init()
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
 	// Unbind the current texture
-	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+	GLState::Instance().bindTexture(GL_TEXTURE_CUBE_MAP, 0);
 
 	glCheckError();
 }
@@ -49,15 +52,12 @@ void Texture3D::init()
 
 void Texture3D::bind(GLuint program)
 {
-	// Set the texture unit
+	// Bind the texture to its texture unit
 	int textureUnit = 0;
-	glActiveTexture(GLenum(GL_TEXTURE0 + textureUnit));
-
-	// Bind the texture
-	glBindTexture(GL_TEXTURE_CUBE_MAP, m_uiTexture);
+	GLState::Instance().bindTexture(textureUnit, GL_TEXTURE_CUBE_MAP, m_uiTexture);
 		
 	// Bind the cube map sampler
-	int location = glGetUniformLocation(program, "envMap");
+	int location = Shader::uniformLocation(program, "envMap");
 
 	glUniform1i(location, textureUnit);
 }
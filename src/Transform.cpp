@@ -0,0 +1,53 @@
+#include "Transform.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#define TRANSFORM_USE_SSE 1
+#include <xmmintrin.h>
+#endif
+
+// ----------------------------------------------------------------------------
+
+const glm::vec3 Transform::UP = glm::vec3(0.0f, 1.0f, 0.0f);
+const glm::vec3 Transform::RIGHT = glm::vec3(1.0f, 0.0f, 0.0f);
+const glm::vec3 Transform::FORWARD = glm::vec3(0.0f, 0.0f, 1.0f);
+
+// ----------------------------------------------------------------------------
+
+void Transform::updateMatrices() const
+{
+	// Since T is a translation and S a diagonal matrix, T * R * S only scales the rotation
+	// columns and stores the position in the last column. The inverse transpose of the
+	// upper 3x3 is R * S^-1, so no general matrix inverse is needed.
+	const bool rigid = isRigid();
+	const glm::mat4 rotationMat = glm::toMat4(m_rotation);
+
+#ifdef TRANSFORM_USE_SSE
+	const float* rotation = &rotationMat[0][0];
+	float* model = &m_modelMat[0][0];
+	float* normal = &m_normalMat[0][0];
+
+	for (int column = 0; column < 3; ++column)
+	{
+		__m128 rotationColumn = _mm_loadu_ps(rotation + column * 4);
+
+		_mm_storeu_ps(model + column * 4, _mm_mul_ps(rotationColumn, _mm_set1_ps(m_scale[column])));
+		_mm_storeu_ps(normal + column * 4, rigid ? rotationColumn : _mm_div_ps(rotationColumn, _mm_set1_ps(m_scale[column])));
+	}
+
+	_mm_storeu_ps(model + 12, _mm_set_ps(1.0f, m_position.z, m_position.y, m_position.x));
+	_mm_storeu_ps(normal + 12, _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f));
+#else
+	for (int column = 0; column < 3; ++column)
+	{
+		m_modelMat[column] = rotationMat[column] * m_scale[column];
+		m_normalMat[column] = rigid ? rotationMat[column] : rotationMat[column] / m_scale[column];
+	}
+
+	m_modelMat[3] = glm::vec4(m_position, 1.0f);
+	m_normalMat[3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+#endif // TRANSFORM_USE_SSE
+
+	m_dirty = false;
+}
+
+// ----------------------------------------------------------------------------
@@ -0,0 +1,238 @@
+#include "TransformSystem.h"
+
+#include <assert.h>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#define TRANSFORM_USE_SSE 1
+#include <xmmintrin.h>
+#endif
+
+// ----------------------------------------------------------------------------
+
+// out = a * b, column major
+static inline void multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+{
+#ifdef TRANSFORM_USE_SSE
+	const __m128 a0 = _mm_loadu_ps(&a[0][0]);
+	const __m128 a1 = _mm_loadu_ps(&a[1][0]);
+	const __m128 a2 = _mm_loadu_ps(&a[2][0]);
+	const __m128 a3 = _mm_loadu_ps(&a[3][0]);
+
+	for (int column = 0; column < 4; ++column)
+	{
+		__m128 result = _mm_mul_ps(a0, _mm_set1_ps(b[column][0]));
+		result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_set1_ps(b[column][1])));
+		result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_set1_ps(b[column][2])));
+		result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_set1_ps(b[column][3])));
+		_mm_storeu_ps(&out[column][0], result);
+	}
+#else
+	out = a * b;
+#endif // TRANSFORM_USE_SSE
+}
+
+// ----------------------------------------------------------------------------
+
+TransformSystem::TransformSystem()
+	: m_orderDirty(false), m_updatedCount(0)
+{
+}
+
+// ----------------------------------------------------------------------------
+
+TransformSystem::~TransformSystem()
+{
+}
+
+// ----------------------------------------------------------------------------
+
+TransformHandle TransformSystem::create(TransformHandle parent)
+{
+	TransformHandle handle;
+	if (m_freeHandleList.empty() == false)
+	{
+		handle = m_freeHandleList.back();
+		m_freeHandleList.pop_back();
+	}
+	else
+	{
+		handle = static_cast<TransformHandle>(m_handleToIndex.size());
+		m_handleToIndex.push_back(INVALID_TRANSFORM);
+	}
+
+	Node node;
+	node.handle = handle;
+	node.parent = parent;
+
+	m_handleToIndex[handle] = static_cast<GLuint>(m_nodeList.size());
+	m_nodeList.push_back(node);
+
+	// A new root keeps the order valid, a new child has to be moved into its parent's subtree
+	if (parent != INVALID_TRANSFORM)
+		m_orderDirty = true;
+
+	return handle;
+}
+
+// ----------------------------------------------------------------------------
+
+void TransformSystem::destroy(TransformHandle handle)
+{
+	GLuint index = m_handleToIndex[handle];
+	assert(index != INVALID_TRANSFORM && "Transform already destroyed.");
+
+	// Attach the children to the parent of the destroyed node
+	TransformHandle parent = m_nodeList[index].parent;
+	for (Node& node : m_nodeList)
+	{
+		if (node.parent == handle)
+		{
+			node.parent = parent;
+			node.reparented = true;
+			m_orderDirty = true;
+		}
+	}
+
+	// Erase keeping the order of the remaining nodes
+	m_nodeList.erase(m_nodeList.begin() + index);
+	for (GLuint nodeIndex = index; nodeIndex < m_nodeList.size(); ++nodeIndex)
+		m_handleToIndex[m_nodeList[nodeIndex].handle] = nodeIndex;
+
+	m_handleToIndex[handle] = INVALID_TRANSFORM;
+	m_freeHandleList.push_back(handle);
+
+	// Parent indices past the erased node are stale
+	m_orderDirty = true;
+}
+
+// ----------------------------------------------------------------------------
+
+void TransformSystem::setParent(TransformHandle handle, TransformHandle parent)
+{
+	// The new parent can't be part of the node's subtree
+	for (TransformHandle ancestor = parent; ancestor != INVALID_TRANSFORM; ancestor = m_nodeList[m_handleToIndex[ancestor]].parent)
+		assert(ancestor != handle && "Transform hierarchy cycle.");
+
+	Node& node = m_nodeList[m_handleToIndex[handle]];
+	if (node.parent == parent)
+		return;
+
+	node.parent = parent;
+	node.reparented = true;
+	m_orderDirty = true;
+}
+
+// ----------------------------------------------------------------------------
+
+glm::vec3 TransformSystem::toLocal(TransformHandle handle, const glm::vec3& point) const
+{
+	const Node& node = m_nodeList[m_handleToIndex[handle]];
+
+	// Walk down from the root, one local transform at a time
+	glm::vec3 parentSpacePoint = node.parent != INVALID_TRANSFORM ? toLocal(node.parent, point) : point;
+	return node.local.toLocal(parentSpacePoint);
+}
+
+// ----------------------------------------------------------------------------
+
+void TransformSystem::sortNodes()
+{
+	const GLuint nodeCount = static_cast<GLuint>(m_nodeList.size());
+
+	// Child lists in the current order, so siblings keep their relative order
+	std::vector<GLuint> firstChild(nodeCount, INVALID_TRANSFORM);
+	std::vector<GLuint> lastChild(nodeCount, INVALID_TRANSFORM);
+	std::vector<GLuint> nextSibling(nodeCount, INVALID_TRANSFORM);
+	std::vector<GLuint> rootList;
+
+	for (GLuint index = 0; index < nodeCount; ++index)
+	{
+		const Node& node = m_nodeList[index];
+		if (node.parent == INVALID_TRANSFORM)
+		{
+			rootList.push_back(index);
+			continue;
+		}
+
+		GLuint parentIndex = m_handleToIndex[node.parent];
+		if (firstChild[parentIndex] == INVALID_TRANSFORM)
+			firstChild[parentIndex] = index;
+		else
+			nextSibling[lastChild[parentIndex]] = index;
+		lastChild[parentIndex] = index;
+	}
+
+	// Depth-first traversal
+	std::vector<Node> sortedList;
+	sortedList.reserve(nodeCount);
+	std::vector<GLuint> stack;
+
+	for (GLuint root : rootList)
+	{
+		stack.push_back(root);
+		while (stack.empty() == false)
+		{
+			GLuint index = stack.back();
+			stack.pop_back();
+
+			sortedList.push_back(m_nodeList[index]);
+
+			// Push the children in reverse so the first child is visited first
+			size_t childStart = stack.size();
+			for (GLuint child = firstChild[index]; child != INVALID_TRANSFORM; child = nextSibling[child])
+				stack.push_back(child);
+			std::reverse(stack.begin() + childStart, stack.end());
+		}
+	}
+
+	m_nodeList.swap(sortedList);
+
+	// Parents are placed before their children, so their new index is already known
+	for (GLuint index = 0; index < nodeCount; ++index)
+	{
+		Node& node = m_nodeList[index];
+		m_handleToIndex[node.handle] = index;
+		node.parentIndex = node.parent != INVALID_TRANSFORM ? m_handleToIndex[node.parent] : INVALID_TRANSFORM;
+	}
+
+	m_orderDirty = false;
+}
+
+// ----------------------------------------------------------------------------
+
+void TransformSystem::update()
+{
+	if (m_orderDirty)
+		sortNodes();
+
+	m_updatedCount = 0;
+
+	for (Node& node : m_nodeList)
+	{
+		bool parentUpdated = node.parentIndex != INVALID_TRANSFORM && m_nodeList[node.parentIndex].updated;
+
+		node.updated = node.local.dirty() || node.reparented || parentUpdated;
+		node.reparented = false;
+
+		if (node.updated == false)
+			continue;
+
+		if (node.parentIndex == INVALID_TRANSFORM)
+		{
+			node.worldMat = node.local.modelMat();
+			node.normalMat = node.local.normalMat();
+		}
+		else
+		{
+			// The inverse transpose of a product is the product of the inverse transposes
+			const Node& parent = m_nodeList[node.parentIndex];
+			multiply(parent.worldMat, node.local.modelMat(), node.worldMat);
+			multiply(parent.normalMat, node.local.normalMat(), node.normalMat);
+		}
+
+		m_updatedCount++;
+	}
+}
+
+// ----------------------------------------------------------------------------
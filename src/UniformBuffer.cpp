@@ -0,0 +1,171 @@
+#include "UniformBuffer.h"
+
+#include <iostream>
+#include <assert.h>
+#include <cstring>
+
+// ----------------------------------------------------------------------------
+
+UniformBuffer::UniformBuffer()
+	: m_handle(0), m_size(0), m_block(UniformBlock::Count)
+{
+}
+
+// ----------------------------------------------------------------------------
+
+UniformBuffer::~UniformBuffer()
+{
+	if (m_handle != 0)
+		glDeleteBuffers(1, &m_handle);
+}
+
+// ----------------------------------------------------------------------------
+
+bool UniformBuffer::create(UniformBlock block, GLsizeiptr size)
+{
+	assert(block != UniformBlock::Count && "Invalid uniform block specified.");
+
+	m_block = block;
+	m_size = size;
+
+	glGenBuffers(1, &m_handle);
+	if (m_handle == 0)
+	{
+		std::cout << "Failed to create uniform buffer " << blockName(block) << "\n";
+		return false;
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_handle);
+	glBufferData(GL_UNIFORM_BUFFER, m_size, nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	// Attach to the binding point used by all the programs
+	glBindBufferBase(GL_UNIFORM_BUFFER, static_cast<GLuint>(block), m_handle);
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+
+void UniformBuffer::update(const void* data, GLsizeiptr size, GLintptr offset)
+{
+	assert(offset + size <= m_size && "Uniform buffer update out of range.");
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_handle);
+	glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+// ----------------------------------------------------------------------------
+
+const char* UniformBuffer::blockName(UniformBlock block)
+{
+	switch (block)
+	{
+		case UniformBlock::Camera:
+			return "CameraData";
+		case UniformBlock::Frame:
+			return "FrameData";
+		case UniformBlock::Object:
+			return "ObjectData";
+		case UniformBlock::DirectionalLights:
+			return "DirectionalLightData";
+		case UniformBlock::SpotLights:
+			return "SpotLightData";
+		default:
+			return "";
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+UniformBufferRing::UniformBufferRing()
+	: m_handle(0), m_elementSize(0), m_stride(0), m_capacity(0), m_head(0), m_block(UniformBlock::Count)
+{
+}
+
+// ----------------------------------------------------------------------------
+
+UniformBufferRing::~UniformBufferRing()
+{
+	if (m_handle != 0)
+		glDeleteBuffers(1, &m_handle);
+}
+
+// ----------------------------------------------------------------------------
+
+bool UniformBufferRing::create(UniformBlock block, GLsizeiptr elementSize, GLuint elementCount)
+{
+	assert(block != UniformBlock::Count && "Invalid uniform block specified.");
+	assert(elementCount > 0 && "Empty uniform buffer ring.");
+
+	m_block = block;
+	m_elementSize = elementSize;
+	m_capacity = elementCount;
+	m_head = 0;
+
+	// Bound ranges have to start at a multiple of the offset alignment
+	GLint offsetAlignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+	if (offsetAlignment < 1) offsetAlignment = 1;
+	m_stride = (elementSize + offsetAlignment - 1) / offsetAlignment * offsetAlignment;
+
+	glGenBuffers(1, &m_handle);
+	if (m_handle == 0)
+	{
+		std::cout << "Failed to create uniform buffer ring " << UniformBuffer::blockName(block) << "\n";
+		return false;
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_handle);
+	glBufferData(GL_UNIFORM_BUFFER, m_stride * m_capacity, nullptr, GL_STREAM_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+
+GLuint UniformBufferRing::write(const void* data, GLuint count)
+{
+	assert(count > 0 && count <= m_capacity && "Invalid uniform buffer ring write.");
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_handle);
+
+	// Append after the last write without waiting for the draws reading the previous elements,
+	// or restart from the front in a new storage when the elements don't fit
+	GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+	if (m_head + count > m_capacity)
+	{
+		m_head = 0;
+		access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT;
+	}
+
+	GLuint first = m_head;
+	char* mapped = static_cast<char*>(glMapBufferRange(GL_UNIFORM_BUFFER, first * m_stride, count * m_stride, access));
+	if (mapped != nullptr)
+	{
+		const char* source = static_cast<const char*>(data);
+		for (GLuint element = 0; element < count; ++element)
+			memcpy(mapped + element * m_stride, source + element * m_elementSize, m_elementSize);
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+	}
+	else
+		std::cout << "Failed to map uniform buffer ring " << UniformBuffer::blockName(m_block) << "\n";
+
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	m_head += count;
+	return first;
+}
+
+// ----------------------------------------------------------------------------
+
+void UniformBufferRing::bind(GLuint element) const
+{
+	assert(element < m_capacity && "Invalid uniform buffer ring element.");
+
+	glBindBufferRange(GL_UNIFORM_BUFFER, static_cast<GLuint>(m_block), m_handle, element * m_stride, m_elementSize);
+}
+
+// ----------------------------------------------------------------------------
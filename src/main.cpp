@@ -14,6 +14,7 @@ int main(void)
 	// Initialize GLFramework
 	bool enableMultisampling = true;
 	bool enableSRGBFbSupport = true;
+	glFramework->setCompactGbuffer(true);
 	if (glFramework->initialize("GLFramework", enableMultisampling, enableSRGBFbSupport) == false)
 		return -1;
 	